@@ -1,16 +1,32 @@
 #pragma once
 
 #include <Fonts/Picopixel.h>
+#include <string.h>
 
 #ifdef ARDUINO_ARCH_RP2040
   #define HALVOE_SERIAL_TYPE SerialUART
 #elif __IMXRT1062__
   #define HALVOE_SERIAL_TYPE HardwareSerialIMXRT
+#elif defined(HALVOE_GPU_HOST)
+  #include "host/HostSerial.hpp"
+  #define HALVOE_SERIAL_TYPE halvoeGPU::host::HostSerial
 #else
   #error Invalid MCU!
 #endif // ARDUINO_ARCH_RP2040
 
-#define HALVOE_GPU_DEBUG
+#ifndef HALVOE_GPU_HOST
+  #define HALVOE_GPU_DEBUG
+#endif // HALVOE_GPU_HOST
+
+// Both have to be the same at the CPU and at the GPU, see host/memoryReport.cpp for what they cost.
+// Longer strings and blits are sent in several packets, so the parameter buffer can be a few hundred bytes.
+#ifndef HALVOE_GPU_MAX_PARAMETER_BUFFER_LENGTH
+  #define HALVOE_GPU_MAX_PARAMETER_BUFFER_LENGTH 512
+#endif // HALVOE_GPU_MAX_PARAMETER_BUFFER_LENGTH
+
+#ifndef HALVOE_GPU_RECEIVE_RING_LENGTH
+  #define HALVOE_GPU_RECEIVE_RING_LENGTH 4096
+#endif // HALVOE_GPU_RECEIVE_RING_LENGTH
 //#define HALVOE_GPU_DEBUG_ADD_STRING
 
 namespace halvoeGPU
@@ -19,11 +35,35 @@ namespace halvoeGPU
   constexpr const uint16_t g_screenHeight = 240;
   constexpr const uint16_t g_colorCount = 256;
 
-  constexpr const unsigned long g_minFrameTimeMicros = 4000;
+  constexpr const unsigned long g_minFrameTimeMicros = 4000; // without frame pacing, the GPU drops swaps within this time
+  constexpr const unsigned long g_dviFramePeriodMicros = 16667; // 60 Hz, DVIGFX8::swap() waits for the next vertical blank
+  constexpr const unsigned long g_swapTimeoutMillis = 250;     // for the swapPresented of a frame, which the GPU is presenting
   constexpr const unsigned long g_oneSecondInMicros = 1000000;
 
-  constexpr const size_t g_maxParameterBufferLength = 16384;
+  constexpr const size_t g_maxParameterBufferLength = HALVOE_GPU_MAX_PARAMETER_BUFFER_LENGTH; // of one packet
   constexpr const size_t g_zeroTerminatorLength = 1;
+  constexpr const size_t g_commandHeaderLength = 4; // uint16_t command code + uint16_t parameter length
+  constexpr const size_t g_maxCommandHeaderLength = g_commandHeaderLength;
+  constexpr const size_t g_compactShortLengthLimit = 0x80;
+  constexpr const size_t g_maxCompactVarUInt16Length = 3;
+  constexpr const size_t g_responseHeaderLength = 2; // uint8_t response code + uint8_t payload length
+  constexpr const size_t g_maxResponsePayloadLength = 255;
+  constexpr const size_t g_maxSpriteIDCount = 256; // sprite ids are uint8_t
+  constexpr const size_t g_maxMacroCount = 32;       // macro ids are 0 to g_maxMacroCount - 1
+  constexpr const size_t g_maxMacroSlotCount = 8;
+  constexpr const size_t g_maxMacroBodyLength = g_maxParameterBufferLength < 1024 ? g_maxParameterBufferLength : 1024; // the commands of a macro, as batched in v1
+  constexpr const size_t g_gpuReceiveRingLength = HALVOE_GPU_RECEIVE_RING_LENGTH; // a power of two, holds the largest packet and the credit window
+  constexpr const size_t g_creditWindowLength = g_gpuReceiveRingLength - 16; // bytes atCPU may send ahead of the GPU, a little less than its receive ring
+  constexpr const size_t g_creditReportLength = 256; // the GPU reports its received byte count at least every g_creditReportLength bytes
+  constexpr const unsigned long g_creditTimeoutMillis = 1000;
+  constexpr const size_t g_linkTestPatternLength = 240;         // per testLink command
+  constexpr const size_t g_baudProbeCount = 4;                  // testLink commands, which have to pass before a baud is kept
+  constexpr const unsigned long g_baudProbeTimeoutMillis = 250; // without a passed testLink, the GPU returns to the previous baud
+  constexpr const unsigned long g_baudFallbackErrorCount = 8;   // link errors, after which atCPU steps down to a lower baud
+
+  static_assert(g_maxParameterBufferLength >= 256, "testLink and the fillRects of atCPU have to fit into a packet");
+  static_assert(g_maxParameterBufferLength <= UINT16_MAX, "the parameter length of a packet is a uint16_t");
+  static_assert(g_gpuReceiveRingLength >= 2 * g_creditReportLength, "the credit window has to be larger than g_creditReportLength");
 
   enum class SerialGFXBaud : unsigned long
   {
@@ -50,40 +90,112 @@ namespace halvoeGPU
     setTextColor,
     setCursor,
     print,
-    println
+    println,
+    batch,
+    setProtocol,
+    blitBegin,
+    blitData,
+    uploadSprite,
+    drawSprite,
+    resetCredits,
+    setBaud,
+    testLink,
+    setFraming,
+    setFramePacing,
+    queryStats,
+    printAt,
+    printlnAt,
+    fillRects,
+    defineMacro,
+    callMacro,
+    end // not a command, one behind the last command code: new codes are added in front of it
+  };
+
+  constexpr const size_t g_commandCodeCount = static_cast<size_t>(SerialGFXCommandCode::end);
+
+  // Sent by the GPU to the CPU (uint8_t response code, uint8_t payload length, payload).
+  enum class SerialGFXResponseCode : uint8_t
+  {
+    invalid = 0,
+    spriteEvicted, // uint8_t sprite id, the sprite is no longer in the cache of the GPU
+    spriteMissing, // uint8_t sprite id, drawSprite was called for a sprite, which is not in the cache
+    credit,        // uint32_t count of the bytes the GPU has read since resetCredits
+    creditReset,   // no payload, resetCredits was received, the byte count starts at 0
+    baudChanged,   // uint32_t baud, sent at the previous baud, then the GPU switches to the new baud
+    linkTested,    // uint8_t sequence number, uint16_t count of the test pattern bytes, which were not received intact
+    linkErrors,    // uint16_t total count of the receive errors (parse errors and corrupted frames), wrapping; a lost linkErrors loses no errors
+    swapPresented, // uint32_t frame number (swaps since setFramePacing), uint32_t present time (micros of the GPU), uint32_t render micros of the frame
+    stats          // uint8_t sequence number, uint8_t section, uint8_t first index, the section (see GPUStats::writeSection())
+  };
+
+  // v1:      uint16_t command code, uint16_t parameter length, uint16_t colors, int16_t coordinates,
+  //          batched commands are padded to an even length
+  // compact: uint8_t command code, 1 byte parameter length (< 0x80) or 2 byte parameter length (0x80 | high byte, low byte),
+  //          uint8_t colors (palette index), zigzag varint coordinates, batched commands are not padded
+  enum class SerialGFXProtocol : uint8_t
+  {
+    v1 = 1,
+    compact
   };
 
 
+  enum class SerialGFXBlitCodec : uint8_t
+  {
+    raw = 0,
+    rle,
+    lz
+  };
+
   enum class SerialGFXFont : uint8_t
   {
     Default = 0,
     Picopixel
   };
 
+  // the bauds, which setBaud accepts, from the slowest to the fastest
+  constexpr const SerialGFXBaud g_baudLadder[] = {
+    SerialGFXBaud::Fallback, SerialGFXBaud::Min, SerialGFXBaud::Quarter, SerialGFXBaud::Half,
+    SerialGFXBaud::Default, SerialGFXBaud::Double, SerialGFXBaud::Quad, SerialGFXBaud::Max
+  };
+
+  constexpr const size_t g_baudLadderLength = sizeof(g_baudLadder) / sizeof(SerialGFXBaud);
+
   unsigned long fromSerialGFXBaud(SerialGFXBaud in_baud)
   {
     return static_cast<unsigned long>(in_baud);
   }
 
-  SerialGFXCommandCode toSerialGFXCommandCode(uint16_t in_value)
+  // g_baudLadderLength if in_baud is not on the ladder
+  size_t getBaudLadderIndex(unsigned long in_baud)
   {
-    switch (static_cast<SerialGFXCommandCode>(in_value))
+    for (size_t index = 0; index < g_baudLadderLength; ++index)
     {
-      case SerialGFXCommandCode::noCommand:
-      case SerialGFXCommandCode::swap:
-      case SerialGFXCommandCode::fillScreen:
-      case SerialGFXCommandCode::fillRect:
-      case SerialGFXCommandCode::drawRect:
-      case SerialGFXCommandCode::setFont:
-      case SerialGFXCommandCode::setTextSize:
-      case SerialGFXCommandCode::setTextColor:
-      case SerialGFXCommandCode::setCursor:
-      case SerialGFXCommandCode::print:
-      case SerialGFXCommandCode::println:
-        return static_cast<SerialGFXCommandCode>(in_value);
+      if (fromSerialGFXBaud(g_baudLadder[index]) == in_baud) { return index; }
     }
 
-    return SerialGFXCommandCode::invalid;
+    return g_baudLadderLength;
+  }
+
+  bool isValidSerialGFXBaud(unsigned long in_baud)
+  {
+    return getBaudLadderIndex(in_baud) < g_baudLadderLength;
+  }
+
+  // Byte in_index of the testLink pattern, in_sequence shifts it, so a stale pattern does not pass.
+  // It has runs of 0x00, 0xFF, 0x55 and 0xAA, which are hard on a marginal link, between changing bytes.
+  uint8_t getLinkTestByte(uint8_t in_sequence, size_t in_index)
+  {
+    static constexpr const uint8_t runBytes[] = { 0x00, 0xFF, 0x55, 0xAA };
+    size_t position = (in_index + in_sequence) % 32;
+    if (position < 8) { return runBytes[(in_index / 32) % 4]; }
+    return static_cast<uint8_t>((in_index * 167 + in_sequence * 29 + 13) & 0xFF);
+  }
+
+  // the command codes are contiguous, so every value in front of SerialGFXCommandCode::end is a command
+  SerialGFXCommandCode toSerialGFXCommandCode(uint16_t in_value)
+  {
+    if (in_value >= g_commandCodeCount) { return SerialGFXCommandCode::invalid; }
+    return static_cast<SerialGFXCommandCode>(in_value);
   }
 
   uint16_t fromSerialGFXCommandCode(SerialGFXCommandCode in_code)
@@ -91,12 +203,137 @@ namespace halvoeGPU
     return static_cast<uint16_t>(in_code);
   }
 
+  SerialGFXResponseCode toSerialGFXResponseCode(uint8_t in_value)
+  {
+    switch (static_cast<SerialGFXResponseCode>(in_value))
+    {
+      case SerialGFXResponseCode::spriteEvicted:
+      case SerialGFXResponseCode::spriteMissing:
+      case SerialGFXResponseCode::credit:
+      case SerialGFXResponseCode::creditReset:
+      case SerialGFXResponseCode::baudChanged:
+      case SerialGFXResponseCode::linkTested:
+      case SerialGFXResponseCode::linkErrors:
+      case SerialGFXResponseCode::swapPresented:
+      case SerialGFXResponseCode::stats:
+        return static_cast<SerialGFXResponseCode>(in_value);
+      case SerialGFXResponseCode::invalid:
+        break;
+    }
+
+    return SerialGFXResponseCode::invalid;
+  }
+
+  bool isValidSerialGFXProtocol(uint8_t in_value)
+  {
+    switch (static_cast<SerialGFXProtocol>(in_value))
+    {
+      case SerialGFXProtocol::v1:
+      case SerialGFXProtocol::compact:
+        return true;
+    }
+
+    return false;
+  }
+
+  bool isValidSerialGFXBlitCodec(uint8_t in_value)
+  {
+    switch (static_cast<SerialGFXBlitCodec>(in_value))
+    {
+      case SerialGFXBlitCodec::raw:
+      case SerialGFXBlitCodec::rle:
+      case SerialGFXBlitCodec::lz:
+        return true;
+    }
+
+    return false;
+  }
+
+  template<typename ValueType>
+  ValueType readValue(const char* in_buffer)
+  {
+    ValueType value;
+    memcpy(&value, in_buffer, sizeof(ValueType));
+    return value;
+  }
+
+  template<typename ValueType>
+  void writeValue(ValueType in_value, char* out_buffer)
+  {
+    memcpy(out_buffer, &in_value, sizeof(ValueType));
+  }
+
+  uint16_t toZigZag(int16_t in_value)
+  {
+    return static_cast<uint16_t>(static_cast<uint16_t>(in_value) << 1) ^ static_cast<uint16_t>(in_value >> 15);
+  }
+
+  int16_t fromZigZag(uint16_t in_value)
+  {
+    return static_cast<int16_t>((in_value >> 1) ^ static_cast<uint16_t>(-(in_value & 1)));
+  }
+
+  size_t getCommandHeaderLength(SerialGFXProtocol in_protocol, size_t in_parameterLength)
+  {
+    if (in_protocol == SerialGFXProtocol::compact) { return in_parameterLength < g_compactShortLengthLimit ? 2 : 3; }
+    return g_commandHeaderLength;
+  }
+
+  // in_headerLength selects the short or long length form of the compact protocol,
+  // the long form may also carry a short length.
+  void writeCommandHeader(SerialGFXProtocol in_protocol, char* out_header, size_t in_headerLength,
+                          SerialGFXCommandCode in_commandCode, uint16_t in_parameterLength)
+  {
+    if (in_protocol == SerialGFXProtocol::compact)
+    {
+      out_header[0] = static_cast<char>(fromSerialGFXCommandCode(in_commandCode));
+      if (in_headerLength == 2) { out_header[1] = static_cast<char>(in_parameterLength); return; }
+      out_header[1] = static_cast<char>(g_compactShortLengthLimit | (in_parameterLength >> 8));
+      out_header[2] = static_cast<char>(in_parameterLength & 0xFF);
+      return;
+    }
+
+    writeValue<uint16_t>(fromSerialGFXCommandCode(in_commandCode), out_header);
+    writeValue<uint16_t>(in_parameterLength, out_header + sizeof(uint16_t));
+  }
+
+  // Returns the header length, that is needed to decode the header, given the first in_receivedLength bytes of it.
+  size_t getRequiredCommandHeaderLength(SerialGFXProtocol in_protocol, const char* in_header, size_t in_receivedLength)
+  {
+    if (in_protocol != SerialGFXProtocol::compact) { return g_commandHeaderLength; }
+    if (in_receivedLength < 2) { return 2; }
+    return (static_cast<uint8_t>(in_header[1]) & g_compactShortLengthLimit) ? 3 : 2;
+  }
+
+  void readCommandHeader(SerialGFXProtocol in_protocol, const char* in_header,
+                         SerialGFXCommandCode& out_commandCode, uint16_t& out_parameterLength)
+  {
+    if (in_protocol == SerialGFXProtocol::compact)
+    {
+      out_commandCode = toSerialGFXCommandCode(static_cast<uint8_t>(in_header[0]));
+      uint8_t lengthByte = static_cast<uint8_t>(in_header[1]);
+      if ((lengthByte & g_compactShortLengthLimit) == 0) { out_parameterLength = lengthByte; return; }
+      out_parameterLength = static_cast<uint16_t>(((lengthByte & ~g_compactShortLengthLimit) << 8) | static_cast<uint8_t>(in_header[2]));
+      return;
+    }
+
+    out_commandCode = toSerialGFXCommandCode(readValue<uint16_t>(in_header));
+    out_parameterLength = readValue<uint16_t>(in_header + sizeof(uint16_t));
+  }
+
+  // v1: commands inside a batch start at even offsets, so their uint16_t/int16_t parameters stay aligned.
+  size_t getBatchedCommandLength(SerialGFXProtocol in_protocol, size_t in_headerLength, size_t in_parameterLength)
+  {
+    if (in_protocol == SerialGFXProtocol::compact) { return in_headerLength + in_parameterLength; }
+    return in_headerLength + in_parameterLength + (in_parameterLength & 1);
+  }
+
   uint8_t fromSerialGFXFont(SerialGFXFont in_font)
   {
     return static_cast<uint8_t>(in_font);
   }
 
-  bool getFontPointer(SerialGFXFont in_font, const GFXfont* out_pointer)
+  bool getFontPointer(SerialGFXFont in_font, const GFXfont*& out_pointer)
   {
     switch (in_font)
     {
@@ -3,8 +3,17 @@
 #include <Adafruit_GFX.h>
 #include <elapsedMillis.h>
 #include <array>
+#include <initializer_list>
 
+#include "halvoeBlitCodec.hpp"
+#include "halvoeCommandSchema.hpp"
 #include "halvoeCString.hpp"
+#include "halvoeFraming.hpp"
+#include "halvoeGPUStats.hpp"
+#include "halvoeRetainedFrame.hpp"
+#include "halvoeTextMetrics.hpp"
+#include "halvoeTrace.hpp"
+#include "halvoeTransmitRing.hpp"
 #include "SerialGFXInterface.hpp"
 
 namespace halvoeGPU
@@ -12,6 +21,15 @@ namespace halvoeGPU
   namespace atCPU
   {
     const uint8_t READY_PIN = 40;
+    constexpr const size_t g_maxFillRectsCount = 16; // rectangles per fillRects, so it fits into a command queue slot of the GPU
+
+    // defineMacro: id, slot count and the slots are written in front of the recorded body
+    constexpr const size_t g_maxMacroHeaderLength = DefineMacroSchema::getMaxLength() + g_maxMacroSlotCount * MacroSlotSchema::getMaxLength();
+
+    constexpr const size_t g_maxTextChunkLength = g_maxParameterBufferLength - PrintAtSchema::getMaxLength() - g_zeroTerminatorLength; // per print command
+
+    static_assert(g_transmitRingLength >= g_frameSyncLength + g_maxCommandHeaderLength + g_maxParameterBufferLength + g_frameChecksumLength,
+                  "the transmit ring has to hold the largest packet");
 
     // This class exists, because we need some methods from Adafruit_GFX (in particular getTextBounds()),
     // but we do not need a working Adafruit_GFX like GFXcanvas8 or DVIGFX8.
@@ -28,31 +46,246 @@ namespace halvoeGPU
         }
     };
 
+    // what atCPU knows about a sprite in the cache of the GPU
+    struct SpriteInfo
+    {
+      int16_t width = 0;
+      int16_t height = 0;
+      uint32_t uploadCount = 0;
+      bool isResident = false;
+    };
+
+    // a field of the recorded body, into which the GPU writes a value of callMacro
+    struct MacroSlotBinding
+    {
+      uint16_t offset = 0; // in the body
+      uint8_t length = 0;  // 0: the slot is not bound
+    };
+
+    // the swapPresented of the GPU for the last presented frame
+    struct SwapPresented
+    {
+      uint32_t frameNumber = 0; // 0: no frame is presented since enableFramePacing()
+      uint32_t presentMicros = 0; // micros() of the GPU
+      uint32_t renderMicros = 0;
+    };
+
     class SerialGFXInterface
     {
       private:
         HALVOE_SERIAL_TYPE& m_serial;
         uint16_t m_parameterBufferLength = 0;
-        std::array<char, 2> m_commandBuffer;
-        std::array<char, g_maxParameterBufferLength> m_parameterBuffer;
+        std::array<char, g_maxCommandHeaderLength> m_commandBuffer;
+        alignas(uint16_t) std::array<char, g_maxParameterBufferLength> m_parameterBuffer;
         HelperGFX m_helperGFX;
+        TextMetricsCache m_textMetrics; // answers getTextBounds() before m_helperGFX
+        SerialGFXProtocol m_protocol = SerialGFXProtocol::v1;
+
+        bool m_isBatchEnabled = false;
+        bool m_isCommandBatched = false;
+        SerialGFXCommandCode m_commandCode = SerialGFXCommandCode::noCommand;
+        uint16_t m_commandBegin = 0;
+        size_t m_commandHeaderLength = 0;
+
+        TextState m_textState; // as set by the last sendSet*() calls
+        bool m_isCursorPending = false; // sendSetCursor() is sent with the next text (from m_helperGFX)
+        long m_savedByteCount = 0;
+
+        // the last batched command is a fillRect or fillRects with these rectangles, further ones with its color are added to it
+        std::array<Rect, g_maxFillRectsCount> m_fillRects;
+        size_t m_fillRectCount = 0;
+        uint16_t m_fillRectsColor = 0;
+        size_t m_fillRectsBegin = 0;
+
+        BlitEncoder m_blitEncoder;
+        bool m_isBlitDataCommandOpen = false;
+        size_t m_blitDataCommandEnd = 0; // m_parameterBufferLength at which the open blitData command is full
+
+        std::array<SpriteInfo, g_maxSpriteIDCount> m_sprites;
+        std::array<uint8_t, g_frameSyncLength + g_responseHeaderLength + g_maxResponsePayloadLength + g_frameChecksumLength> m_responseBuffer;
+        size_t m_receivedResponseLength = 0;
+
+        bool m_isFramingEnabled = false;
+        unsigned long m_corruptedResponseCount = 0;
+        unsigned long m_discardedResponseByteCount = 0;
+
+        bool m_isRetainedModeEnabled = false;
+        bool m_isPreviousFrameValid = false;
+        bool m_isRetainedFrameOverflowed = false;
+        std::array<RetainedFrame, 2> m_retainedFrames;
+        RetainedFrame* m_previousFrame = &m_retainedFrames[0];
+        RetainedFrame* m_currentFrame = &m_retainedFrames[1];
+        DirtyRegion m_dirtyRegion;
+        TextState m_gpuTextState; // text state of the GPU, as far as it is sent
+        bool m_isGPUTextStateKnown = false;
+        int16_t m_gpuCursorX = 0;
+        int16_t m_gpuCursorY = 0;
+        bool m_isGPUCursorKnown = false;
+
+        bool m_isCreditFlowControlEnabled = false;
+        bool m_isCreditResetPending = false; // resetCredits is sent, but creditReset is not received yet
+        uint32_t m_sentByteCount = 0;        // since resetCredits
+        uint32_t m_gpuReceivedByteCount = 0; // as reported by the GPU
+        unsigned long m_creditWaitCount = 0;
+        unsigned long m_creditTimeoutCount = 0;
+
+        unsigned long m_baud = 0;
+        bool m_isBaudAutoFallbackEnabled = false;
+        bool m_isBaudFallbackPending = false;
+        unsigned long m_acknowledgedBaud = 0;  // of the last baudChanged
+        bool m_isLinkTestReceived = false;
+        uint8_t m_linkTestSequence = 0;
+        uint8_t m_receivedLinkTestSequence = 0;
+        uint16_t m_receivedLinkTestErrorCount = 0;
+        unsigned long m_linkErrorCount = 0;
+        unsigned long m_linkErrorCountAtBaud = 0; // m_linkErrorCount, when the current baud was set
+        uint16_t m_reportedLinkErrorCount = 0; // the total of the last linkErrors
+        unsigned long m_baudFallbackCount = 0;
+
+        bool m_isFramePacingEnabled = false;
+        uint32_t m_sentFrameNumber = 0; // swaps since enableFramePacing()
+        SwapPresented m_swapPresented;
+        unsigned long m_missedVBlankCount = 0;
+
+        GPUStats m_gpuStats;
+        uint8_t m_gpuStatsSequence = 0; // of the last queryStats
+        bool m_isGPUStatsReceived = false;
+
+        bool m_isMacroRecording = false;
+        bool m_isMacroFailed = false; // a command did not fit behind the recorded ones or could not be recorded
+        uint8_t m_macroID = 0;
+        std::array<MacroSlotBinding, g_maxMacroSlotCount> m_macroSlots;
+        size_t m_macroSlotCount = 0;
+        SerialGFXProtocol m_macroProtocol = SerialGFXProtocol::v1; // m_protocol in front of the recording
+        bool m_isMacroBatchEnabled = false;
+
+        bool m_isTransmitQueueEnabled = false;
+        TransmitPolicy m_transmitPolicy = TransmitPolicy::block;
+        TransmitRing<g_transmitRingLength> m_transmitRing;
+        bool m_isTransmitBackPressured = false; // the last packet did not fit (TransmitPolicy::reportBackPressure)
+        unsigned long m_transmitBackPressureCount = 0;
+        unsigned long m_droppedFrameCount = 0;
+        bool m_isTransmitCreditWaiting = false; // pumpTransmit() has no credits since m_timeSinceTransmitCreditWait
+        elapsedMillis m_timeSinceTransmitCreditWait;
+
+        TraceWriter m_trace; // see beginCapture()
 
       private:
+        // The bytes are written in chunks of at most g_creditReportLength, so the responses of the GPU are read in between.
+        // With credit flow control, only as many bytes as there are credits are written, then the credit responses of the GPU
+        // are awaited. If they do not come within g_creditTimeoutMillis, the credit flow control is disabled.
+        // With the transmit queue, the bytes go into the transmit ring, sendCommand() has reserved room for them.
+        bool writeBytes(const char* in_bytes, size_t in_length)
+        {
+          if (m_isTransmitQueueEnabled) { m_transmitRing.write(in_bytes, in_length); return true; }
+
+          while (in_length > 0)
+          {
+            receiveResponses(); // so the receive buffer does not overrun, the GPU also responds without credit flow control
+            size_t writeLength = min(in_length, g_creditReportLength);
+
+            if (m_isCreditFlowControlEnabled)
+            {
+              if (getCredits() == 0)
+              {
+                ++m_creditWaitCount;
+                elapsedMillis timeSinceWait;
+                while (getCredits() == 0 && timeSinceWait < g_creditTimeoutMillis) { yield(); receiveResponses(); }
+
+                if (getCredits() == 0)
+                {
+                  ++m_creditTimeoutCount;
+                  m_isCreditFlowControlEnabled = false;
+                  continue;
+                }
+              }
+
+              writeLength = min(writeLength, getCredits());
+            }
+
+            size_t bytesWritten = m_serial.write(in_bytes, writeLength);
+            m_sentByteCount = m_sentByteCount + bytesWritten;
+            if (bytesWritten != writeLength) { return false; }
+
+            in_bytes = in_bytes + writeLength;
+            in_length = in_length - writeLength;
+          }
+
+          return true;
+        }
+
+        // the packet as it goes on the link, with the transmit queue it is recorded, when it is queued
+        void writeTraceRecord(size_t in_headerLength, const char* in_checksum)
+        {
+          size_t framingLength = m_isFramingEnabled ? g_frameSyncLength + g_frameChecksumLength : 0;
+          m_trace.beginRecord(framingLength + in_headerLength + m_parameterBufferLength);
+          if (m_isFramingEnabled) { m_trace.write(g_frameSyncWord, g_frameSyncLength); }
+          m_trace.write(m_commandBuffer.data(), in_headerLength);
+          m_trace.write(m_parameterBuffer.data(), m_parameterBufferLength);
+          if (m_isFramingEnabled) { m_trace.write(in_checksum, g_frameChecksumLength); }
+        }
+
+        bool writePacket(size_t in_headerLength)
+        {
+          char checksum[g_frameChecksumLength];
+          if (m_isFramingEnabled)
+          {
+            writeValue<uint16_t>(updateCRC16(updateCRC16(g_crc16InitialValue, m_commandBuffer.data(), in_headerLength), m_parameterBuffer.data(), m_parameterBufferLength),
+                                 checksum);
+          }
+
+          if (m_trace.isEnabled()) { writeTraceRecord(in_headerLength, checksum); }
+
+          if (m_isFramingEnabled && not writeBytes(reinterpret_cast<const char*>(g_frameSyncWord), g_frameSyncLength)) { return false; }
+          if (not writeBytes(m_commandBuffer.data(), in_headerLength)) { return false; }
+          if (m_parameterBufferLength > 0 && not writeBytes(m_parameterBuffer.data(), m_parameterBufferLength)) { return false; }
+          return not m_isFramingEnabled || writeBytes(checksum, g_frameChecksumLength);
+        }
+
         bool sendCommand(SerialGFXCommandCode in_commandCode)
         {
-          *reinterpret_cast<uint16_t*>(m_commandBuffer.data()) = fromSerialGFXCommandCode(in_commandCode);
-          size_t bytesWritten = m_serial.write(m_commandBuffer.data(), 2);
-          if (bytesWritten != 2) { return false; }
-          *reinterpret_cast<uint16_t*>(m_commandBuffer.data()) = m_parameterBufferLength;
-          bytesWritten = m_serial.write(m_commandBuffer.data(), 2);
-          if (bytesWritten != 2) { return false; }
+          size_t headerLength = getCommandHeaderLength(m_protocol, m_parameterBufferLength);
+          writeCommandHeader(m_protocol, m_commandBuffer.data(), headerLength, in_commandCode, m_parameterBufferLength);
+          if (not m_isTransmitQueueEnabled) { return writePacket(headerLength); }
+
+          size_t packetLength = headerLength + m_parameterBufferLength + (m_isFramingEnabled ? g_frameSyncLength + g_frameChecksumLength : 0);
+          if (not reserveTransmit(packetLength)) { return false; }
+          writePacket(headerLength);
+          pumpTransmit();
+          return true;
+        }
+
+        // A dropped frame has not reached the GPU, so nothing may be assumed about the state it would have left behind.
+        void onTransmitFrameDropped()
+        {
+          ++m_droppedFrameCount;
+          if (m_isFramePacingEnabled) { --m_sentFrameNumber; }
+          m_isPreviousFrameValid = false; // the next retained frame is sent completely
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+        }
+
+        // Makes room for a packet of in_length bytes in the transmit ring, as m_transmitPolicy says.
+        // Returns false, if the packet must not be sent (TransmitPolicy::reportBackPressure).
+        bool reserveTransmit(size_t in_length)
+        {
+          pumpTransmit();
+          m_isTransmitBackPressured = m_transmitRing.getFreeLength() < in_length;
+          if (not m_isTransmitBackPressured) { return true; }
+
+          if (m_transmitPolicy == TransmitPolicy::reportBackPressure)
+          {
+            ++m_transmitBackPressureCount;
+            return false;
+          }
 
-          if (m_parameterBufferLength > 0)
+          if (m_transmitPolicy == TransmitPolicy::dropOldestFrame)
           {
-            bytesWritten = m_serial.write(m_parameterBuffer.data(), m_parameterBufferLength);
-            if (bytesWritten != m_parameterBufferLength) { return false; }
+            while (m_transmitRing.getFreeLength() < in_length && m_transmitRing.dropOldestFrame()) { onTransmitFrameDropped(); }
           }
 
+          while (m_transmitRing.getFreeLength() < in_length) { yield(); pumpTransmit(); }
+          m_isTransmitBackPressured = false;
           return true;
         }
 
@@ -61,11 +294,70 @@ namespace halvoeGPU
           m_parameterBufferLength = 0;
         }
 
+        // In batch mode the command is appended to m_parameterBuffer (behind its own header),
+        // otherwise m_parameterBuffer holds only the parameters of this command.
+        // The batch is flushed first, if the command does not fit behind the already batched commands.
+        // in_maxParameterLength is an upper bound, because compact coordinates have a variable length.
+        bool beginCommand(SerialGFXCommandCode in_commandCode, size_t in_maxParameterLength)
+        {
+          m_commandCode = in_commandCode;
+          m_isCommandBatched = false;
+          m_fillRectCount = 0; // nothing can be added to the fillRects behind this command
+
+          if (m_isBatchEnabled)
+          {
+            size_t headerLength = getCommandHeaderLength(m_protocol, in_maxParameterLength);
+            size_t batchedCommandLength = getBatchedCommandLength(m_protocol, headerLength, in_maxParameterLength);
+
+            if (m_parameterBufferLength + batchedCommandLength > m_parameterBuffer.size())
+            {
+              if (not flushBatch()) { return false; }
+            }
+
+            if (batchedCommandLength <= m_parameterBuffer.size())
+            {
+              m_commandBegin = m_parameterBufferLength;
+              m_commandHeaderLength = headerLength;
+              m_parameterBufferLength = m_parameterBufferLength + headerLength; // header is written in endCommand()
+              m_isCommandBatched = true;
+              return true;
+            }
+          }
+
+          resetParameterBufferLength();
+          return true;
+        }
+
+        bool endCommand()
+        {
+          if (not m_isCommandBatched)
+          {
+            bool isSent = sendCommand(m_commandCode);
+            if (m_isBatchEnabled) { resetParameterBufferLength(); } // a command, which is too long for a batch, leaves the batch empty
+            return isSent;
+          }
+
+          uint16_t parameterLength = m_parameterBufferLength - m_commandBegin - m_commandHeaderLength;
+          writeCommandHeader(m_protocol, m_parameterBuffer.data() + m_commandBegin, m_commandHeaderLength, m_commandCode, parameterLength);
+          if (getBatchedCommandLength(m_protocol, m_commandHeaderLength, parameterLength) > m_commandHeaderLength + parameterLength)
+          {
+            addUInt8ToBuffer(0); // padding, see getBatchedCommandLength()
+          }
+
+          m_isCommandBatched = false;
+          return true;
+        }
+
+        size_t getStringParameterLength(const char* in_string)
+        {
+          return halvoeCString::getLength(in_string, g_maxParameterBufferLength) + g_zeroTerminatorLength;
+        }
+
         template<typename ValueType>
         bool setValueInBufferAt(ValueType in_value, uint16_t in_position)
         {
-          if (m_parameterBufferLength + sizeof(ValueType) > m_parameterBuffer.size()) { return false; }
-          *reinterpret_cast<ValueType*>(m_parameterBuffer.data() + in_position) = in_value;
+          if (in_position + sizeof(ValueType) > m_parameterBuffer.size()) { return false; }
+          writeValue<ValueType>(in_value, m_parameterBuffer.data() + in_position);
           return true;
         }
 
@@ -111,12 +403,27 @@ namespace halvoeGPU
           return true;
         }
 
+        bool addUInt32ToBuffer(uint32_t in_value)
+        {
+          if (not setValueInBufferAt<uint32_t>(in_value, m_parameterBufferLength)) { return false; }
+          m_parameterBufferLength = m_parameterBufferLength + sizeof(uint32_t);
+          return true;
+        }
+
+        bool addBytesToBuffer(const uint8_t* in_data, size_t in_length)
+        {
+          if (m_parameterBufferLength + in_length > m_parameterBuffer.size()) { return false; }
+          memcpy(m_parameterBuffer.data() + m_parameterBufferLength, in_data, in_length);
+          m_parameterBufferLength = m_parameterBufferLength + in_length;
+          return true;
+        }
+
         bool addStringToBuffer(const char* in_string)
         {
           size_t stringLength = halvoeCString::getLength(in_string, g_maxParameterBufferLength - m_parameterBufferLength) ;
           if (m_parameterBufferLength + stringLength + g_zeroTerminatorLength > m_parameterBuffer.size()) { return false; }
           
-          if (not halvoeCString::copy(in_string, m_parameterBuffer.data(), stringLength)) { return false; }
+          if (not halvoeCString::copy(in_string, m_parameterBuffer.data() + m_parameterBufferLength, stringLength)) { return false; }
           #ifdef HALVOE_GPU_DEBUG_ADD_STRING
             Serial.println(m_parameterBuffer.data() + m_parameterBufferLength);
           #endif // HALVOE_GPU_DEBUG_ADD_STRING
@@ -139,135 +446,1649 @@ namespace halvoeGPU
           return true;
         }
 
-      public:
-        SerialGFXInterface(HALVOE_SERIAL_TYPE& io_serial) :
-          m_serial(io_serial), m_helperGFX(g_screenWidth, g_screenHeight)
-        {}
+        // The room for the parameters has to be reserved by beginCommand(), with t_Schema::getMaxLength(m_protocol) or more.
+        template<typename t_Schema, typename... t_ValueTypes>
+        void addParametersToBuffer(t_ValueTypes... in_values)
+        {
+          m_parameterBufferLength = m_parameterBufferLength + t_Schema::encode(m_parameterBuffer.data() + m_parameterBufferLength, m_protocol, in_values...);
+        }
 
-        bool begin(SerialGFXBaud in_baud = SerialGFXBaud::Default)
+        // one bounds check (in beginCommand()) for all parameters of the command
+        template<typename t_Schema, typename... t_ValueTypes>
+        bool writeCommand(t_ValueTypes... in_values)
         {
-          pinMode(READY_PIN, INPUT);
-          m_serial.begin(fromSerialGFXBaud(in_baud));
-          elapsedMillis timeSinceBegin;
-          while (not m_serial && timeSinceBegin < 10000) {}
-          return m_serial;
+          if (not beginCommand(t_Schema::s_commandCode, t_Schema::getMaxLength(m_protocol))) { return false; }
+          addParametersToBuffer<t_Schema>(in_values...);
+          return endCommand();
         }
 
-        bool isGPUReady()
+        bool writeSwap(bool in_isCopyFramebuffer)
         {
-          return digitalRead(READY_PIN) == HIGH;
+          if (m_isMacroRecording) { m_isMacroFailed = true; return false; } // a frame does not end inside of a macro
+          if (not beginCommand(SerialGFXCommandCode::swap, in_isCopyFramebuffer ? sizeof(uint8_t) : 0)) { return false; }
+          if (in_isCopyFramebuffer) { addUInt8ToBuffer(1); } // the new back buffer starts as a copy of the displayed frame
+          if (not endCommand()) { return false; }
+          if (m_isFramePacingEnabled) { ++m_sentFrameNumber; }
+          // the GPU may draw its overlay (printFrameTime, printFPS) at the swap, with its own text color and cursor
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+          if (not flushBatch()) { return false; } // a swap ends the frame, so there is no reason to hold back the batch any longer
+          if (m_isTransmitQueueEnabled) { m_transmitRing.markFrameEnd(); }
+          return true;
         }
 
-        void getTextBounds(const char* in_string, int16_t in_x, int16_t in_y,
-                           int16_t* out_x, int16_t* out_y, uint16_t* out_width, uint16_t* out_height)
+        bool writeFillScreen(uint16_t in_color)
         {
-          m_helperGFX.getTextBounds(in_string, in_x, in_y, out_x, out_y, out_width, out_height);
+          return writeCommand<FillScreenSchema>(in_color);
         }
 
-        void getTextBounds(const String& in_string, int16_t in_x, int16_t in_y,
-                           int16_t* out_x, int16_t* out_y, uint16_t* out_width, uint16_t* out_height)
+        // the bytes a command with in_parameterLength bytes of parameters takes on the link, as a packet of its own or in the batch
+        size_t getCommandWireLength(size_t in_parameterLength) const
         {
-          m_helperGFX.getTextBounds(in_string, in_x, in_y, out_x, out_y, out_width, out_height);
+          size_t headerLength = getCommandHeaderLength(m_protocol, in_parameterLength);
+          if (m_isBatchEnabled) { return getBatchedCommandLength(m_protocol, headerLength, in_parameterLength); }
+          return headerLength + in_parameterLength + (m_isFramingEnabled ? g_frameSyncLength + g_frameChecksumLength : 0);
         }
 
-        bool sendSwap()
+        template<typename t_Schema, typename... t_ValueTypes>
+        size_t getCommandWireLength(t_ValueTypes... in_values) const
         {
-          resetParameterBufferLength();
-          return sendCommand(SerialGFXCommandCode::swap);
+          char parameters[t_Schema::getMaxLength()];
+          return getCommandWireLength(t_Schema::encode(parameters, m_protocol, in_values...));
         }
 
-        bool sendFillScreen(uint16_t in_color)
+        // Adds a rectangle to the fillRect(s) command at the end of the batch, which is written again as fillRects.
+        bool addFillRect(const Rect& in_rect)
         {
-          resetParameterBufferLength();
-          addUInt16ToBuffer(in_color);
-          return sendCommand(SerialGFXCommandCode::fillScreen);
+          size_t fillRectCount = m_fillRectCount;
+          size_t previousLength = m_parameterBufferLength - m_fillRectsBegin;
+          m_fillRects[fillRectCount++] = in_rect;
+
+          m_parameterBufferLength = m_fillRectsBegin;
+          if (not beginCommand(SerialGFXCommandCode::fillRects, FillRectsSchema::getMaxLength(m_protocol) + fillRectCount * FillRectsRectSchema::getMaxLength(m_protocol)))
+          {
+            return false;
+          }
+
+          size_t fillRectsBegin = m_commandBegin; // moves to the front, if beginCommand() has flushed the batch
+          addParametersToBuffer<FillRectsSchema>(m_fillRectsColor);
+          for (size_t index = 0; index < fillRectCount; ++index)
+          {
+            const Rect& rect = m_fillRects[index];
+            addParametersToBuffer<FillRectsRectSchema>(rect.x, rect.y, rect.width, rect.height);
+          }
+
+          if (not endCommand()) { return false; }
+          m_savedByteCount = m_savedByteCount + getCommandWireLength<FillRectSchema>(in_rect.x, in_rect.y, in_rect.width, in_rect.height, m_fillRectsColor)
+                                              - (m_parameterBufferLength - fillRectsBegin - previousLength);
+          m_fillRectsBegin = fillRectsBegin;
+          m_fillRectCount = fillRectCount;
+          return true;
         }
 
-        bool sendFillRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
+        // Consecutive fillRects with the same color are merged in the batch (outside of a batch every command is sent as it comes).
+        bool writeFillRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
         {
-          resetParameterBufferLength();
-          addInt16ToBuffer(in_x);
-          addInt16ToBuffer(in_y);
-          addInt16ToBuffer(in_width);
-          addInt16ToBuffer(in_height);
-          addUInt16ToBuffer(in_color);
-          return sendCommand(SerialGFXCommandCode::fillRect);
+          if (m_isBatchEnabled && not m_isMacroRecording && m_fillRectCount > 0 && m_fillRectCount < m_fillRects.size() && m_fillRectsColor == in_color)
+          {
+            return addFillRect(Rect{ in_x, in_y, in_width, in_height });
+          }
+
+          if (not writeCommand<FillRectSchema>(in_x, in_y, in_width, in_height, in_color)) { return false; }
+          if (not m_isBatchEnabled) { return true; }
+
+          m_fillRects[0] = Rect{ in_x, in_y, in_width, in_height };
+          m_fillRectCount = 1;
+          m_fillRectsColor = in_color;
+          m_fillRectsBegin = m_commandBegin;
+          return true;
         }
 
-        bool sendDrawRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
+        bool writeDrawRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
         {
-          resetParameterBufferLength();
-          addInt16ToBuffer(in_x);
-          addInt16ToBuffer(in_y);
-          addInt16ToBuffer(in_width);
-          addInt16ToBuffer(in_height);
-          addUInt16ToBuffer(in_color);
-          return sendCommand(SerialGFXCommandCode::drawRect);
+          return writeCommand<DrawRectSchema>(in_x, in_y, in_width, in_height, in_color);
         }
 
-        bool sendSetFont(SerialGFXFont in_font)
+        bool writeSetFont(SerialGFXFont in_font)
         {
-          GFXfont* fontPointer = nullptr;
-          if (not getFontPointer(in_font, fontPointer)) { return false; }
-          m_helperGFX.setFont(fontPointer); // set for getTextBounds() atCPU
+          return writeCommand<SetFontSchema>(fromSerialGFXFont(in_font));
+        }
 
-          resetParameterBufferLength();
-          addUInt8ToBuffer(fromSerialGFXFont(in_font));
-          return sendCommand(SerialGFXCommandCode::setFont);
+        bool writeSetTextSize(uint8_t in_size)
+        {
+          return writeCommand<SetTextSizeSchema>(in_size);
         }
 
-        bool sendSetTextSize(uint8_t in_size)
+        bool writeSetTextColor(uint16_t in_color)
         {
-          m_helperGFX.setTextSize(in_size); // set for getTextBounds() atCPU
+          return writeCommand<SetTextColorSchema>(in_color);
+        }
 
-          resetParameterBufferLength();
-          addUInt8ToBuffer(in_size);
-          return sendCommand(SerialGFXCommandCode::setTextSize);
+        // in_prefixLength bytes of m_parameterBuffer (the cursor of printAt) are written in front of the string
+        template<typename... t_ValueTypes>
+        bool writeTextChunk(SerialGFXCommandCode in_commandCode, const char* in_string, size_t in_stringLength, size_t in_prefixLength = 0,
+                            t_ValueTypes... in_prefixValues)
+        {
+          if (not beginCommand(in_commandCode, in_prefixLength + in_stringLength + g_zeroTerminatorLength)) { return false; }
+          if constexpr (sizeof...(t_ValueTypes) > 0) { addParametersToBuffer<PrintAtSchema>(in_prefixValues...); }
+          addBytesToBuffer(reinterpret_cast<const uint8_t*>(in_string), in_stringLength);
+          addUInt8ToBuffer(0);
+          return endCommand();
         }
 
-        bool sendSetTextColor(uint16_t in_color)
+        // A string, which does not fit into one packet, is sent in chunks of g_maxTextChunkLength: the GPU prints each at the cursor,
+        // where the previous one ended, so they are drawn like one print. The line break of println goes with the last chunk.
+        bool writeText(SerialGFXCommandCode in_commandCode, const char* in_string)
         {
-          resetParameterBufferLength();
-          addUInt16ToBuffer(in_color);
-          return sendCommand(SerialGFXCommandCode::setTextColor);
+          size_t stringLength = strlen(in_string);
+          for (; stringLength > g_maxTextChunkLength; stringLength = stringLength - g_maxTextChunkLength, in_string = in_string + g_maxTextChunkLength)
+          {
+            if (not writeTextChunk(SerialGFXCommandCode::print, in_string, g_maxTextChunkLength)) { return false; }
+          }
+
+          return writeTextChunk(in_commandCode, in_string, stringLength);
         }
 
-        bool sendSetCursor(int16_t in_x, int16_t in_y)
+        // Sends the text state, as far as the GPU does not have it, and the text. If in_isCursorSet, the text is drawn at in_x, in_y:
+        // the cursor goes with it (printAt, printlnAt) instead of in a setCursor of its own, unless the GPU already has it.
+        bool writeTextAt(SerialGFXCommandCode in_commandCode, const char* in_string, const TextState& in_textState,
+                         bool in_isCursorSet, int16_t in_x, int16_t in_y)
         {
-          m_helperGFX.setCursor(in_x, in_y); // set for getTextBounds() atCPU
+          if (not writeTextState(in_textState)) { return false; }
+          if (not in_isCursorSet) { return writeText(in_commandCode, in_string); }
 
-          resetParameterBufferLength();
-          addInt16ToBuffer(in_x);
-          addInt16ToBuffer(in_y);
-          return sendCommand(SerialGFXCommandCode::setCursor);
+          char cursor[PrintAtSchema::getMaxLength()];
+          size_t cursorLength = PrintAtSchema::encode(cursor, m_protocol, in_x, in_y); // as long as the parameters of setCursor
+          if (m_isGPUCursorKnown && m_gpuCursorX == in_x && m_gpuCursorY == in_y)
+          {
+            if (not m_isRetainedModeEnabled) { m_savedByteCount = m_savedByteCount + getCommandWireLength(cursorLength); }
+            return writeText(in_commandCode, in_string);
+          }
+
+          size_t stringLength = getStringParameterLength(in_string);
+          m_savedByteCount = m_savedByteCount + getCommandWireLength(cursorLength) + getCommandWireLength(stringLength) - getCommandWireLength(cursorLength + stringLength);
+
+          SerialGFXCommandCode commandCode = in_commandCode == SerialGFXCommandCode::println ? SerialGFXCommandCode::printlnAt : SerialGFXCommandCode::printAt;
+          size_t firstChunkLength = strlen(in_string);
+          if (firstChunkLength <= g_maxTextChunkLength) { return writeTextChunk(commandCode, in_string, firstChunkLength, cursorLength, in_x, in_y); }
+
+          // the cursor goes with the first chunk, the rest continues at the cursor
+          if (not writeTextChunk(SerialGFXCommandCode::printAt, in_string, g_maxTextChunkLength, cursorLength, in_x, in_y)) { return false; }
+          return writeText(in_commandCode, in_string + g_maxTextChunkLength);
         }
 
-        bool sendPrint(const char* in_string)
+        // the fields of the commands, to which a macro slot can be bound, in v1
+        static bool getMacroFieldLayout(SerialGFXCommandCode in_commandCode, size_t in_fieldIndex, size_t& out_offset, size_t& out_length)
         {
-          resetParameterBufferLength();
-          addStringToBuffer(in_string);
-          return sendCommand(SerialGFXCommandCode::print);
+          switch (in_commandCode)
+          {
+            case SerialGFXCommandCode::fillScreen:   return FillScreenSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::fillRect:     return FillRectSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::drawRect:     return DrawRectSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::setFont:      return SetFontSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::setTextSize:  return SetTextSizeSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::setTextColor: return SetTextColorSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::drawSprite:   return DrawSpriteSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+            case SerialGFXCommandCode::printAt:
+            case SerialGFXCommandCode::printlnAt:    return PrintAtSchema::getFieldLayout(in_fieldIndex, SerialGFXProtocol::v1, out_offset, out_length);
+
+            default: return false;
+          }
         }
 
-        bool sendPrintln(const char* in_string)
+        // The encoder writes into blitData commands of up to g_maxBlitDataChunkLength bytes.
+        class BlitDataSink
         {
-          resetParameterBufferLength();
-          addStringToBuffer(in_string);
-          return sendCommand(SerialGFXCommandCode::println);
+          private:
+            SerialGFXInterface& m_interface;
+
+          public:
+            BlitDataSink(SerialGFXInterface& io_interface) : m_interface(io_interface)
+            {}
+
+            bool write(const uint8_t* in_data, size_t in_length)
+            {
+              return m_interface.addBlitData(in_data, in_length);
+            }
+        };
+
+        bool addBlitData(const uint8_t* in_data, size_t in_length)
+        {
+          while (in_length > 0)
+          {
+            if (not m_isBlitDataCommandOpen)
+            {
+              if (not beginCommand(SerialGFXCommandCode::blitData, g_maxBlitDataChunkLength)) { return false; }
+              m_blitDataCommandEnd = m_parameterBufferLength + g_maxBlitDataChunkLength;
+              m_isBlitDataCommandOpen = true;
+            }
+
+            size_t chunkLength = min(in_length, m_blitDataCommandEnd - m_parameterBufferLength);
+            if (not addBytesToBuffer(in_data, chunkLength)) { return false; }
+            in_data = in_data + chunkLength;
+            in_length = in_length - chunkLength;
+
+            if (m_parameterBufferLength == m_blitDataCommandEnd)
+            {
+              m_isBlitDataCommandOpen = false;
+              if (not endCommand()) { return false; }
+            }
+          }
+
+          return true;
         }
 
-        bool sendPrint(const String& in_string)
+        bool writeBlitData(const uint8_t* in_pixels, size_t in_count, SerialGFXBlitCodec in_codec)
+        {
+          BlitDataSink sink(*this);
+          m_isBlitDataCommandOpen = false;
+          bool isEncoded = m_blitEncoder.encode(in_codec, in_pixels, in_count, sink);
+          if (not m_isBlitDataCommandOpen) { return isEncoded; }
+
+          m_isBlitDataCommandOpen = false;
+          return endCommand() && isEncoded;
+        }
+
+        bool writeBlit(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels, SerialGFXBlitCodec in_codec)
+        {
+          if (in_pixels == nullptr || in_width <= 0 || in_height <= 0) { return false; }
+
+          if (not writeCommand<BlitBeginSchema>(in_x, in_y, in_width, in_height, static_cast<uint8_t>(in_codec))) { return false; }
+
+          return writeBlitData(in_pixels, static_cast<size_t>(in_width) * in_height, in_codec);
+        }
+
+        bool writeBlit(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels)
+        {
+          if (in_pixels == nullptr || in_width <= 0 || in_height <= 0) { return false; }
+          SerialGFXBlitCodec codec = m_blitEncoder.getBestCodec(in_pixels, static_cast<size_t>(in_width) * in_height);
+          return writeBlit(in_x, in_y, in_width, in_height, in_pixels, codec);
+        }
+
+        bool writeUploadSprite(uint8_t in_spriteID, int16_t in_width, int16_t in_height, const uint8_t* in_pixels, SerialGFXBlitCodec in_codec)
+        {
+          if (in_pixels == nullptr || in_width <= 0 || in_height <= 0) { return false; }
+
+          if (not writeCommand<UploadSpriteSchema>(in_spriteID, in_width, in_height, static_cast<uint8_t>(in_codec))) { return false; }
+
+          SpriteInfo& sprite = m_sprites[in_spriteID];
+          sprite.width = in_width;
+          sprite.height = in_height;
+          ++sprite.uploadCount;
+          sprite.isResident = true; // until the GPU reports, that it is evicted
+          return writeBlitData(in_pixels, static_cast<size_t>(in_width) * in_height, in_codec);
+        }
+
+        bool writeDrawSprite(uint8_t in_spriteID, int16_t in_x, int16_t in_y, bool in_isTransparent, uint8_t in_transparentColor)
+        {
+          if (not beginCommand(SerialGFXCommandCode::drawSprite, DrawSpriteSchema::getMaxLength(m_protocol) + sizeof(uint8_t))) { return false; }
+          addParametersToBuffer<DrawSpriteSchema>(in_spriteID, in_x, in_y);
+          if (in_isTransparent) { addUInt8ToBuffer(in_transparentColor); }
+          return endCommand();
+        }
+
+        void receiveSwapPresented(const char* in_payload)
+        {
+          SwapPresented swapPresented;
+          swapPresented.frameNumber = readValue<uint32_t>(in_payload);
+          swapPresented.presentMicros = readValue<uint32_t>(in_payload + sizeof(uint32_t));
+          swapPresented.renderMicros = readValue<uint32_t>(in_payload + 2 * sizeof(uint32_t));
+
+          // a frame, which came later than the vertical blank behind its predecessor, has missed vertical blanks
+          if (m_swapPresented.frameNumber != 0 && swapPresented.frameNumber == m_swapPresented.frameNumber + 1)
+          {
+            uint32_t vblankCount = (swapPresented.presentMicros - m_swapPresented.presentMicros + g_dviFramePeriodMicros / 2) / g_dviFramePeriodMicros;
+            if (vblankCount > 1) { m_missedVBlankCount = m_missedVBlankCount + vblankCount - 1; }
+          }
+
+          m_swapPresented = swapPresented;
+        }
+
+        void handleResponse(SerialGFXResponseCode in_responseCode, const uint8_t* in_payload, uint8_t in_payloadLength)
+        {
+          switch (in_responseCode)
+          {
+            case SerialGFXResponseCode::spriteEvicted:
+              if (in_payloadLength >= sizeof(uint8_t)) { m_sprites[in_payload[0]].isResident = false; }
+              break;
+
+            case SerialGFXResponseCode::spriteMissing:
+              if (in_payloadLength >= sizeof(uint8_t)) { m_sprites[in_payload[0]].isResident = false; }
+              m_isPreviousFrameValid = false; // the GPU has not drawn the sprite, so the next retained frame is sent completely
+              break;
+
+            case SerialGFXResponseCode::credit:
+              // a count from before the last resetCredits would grant credits for bytes, which the GPU has not read
+              if (in_payloadLength >= sizeof(uint32_t) && not m_isCreditResetPending)
+              {
+                m_gpuReceivedByteCount = readValue<uint32_t>(reinterpret_cast<const char*>(in_payload));
+              }
+              break;
+
+            case SerialGFXResponseCode::creditReset:
+              m_isCreditResetPending = false;
+              break;
+
+            case SerialGFXResponseCode::baudChanged:
+              if (in_payloadLength >= sizeof(uint32_t)) { m_acknowledgedBaud = readValue<uint32_t>(reinterpret_cast<const char*>(in_payload)); }
+              break;
+
+            case SerialGFXResponseCode::linkTested:
+              if (in_payloadLength >= sizeof(uint8_t) + sizeof(uint16_t))
+              {
+                m_receivedLinkTestSequence = in_payload[0];
+                m_receivedLinkTestErrorCount = readValue<uint16_t>(reinterpret_cast<const char*>(in_payload) + sizeof(uint8_t));
+                m_isLinkTestReceived = true;
+              }
+              break;
+
+            case SerialGFXResponseCode::linkErrors:
+              if (in_payloadLength >= sizeof(uint16_t))
+              {
+                uint16_t reportedLinkErrorCount = readValue<uint16_t>(reinterpret_cast<const char*>(in_payload));
+                m_linkErrorCount = m_linkErrorCount + static_cast<uint16_t>(reportedLinkErrorCount - m_reportedLinkErrorCount);
+                m_reportedLinkErrorCount = reportedLinkErrorCount;
+              }
+
+              if (m_isBaudAutoFallbackEnabled && m_linkErrorCount - m_linkErrorCountAtBaud >= g_baudFallbackErrorCount) { m_isBaudFallbackPending = true; }
+              break;
+
+            case SerialGFXResponseCode::swapPresented:
+              if (in_payloadLength >= 3 * sizeof(uint32_t)) { receiveSwapPresented(reinterpret_cast<const char*>(in_payload)); }
+              break;
+
+            case SerialGFXResponseCode::stats:
+              {
+                uint8_t sequence = 0;
+                GPUStatsSection section = GPUStatsSection::commands;
+                if (not m_gpuStats.readSection(in_payload, in_payloadLength, sequence, section)) { break; }
+                if (section == GPUStatsSection::totals && sequence == m_gpuStatsSequence) { m_isGPUStatsReceived = true; } // the last section
+              }
+              break;
+
+            case SerialGFXResponseCode::invalid: // an unknown code from a newer GPU, its payload is skipped
+              break;
+          }
+        }
+
+        // sends one testLink and returns true, if the GPU has received its pattern intact
+        bool testLink()
         {
+          ++m_linkTestSequence;
           resetParameterBufferLength();
-          addStringToBuffer(in_string);
-          return sendCommand(SerialGFXCommandCode::print);
+          addUInt8ToBuffer(m_linkTestSequence);
+          for (size_t index = 0; index < g_linkTestPatternLength; ++index) { addUInt8ToBuffer(getLinkTestByte(m_linkTestSequence, index)); }
+
+          m_isLinkTestReceived = false;
+          bool isSent = sendCommand(SerialGFXCommandCode::testLink);
+          resetParameterBufferLength();
+          if (not isSent) { return false; }
+          flushTransmit();
+
+          elapsedMillis timeSinceTest;
+          while (not m_isLinkTestReceived && timeSinceTest < g_baudProbeTimeoutMillis) { yield(); receiveResponses(); }
+          return m_isLinkTestReceived && m_receivedLinkTestSequence == m_linkTestSequence && m_receivedLinkTestErrorCount == 0;
         }
 
-        bool sendPrintln(const String& in_string)
+        // The GPU returns to the previous baud by itself, when no testLink passes within g_baudProbeTimeoutMillis.
+        // We wait for that, then everything received at the other baud is discarded.
+        void fallBackBaud(unsigned long in_baud)
+        {
+          m_serial.flush();
+          m_serial.begin(in_baud);
+          m_baud = in_baud;
+          ++m_baudFallbackCount;
+
+          elapsedMillis timeSinceFallback;
+          while (timeSinceFallback < 2 * g_baudProbeTimeoutMillis)
+          {
+            while (m_serial.available() > 0) { m_serial.read(); }
+            yield();
+          }
+
+          m_receivedResponseLength = 0;
+        }
+
+        // Steps down the ladder, until a baud passes its testLink.
+        void stepDownBaud()
+        {
+          m_isBaudFallbackPending = false;
+          for (size_t index = getBaudLadderIndex(m_baud); index > 0 && index < g_baudLadderLength; --index)
+          {
+            if (changeBaud(g_baudLadder[index - 1])) { return; }
+          }
+        }
+
+        bool retainCommand(const RetainedCommand& in_command, const char* in_string = nullptr)
+        {
+          if (not m_isRetainedFrameOverflowed)
+          {
+            if (m_currentFrame->addCommand(in_command, in_string)) { return true; }
+
+            // The frame does not fit, so the rest of it is sent as it comes and the next frame is sent completely.
+            m_isRetainedFrameOverflowed = true;
+            if (not sendRetainedFrameCompletely(*m_currentFrame)) { return false; }
+          }
+
+          return sendRetainedCommand(in_command, in_string, nullptr);
+        }
+
+        bool retainRectCommand(SerialGFXCommandCode in_commandCode, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
+        {
+          RetainedCommand command;
+          command.commandCode = in_commandCode;
+          command.rect = Rect{ in_x, in_y, in_width, in_height };
+          command.color = in_color;
+          command.bounds = getRectCommandBounds(in_x, in_y, in_width, in_height);
+          return retainCommand(command);
+        }
+
+        bool retainBlitCommand(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels,
+                               SerialGFXBlitCodec in_codec, bool in_isBestCodec)
+        {
+          if (in_pixels == nullptr || in_width <= 0 || in_height <= 0) { return false; }
+
+          RetainedCommand command;
+          command.commandCode = SerialGFXCommandCode::blitBegin;
+          command.rect = Rect{ in_x, in_y, in_width, in_height };
+          command.bounds = getIntersection(command.rect, getScreenRect());
+          command.pixels = in_pixels;
+          command.pixelHash = getPixelHash(in_pixels, static_cast<size_t>(in_width) * in_height);
+          command.blitCodec = in_codec;
+          command.isBestBlitCodec = in_isBestCodec;
+          return retainCommand(command);
+        }
+
+        bool retainDrawSpriteCommand(uint8_t in_spriteID, int16_t in_x, int16_t in_y, bool in_isTransparent, uint8_t in_transparentColor)
+        {
+          const SpriteInfo& sprite = m_sprites[in_spriteID];
+
+          RetainedCommand command;
+          command.commandCode = SerialGFXCommandCode::drawSprite;
+          command.rect = Rect{ in_x, in_y, sprite.width, sprite.height };
+          command.bounds = getIntersection(command.rect, getScreenRect());
+          command.color = in_transparentColor;
+          command.spriteID = in_spriteID;
+          command.isTransparent = in_isTransparent;
+          command.pixelHash = sprite.uploadCount; // so a sprite, which is uploaded again, is drawn again
+          return retainCommand(command);
+        }
+
+        bool sendText(SerialGFXCommandCode in_commandCode, const char* in_string)
+        {
+          if (m_isRetainedModeEnabled) { return retainTextCommand(in_commandCode, in_string); }
+
+          bool isCursorPending = m_isCursorPending;
+          m_isCursorPending = false;
+          if (not writeTextAt(in_commandCode, in_string, m_textState, isCursorPending, m_helperGFX.getCursorX(), m_helperGFX.getCursorY())) { return false; }
+          m_isGPUCursorKnown = false; // the text has moved it, atCPU does not follow it outside of the retained mode
+          return true;
+        }
+
+        bool retainTextCommand(SerialGFXCommandCode in_commandCode, const char* in_string)
         {
+          RetainedCommand command;
+          command.commandCode = in_commandCode;
+          command.textState = m_textState;
+          command.rect = Rect{ m_helperGFX.getCursorX(), m_helperGFX.getCursorY(), 0, 0 };
+
+          TextBounds bounds = getTextBounds(in_string, command.rect.x, command.rect.y);
+          command.bounds = getIntersection(Rect{ bounds.x, bounds.y, static_cast<int16_t>(bounds.width), static_cast<int16_t>(bounds.height) }, getScreenRect());
+
+          // the helper moves the cursor like the GPU does, so the next print starts at the right position
+          if (in_commandCode == SerialGFXCommandCode::println) { m_helperGFX.println(in_string); }
+          else { m_helperGFX.print(in_string); }
+          command.endCursorX = m_helperGFX.getCursorX();
+          command.endCursorY = m_helperGFX.getCursorY();
+
+          return retainCommand(command, in_string);
+        }
+
+        // The text state is sent with the text, only as far as it differs from the one of the GPU.
+        // The sendSet*() calls count as saved bytes in the immediate mode, what is sent here is deducted.
+        bool writeTextState(const TextState& in_textState)
+        {
+          bool isCounted = not m_isRetainedModeEnabled;
+
+          if (not m_isGPUTextStateKnown || m_gpuTextState.font != in_textState.font)
+          {
+            if (not writeSetFont(in_textState.font)) { return false; }
+            if (isCounted) { m_savedByteCount = m_savedByteCount - getCommandWireLength<SetFontSchema>(fromSerialGFXFont(in_textState.font)); }
+            m_isGPUCursorKnown = false; // Adafruit_GFX::setFont() moves the cursor between top-left and baseline
+          }
+
+          if (not m_isGPUTextStateKnown || m_gpuTextState.size != in_textState.size)
+          {
+            if (not writeSetTextSize(in_textState.size)) { return false; }
+            if (isCounted) { m_savedByteCount = m_savedByteCount - getCommandWireLength<SetTextSizeSchema>(in_textState.size); }
+          }
+
+          if (not m_isGPUTextStateKnown || m_gpuTextState.color != in_textState.color)
+          {
+            if (not writeSetTextColor(in_textState.color)) { return false; }
+            if (isCounted) { m_savedByteCount = m_savedByteCount - getCommandWireLength<SetTextColorSchema>(in_textState.color); }
+          }
+
+          m_gpuTextState = in_textState;
+          m_isGPUTextStateKnown = true;
+          return true;
+        }
+
+        // Sends in_command completely if in_region is nullptr, otherwise clippable commands only inside in_region.
+        bool sendRetainedCommand(const RetainedCommand& in_command, const char* in_string, const DirtyRegion* in_region)
+        {
+          if (in_command.isText())
+          {
+            if (not writeTextAt(in_command.commandCode, in_string, in_command.textState, true, in_command.rect.x, in_command.rect.y)) { return false; }
+            m_gpuCursorX = in_command.endCursorX;
+            m_gpuCursorY = in_command.endCursorY;
+            m_isGPUCursorKnown = true;
+            return true;
+          }
+
+          if (in_region == nullptr || not in_command.isClippable() || in_region->contains(in_command.bounds))
+          {
+            switch (in_command.commandCode)
+            {
+              case SerialGFXCommandCode::fillScreen: return writeFillScreen(in_command.color);
+              case SerialGFXCommandCode::fillRect:   return writeFillRect(in_command.rect.x, in_command.rect.y, in_command.rect.width, in_command.rect.height, in_command.color);
+              case SerialGFXCommandCode::drawRect:   return writeDrawRect(in_command.rect.x, in_command.rect.y, in_command.rect.width, in_command.rect.height, in_command.color);
+              case SerialGFXCommandCode::blitBegin:
+                if (in_command.isBestBlitCodec) { return writeBlit(in_command.rect.x, in_command.rect.y, in_command.rect.width, in_command.rect.height, in_command.pixels); }
+                return writeBlit(in_command.rect.x, in_command.rect.y, in_command.rect.width, in_command.rect.height, in_command.pixels, in_command.blitCodec);
+              case SerialGFXCommandCode::drawSprite: return writeDrawSprite(in_command.spriteID, in_command.rect.x, in_command.rect.y, in_command.isTransparent, in_command.color);
+              default: return false;
+            }
+          }
+
+          for (size_t index = 0; index < in_region->getRectCount(); ++index)
+          {
+            const Rect& dirtyRect = in_region->getRect(index);
+            if (not dirtyRect.intersects(in_command.bounds)) { continue; }
+
+            std::array<Rect, g_maxClippedRectCount> clippedRects;
+            size_t clippedRectCount = in_command.getClippedRects(dirtyRect, clippedRects);
+            for (size_t clippedIndex = 0; clippedIndex < clippedRectCount; ++clippedIndex)
+            {
+              const Rect& clippedRect = clippedRects[clippedIndex];
+              if (not writeFillRect(clippedRect.x, clippedRect.y, clippedRect.width, clippedRect.height, in_command.color)) { return false; }
+            }
+          }
+
+          return true;
+        }
+
+        // the number of commands sendRetainedCommand() sends for in_command (without text state and cursor)
+        size_t getRetainedCommandCount(const RetainedCommand& in_command, const DirtyRegion& in_region) const
+        {
+          if (not in_command.isClippable() || in_region.contains(in_command.bounds)) { return 1; }
+
+          size_t commandCount = 0;
+          std::array<Rect, g_maxClippedRectCount> clippedRects;
+          for (size_t index = 0; index < in_region.getRectCount(); ++index)
+          {
+            commandCount = commandCount + in_command.getClippedRects(in_region.getRect(index), clippedRects);
+          }
+
+          return commandCount;
+        }
+
+        bool sendRetainedFrameCompletely(const RetainedFrame& in_frame)
+        {
+          for (size_t index = 0; index < in_frame.getCommandCount(); ++index)
+          {
+            const RetainedCommand& command = in_frame.getCommand(index);
+            if (not sendRetainedCommand(command, in_frame.getString(command), nullptr)) { return false; }
+          }
+
+          return true;
+        }
+
+        // Marks the commands, which are in both frames (in the same order), as matched.
+        void matchRetainedFrames()
+        {
+          for (size_t index = 0; index < m_previousFrame->getCommandCount(); ++index) { m_previousFrame->getCommand(index).isMatched = false; }
+          for (size_t index = 0; index < m_currentFrame->getCommandCount(); ++index) { m_currentFrame->getCommand(index).isMatched = false; }
+
+          size_t previousIndex = 0;
+
+          for (size_t currentIndex = 0; currentIndex < m_currentFrame->getCommandCount(); ++currentIndex)
+          {
+            size_t searchEnd = min(previousIndex + g_retainedMatchWindow, m_previousFrame->getCommandCount());
+
+            for (size_t searchIndex = previousIndex; searchIndex < searchEnd; ++searchIndex)
+            {
+              if (m_currentFrame->isSameCommand(currentIndex, *m_previousFrame, searchIndex))
+              {
+                m_currentFrame->getCommand(currentIndex).isMatched = true;
+                m_previousFrame->getCommand(searchIndex).isMatched = true;
+                previousIndex = searchIndex + 1;
+                break;
+              }
+            }
+          }
+        }
+
+        bool sendRetainedFrameDiff()
+        {
+          matchRetainedFrames();
+          m_dirtyRegion.clear();
+
+          for (size_t index = 0; index < m_previousFrame->getCommandCount(); ++index)
+          {
+            const RetainedCommand& command = m_previousFrame->getCommand(index);
+            if (not command.isMatched) { m_dirtyRegion.add(command.bounds); }
+          }
+
+          for (size_t index = 0; index < m_currentFrame->getCommandCount(); ++index)
+          {
+            const RetainedCommand& command = m_currentFrame->getCommand(index);
+            if (not command.isMatched) { m_dirtyRegion.add(command.bounds); }
+          }
+
+          // Commands, which cannot be clipped, are redrawn completely, so all of their pixels become dirty
+          // and every command touching those pixels has to be redrawn as well.
+          bool isRegionGrown = true;
+          while (isRegionGrown)
+          {
+            isRegionGrown = false;
+            for (size_t index = 0; index < m_currentFrame->getCommandCount(); ++index)
+            {
+              const RetainedCommand& command = m_currentFrame->getCommand(index);
+              if (command.isClippable() || not m_dirtyRegion.intersects(command.bounds)) { continue; }
+              if (m_dirtyRegion.add(command.bounds)) { isRegionGrown = true; }
+            }
+          }
+
+          // If much has changed, the clipped commands would need more bytes than the frame itself.
+          size_t diffCommandCount = 0;
+          for (size_t index = 0; index < m_currentFrame->getCommandCount(); ++index)
+          {
+            const RetainedCommand& command = m_currentFrame->getCommand(index);
+            if (m_dirtyRegion.intersects(command.bounds)) { diffCommandCount = diffCommandCount + getRetainedCommandCount(command, m_dirtyRegion); }
+          }
+
+          if (diffCommandCount >= m_currentFrame->getCommandCount()) { return sendRetainedFrameCompletely(*m_currentFrame); }
+
+          for (size_t index = 0; index < m_currentFrame->getCommandCount(); ++index)
+          {
+            const RetainedCommand& command = m_currentFrame->getCommand(index);
+            if (not m_dirtyRegion.intersects(command.bounds)) { continue; }
+            if (not sendRetainedCommand(command, m_currentFrame->getString(command), &m_dirtyRegion)) { return false; }
+          }
+
+          return true;
+        }
+
+        bool sendRetainedFrame()
+        {
+          bool isSent = true;
+          if (not m_isRetainedFrameOverflowed) // otherwise it is already sent
+          {
+            isSent = m_isPreviousFrameValid ? sendRetainedFrameDiff() : sendRetainedFrameCompletely(*m_currentFrame);
+          }
+
+          m_isPreviousFrameValid = isSent && not m_isRetainedFrameOverflowed;
+          m_isRetainedFrameOverflowed = false;
+          std::swap(m_previousFrame, m_currentFrame);
+          m_currentFrame->clear();
+
+          if (not isSent) { return false; }
+          return writeSwap(true);
+        }
+
+      public:
+        SerialGFXInterface(HALVOE_SERIAL_TYPE& io_serial) :
+          m_serial(io_serial), m_helperGFX(g_screenWidth, g_screenHeight)
+        {}
+
+        bool begin(SerialGFXBaud in_baud = SerialGFXBaud::Default)
+        {
+          pinMode(READY_PIN, INPUT);
+          m_serial.begin(fromSerialGFXBaud(in_baud));
+          m_baud = fromSerialGFXBaud(in_baud);
+          elapsedMillis timeSinceBegin;
+          while (not m_serial && timeSinceBegin < 10000) {}
+          return m_serial;
+        }
+
+        bool isGPUReady()
+        {
+          return digitalRead(READY_PIN) == HIGH;
+        }
+
+        TextBounds getTextBounds(const char* in_string, int16_t in_x, int16_t in_y)
+        {
+          TextBounds bounds;
+          if (m_textMetrics.getTextBounds(in_string, in_x, in_y, m_helperGFX.width(), bounds)) { return bounds; }
+          m_helperGFX.getTextBounds(in_string, in_x, in_y, &bounds.x, &bounds.y, &bounds.width, &bounds.height);
+          return bounds;
+        }
+
+        void getTextBounds(const char* in_string, int16_t in_x, int16_t in_y,
+                           int16_t* out_x, int16_t* out_y, uint16_t* out_width, uint16_t* out_height)
+        {
+          TextBounds bounds = getTextBounds(in_string, in_x, in_y);
+          if (out_x != nullptr) { *out_x = bounds.x; }
+          if (out_y != nullptr) { *out_y = bounds.y; }
+          if (out_width != nullptr) { *out_width = bounds.width; }
+          if (out_height != nullptr) { *out_height = bounds.height; }
+        }
+
+        void getTextBounds(const String& in_string, int16_t in_x, int16_t in_y,
+                           int16_t* out_x, int16_t* out_y, uint16_t* out_width, uint16_t* out_height)
+        {
+          getTextBounds(in_string.c_str(), in_x, in_y, out_x, out_y, out_width, out_height);
+        }
+
+        // measures in_count strings with the cursor at (in_x, in_y) each, for example the items of a menu
+        void getTextBounds(const char* const* in_strings, size_t in_count, int16_t in_x, int16_t in_y, TextBounds* out_bounds)
+        {
+          for (size_t index = 0; index < in_count; ++index)
+          {
+            out_bounds[index] = getTextBounds(in_strings[index], in_x, in_y);
+          }
+        }
+
+        unsigned long getTextMetricsHitCount() const
+        {
+          return m_textMetrics.getHitCount();
+        }
+
+        unsigned long getTextMetricsMissCount() const
+        {
+          return m_textMetrics.getMissCount();
+        }
+
+        bool isBatchEnabled() const
+        {
+          return m_isBatchEnabled;
+        }
+
+        // All following send*() calls are collected into one batch packet, until flushBatch() or endBatch() is called,
+        // the batch is full or a swap was added.
+        void beginBatch()
+        {
+          if (m_isBatchEnabled) { return; }
+          resetParameterBufferLength();
+          m_isBatchEnabled = true;
+        }
+
+        bool endBatch()
+        {
+          bool isFlushed = flushBatch();
+          m_isBatchEnabled = false;
+          return isFlushed;
+        }
+
+        bool flushBatch()
+        {
+          m_fillRectCount = 0;
+          if (m_isMacroRecording) { m_isMacroFailed = true; return false; } // the recorded commands are sent by endMacro() only
+          if (not m_isBatchEnabled || m_parameterBufferLength == 0) { return true; }
+          bool isSent = sendCommand(SerialGFXCommandCode::batch);
+          if (not isSent && m_isTransmitBackPressured) { return false; } // the batch is kept, so it can be flushed again
+          resetParameterBufferLength();
+          return isSent;
+        }
+
+        SerialGFXProtocol getProtocol() const
+        {
+          return m_protocol;
+        }
+
+        bool isFramingEnabled() const
+        {
+          return m_isFramingEnabled;
+        }
+
+        // With framing every packet (and every response) is sent with a sync word and a CRC16, so the receiver
+        // notices corrupted packets and finds the next packet after them. The command itself is sent without the new framing.
+        bool sendSetFraming(bool in_isEnabled)
+        {
+          if (not flushBatch()) { return false; }
+
+          resetParameterBufferLength();
+          addParametersToBuffer<SetFramingSchema>(in_isEnabled ? 1 : 0);
+          bool isSent = sendCommand(SerialGFXCommandCode::setFraming);
+          resetParameterBufferLength();
+          if (not isSent) { return false; }
+
+          m_isFramingEnabled = in_isEnabled;
+          m_receivedResponseLength = 0; // responses, which are sent before the GPU has switched, are discarded
+          return true;
+        }
+
+        // responses with an invalid checksum
+        unsigned long getCorruptedResponseCount() const
+        {
+          return m_corruptedResponseCount;
+        }
+
+        unsigned long getDiscardedResponseByteCount() const
+        {
+          return m_discardedResponseByteCount;
+        }
+
+        // Switches both sides to in_protocol. The command itself is still sent in the current protocol
+        // and never batched, because the GPU decodes every following packet header in the new protocol.
+        bool sendSetProtocol(SerialGFXProtocol in_protocol)
+        {
+          if (not flushBatch()) { return false; }
+
+          resetParameterBufferLength();
+          addParametersToBuffer<SetProtocolSchema>(static_cast<uint8_t>(in_protocol));
+          if (not sendCommand(SerialGFXCommandCode::setProtocol)) { return false; }
+          resetParameterBufferLength();
+
+          m_protocol = in_protocol;
+          return true;
+        }
+
+        // The GPU reports how many bytes it has read, atCPU sends at most g_creditWindowLength bytes ahead of that,
+        // so the receive ring of the GPU can not overrun at any baud rate. The READY_PIN only signals, that the GPU has booted.
+        // Returns false (and stays without credit flow control), if the GPU does not acknowledge within g_creditTimeoutMillis.
+        bool enableCreditFlowControl()
+        {
+          if (not flushBatch()) { return false; }
+          m_isCreditFlowControlEnabled = false;
+
+          resetParameterBufferLength();
+          if (not sendCommand(SerialGFXCommandCode::resetCredits)) { return false; }
+          flushTransmit(); // the bytes in front of resetCredits are not counted by the GPU any more
+
+          m_sentByteCount = 0;
+          m_gpuReceivedByteCount = 0;
+          m_isCreditResetPending = true;
+
+          elapsedMillis timeSinceReset;
+          while (m_isCreditResetPending && timeSinceReset < g_creditTimeoutMillis) { yield(); receiveResponses(); }
+          if (m_isCreditResetPending) { ++m_creditTimeoutCount; return false; }
+
+          m_isCreditFlowControlEnabled = true;
+          return true;
+        }
+
+        void disableCreditFlowControl()
+        {
+          m_isCreditFlowControlEnabled = false;
+        }
+
+        bool isCreditFlowControlEnabled() const
+        {
+          return m_isCreditFlowControlEnabled;
+        }
+
+        // the bytes, which can be sent without waiting for the GPU
+        size_t getCredits() const
+        {
+          uint32_t inFlightCount = m_sentByteCount - m_gpuReceivedByteCount;
+          if (inFlightCount >= g_creditWindowLength) { return 0; }
+          return g_creditWindowLength - inFlightCount;
+        }
+
+        // how often a write had to wait for credits
+        unsigned long getCreditWaitCount() const
+        {
+          return m_creditWaitCount;
+        }
+
+        // how often the credits did not come in time (the credit flow control is disabled then)
+        unsigned long getCreditTimeoutCount() const
+        {
+          return m_creditTimeoutCount;
+        }
+
+        // send*() encode the packets into a transmit ring of g_transmitRingLength bytes and return, pumpTransmit() hands them
+        // to the UART as far as it takes them without blocking. So atCPU computes the next frame, while the previous one is on the link.
+        // in_policy says, what happens, when a packet does not fit into the ring. Every send*() pumps, call pumpTransmit() from loop()
+        // as well, when atCPU has nothing to send for a while.
+        void enableTransmitQueue(TransmitPolicy in_policy = TransmitPolicy::block)
+        {
+          m_transmitPolicy = in_policy;
+          m_isTransmitQueueEnabled = true;
+          m_isTransmitBackPressured = false;
+        }
+
+        // sends the queued bytes first
+        void disableTransmitQueue()
+        {
+          flushTransmit();
+          m_isTransmitQueueEnabled = false;
+        }
+
+        bool isTransmitQueueEnabled() const
+        {
+          return m_isTransmitQueueEnabled;
+        }
+
+        // Writes as many queued bytes, as the UART (and the credits) take right now, and reads the responses.
+        void pumpTransmit()
+        {
+          receiveResponses();
+
+          while (not m_transmitRing.isEmpty())
+          {
+            size_t length = 0;
+            const char* bytes = m_transmitRing.getContiguous(length);
+            int availableLength = m_serial.availableForWrite();
+            if (availableLength <= 0) { return; }
+            length = min(length, static_cast<size_t>(availableLength));
+
+            if (m_isCreditFlowControlEnabled)
+            {
+              if (getCredits() == 0)
+              {
+                if (not m_isTransmitCreditWaiting)
+                {
+                  ++m_creditWaitCount;
+                  m_isTransmitCreditWaiting = true;
+                  m_timeSinceTransmitCreditWait = 0;
+                }
+
+                if (m_timeSinceTransmitCreditWait < g_creditTimeoutMillis) { return; }
+                ++m_creditTimeoutCount;
+                m_isCreditFlowControlEnabled = false;
+              }
+              else
+              {
+                length = min(length, getCredits());
+              }
+
+              m_isTransmitCreditWaiting = false;
+            }
+
+            size_t writtenLength = m_serial.write(bytes, length);
+            m_sentByteCount = m_sentByteCount + writtenLength;
+            m_transmitRing.consume(writtenLength);
+            if (writtenLength != length) { return; }
+          }
+        }
+
+        // waits, until the transmit ring is empty
+        void flushTransmit()
+        {
+          while (not m_transmitRing.isEmpty()) { yield(); pumpTransmit(); }
+        }
+
+        // the bytes, which are queued, but not written to the UART yet
+        size_t getQueuedTransmitLength() const
+        {
+          return m_transmitRing.getLength();
+        }
+
+        size_t getFreeTransmitLength() const
+        {
+          return m_transmitRing.getFreeLength();
+        }
+
+        // With TransmitPolicy::reportBackPressure, the last send*() has returned false, because its packet did not fit.
+        // A batch (with its swap) is kept then, flushBatch() sends it, once the link has taken enough bytes.
+        bool isTransmitBackPressured() const
+        {
+          return m_isTransmitBackPressured;
+        }
+
+        unsigned long getTransmitBackPressureCount() const
+        {
+          return m_transmitBackPressureCount;
+        }
+
+        // frames, which TransmitPolicy::dropOldestFrame has dropped from the transmit ring
+        unsigned long getDroppedFrameCount() const
+        {
+          return m_droppedFrameCount;
+        }
+
+        unsigned long getBaud() const
+        {
+          return m_baud;
+        }
+
+        // Records every following packet with a timestamp into io_trace (e.g. a File on an SD card), see halvoeTrace.hpp,
+        // host/replayTrace.cpp runs it through atGPU again. What the GPU already holds from before (sprites, macros,
+        // the framebuffer) is not in the trace, so for an exact replay the capture begins right behind begin().
+        // The text state and the retained frame are sent completely again, so the trace does not depend on them.
+        void beginCapture(Print& io_trace)
+        {
+          m_trace.begin(io_trace, TraceSide::cpu, m_protocol, m_isFramingEnabled, m_baud);
+          m_isPreviousFrameValid = false;
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+        }
+
+        void endCapture()
+        {
+          m_trace.end();
+        }
+
+        bool isCapturing() const
+        {
+          return m_trace.isEnabled();
+        }
+
+        // bytes of the trace, which the Print of beginCapture() did not take
+        unsigned long getCaptureLostByteCount() const
+        {
+          return m_trace.getLostByteCount();
+        }
+
+        // Switches both sides to in_baud: setBaud is acknowledged at the current baud, then both switch and
+        // g_baudProbeCount test patterns have to pass at in_baud. Otherwise both return to the current baud and false is returned.
+        bool changeBaud(SerialGFXBaud in_baud)
+        {
+          unsigned long baud = fromSerialGFXBaud(in_baud);
+          if (baud == m_baud) { return true; }
+          if (not flushBatch()) { return false; }
+
+          // bytes may get lost while the baud changes, so the credits are reset afterwards
+          bool isCreditFlowControlEnabled = m_isCreditFlowControlEnabled;
+          m_isCreditFlowControlEnabled = false;
+
+          unsigned long previousBaud = m_baud;
+          bool isChanged = false;
+          m_acknowledgedBaud = 0;
+
+          resetParameterBufferLength();
+          addParametersToBuffer<SetBaudSchema>(baud);
+          bool isSent = sendCommand(SerialGFXCommandCode::setBaud);
+          resetParameterBufferLength();
+          flushTransmit();
+
+          elapsedMillis timeSinceSetBaud;
+          while (isSent && m_acknowledgedBaud != baud && timeSinceSetBaud < g_baudProbeTimeoutMillis) { yield(); receiveResponses(); }
+
+          if (m_acknowledgedBaud == baud)
+          {
+            m_serial.flush();
+            m_serial.begin(baud);
+            m_baud = baud;
+
+            isChanged = true;
+            for (size_t probe = 0; probe < g_baudProbeCount && isChanged; ++probe) { isChanged = testLink(); }
+            if (not isChanged) { fallBackBaud(previousBaud); }
+          }
+          else if (isSent)
+          {
+            fallBackBaud(previousBaud); // the GPU may have switched, but its acknowledge got lost
+          }
+
+          m_linkErrorCountAtBaud = m_linkErrorCount;
+          m_isBaudFallbackPending = false;
+          if (isCreditFlowControlEnabled) { enableCreditFlowControl(); }
+          return isChanged;
+        }
+
+        // Climbs the ladder from the current baud up to in_maxBaud and stays at the fastest baud, at which the test patterns pass.
+        // Afterwards atCPU steps down by itself, when the GPU reports g_baudFallbackErrorCount link errors (at the next sendSwap()).
+        unsigned long negotiateBaud(SerialGFXBaud in_maxBaud = SerialGFXBaud::Max)
+        {
+          size_t maxIndex = getBaudLadderIndex(fromSerialGFXBaud(in_maxBaud));
+          for (size_t index = getBaudLadderIndex(m_baud) + 1; index <= maxIndex && index < g_baudLadderLength; ++index)
+          {
+            if (not changeBaud(g_baudLadder[index])) { break; }
+          }
+
+          m_isBaudAutoFallbackEnabled = true;
+          return m_baud;
+        }
+
+        void setBaudAutoFallbackEnabled(bool in_isEnabled)
+        {
+          m_isBaudAutoFallbackEnabled = in_isEnabled;
+          m_isBaudFallbackPending = false;
+          m_linkErrorCountAtBaud = m_linkErrorCount;
+        }
+
+        // receive errors, which the GPU has reported since negotiateBaud() or changeBaud()
+        unsigned long getLinkErrorCount() const
+        {
+          return m_linkErrorCount;
+        }
+
+        // how often a baud did not pass its test patterns
+        unsigned long getBaudFallbackCount() const
+        {
+          return m_baudFallbackCount;
+        }
+
+        // With frame pacing the GPU presents every swap at a vertical blank (instead of dropping swaps, which come too early)
+        // and acknowledges it with swapPresented. The frame number of a swap is getSentFrameNumber() after sendSwap().
+        bool enableFramePacing()
+        {
+          if (not writeCommand<SetFramePacingSchema>(1)) { return false; }
+
+          m_isFramePacingEnabled = true;
+          m_sentFrameNumber = 0;
+          m_swapPresented = SwapPresented();
+          m_missedVBlankCount = 0;
+          return true;
+        }
+
+        bool disableFramePacing()
+        {
+          m_isFramePacingEnabled = false;
+          return writeCommand<SetFramePacingSchema>(0);
+        }
+
+        bool isFramePacingEnabled() const
+        {
+          return m_isFramePacingEnabled;
+        }
+
+        // the frame number of the last sendSwap()
+        uint32_t getSentFrameNumber() const
+        {
+          return m_sentFrameNumber;
+        }
+
+        // Reads the responses, which are received so far, and returns whether the frame in_frameNumber is presented.
+        bool isFramePresented(uint32_t in_frameNumber)
+        {
+          pumpTransmit();
+          return m_swapPresented.frameNumber != 0 && static_cast<int32_t>(m_swapPresented.frameNumber - in_frameNumber) >= 0;
+        }
+
+        // Returns false, if the frame is not presented within in_timeoutMillis (or frame pacing is disabled).
+        bool waitForFramePresented(uint32_t in_frameNumber, unsigned long in_timeoutMillis = g_swapTimeoutMillis)
+        {
+          if (not m_isFramePacingEnabled) { return false; }
+          if (not flushBatch()) { return false; }
+
+          elapsedMillis timeSinceWait;
+          while (not isFramePresented(in_frameNumber))
+          {
+            if (timeSinceWait >= in_timeoutMillis) { return false; }
+            yield();
+          }
+
+          return true;
+        }
+
+        // swaps, which are sent but not presented yet
+        uint32_t getPendingFrameCount()
+        {
+          pumpTransmit();
+          return m_sentFrameNumber - m_swapPresented.frameNumber;
+        }
+
+        // Waits, until at most in_maxPendingFrameCount sent frames are not presented yet. With 1, atCPU draws the next frame,
+        // while the GPU still presents the previous one, but never gets further ahead.
+        bool waitForPendingFrames(uint32_t in_maxPendingFrameCount = 1, unsigned long in_timeoutMillis = g_swapTimeoutMillis)
+        {
+          if (m_sentFrameNumber <= in_maxPendingFrameCount) { return m_isFramePacingEnabled; }
+          return waitForFramePresented(m_sentFrameNumber - in_maxPendingFrameCount, in_timeoutMillis);
+        }
+
+        const SwapPresented& getLastSwapPresented() const
+        {
+          return m_swapPresented;
+        }
+
+        // vertical blanks without a new frame between the presented frames, a frame, which is late, misses at least one
+        unsigned long getMissedVBlankCount() const
+        {
+          return m_missedVBlankCount;
+        }
+
+        // The time atCPU has to draw and send a frame, so the GPU can present it at the vertical blank behind the previous frame:
+        // a frame period minus the render time, which the GPU reported for the last presented frame. A frame, which takes
+        // the GPU longer than a frame period to render, gets as many frame periods as it needs.
+        unsigned long getFrameBudgetMicros() const
+        {
+          unsigned long renderMicros = m_swapPresented.renderMicros;
+          unsigned long framePeriodCount = renderMicros / g_dviFramePeriodMicros + 1;
+          return framePeriodCount * g_dviFramePeriodMicros - renderMicros;
+        }
+
+        // Asks the GPU for its performance counters (see GPUStats), they arrive with the next receiveResponses().
+        // With in_isReset the GPU resets its command counters, frame time histogram and high-water mark behind the answer.
+        bool requestGPUStats(bool in_isReset = false)
+        {
+          ++m_gpuStatsSequence;
+          m_isGPUStatsReceived = false;
+          if (not writeCommand<QueryStatsSchema>(m_gpuStatsSequence, in_isReset ? 1 : 0)) { return false; }
+          return flushBatch();
+        }
+
+        // true, when the answer to the last requestGPUStats() is complete
+        bool isGPUStatsReceived()
+        {
+          pumpTransmit();
+          return m_isGPUStatsReceived;
+        }
+
+        bool waitForGPUStats(unsigned long in_timeoutMillis = g_creditTimeoutMillis)
+        {
+          elapsedMillis timeSinceWait;
+          while (not isGPUStatsReceived())
+          {
+            if (timeSinceWait >= in_timeoutMillis) { return false; }
+            yield();
+          }
+
+          return true;
+        }
+
+        const GPUStats& getGPUStats() const
+        {
+          return m_gpuStats;
+        }
+
+        bool sendSwap()
+        {
+          bool isSent = m_isRetainedModeEnabled ? sendRetainedFrame() : writeSwap(false);
+          if (m_isBaudFallbackPending) { stepDownBaud(); } // the frame is complete, so this is the place to change the baud
+          return isSent;
+        }
+
+        bool sendFillScreen(uint16_t in_color)
+        {
+          if (m_isRetainedModeEnabled)
+          {
+            RetainedCommand command;
+            command.commandCode = SerialGFXCommandCode::fillScreen;
+            command.rect = getScreenRect();
+            command.color = in_color;
+            command.bounds = getScreenRect();
+            return retainCommand(command);
+          }
+
+          return writeFillScreen(in_color);
+        }
+
+        bool sendFillRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
+        {
+          if (m_isRetainedModeEnabled) { return retainRectCommand(SerialGFXCommandCode::fillRect, in_x, in_y, in_width, in_height, in_color); }
+          return writeFillRect(in_x, in_y, in_width, in_height, in_color);
+        }
+
+        bool sendDrawRect(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint16_t in_color)
+        {
+          if (m_isRetainedModeEnabled) { return retainRectCommand(SerialGFXCommandCode::drawRect, in_x, in_y, in_width, in_height, in_color); }
+          return writeDrawRect(in_x, in_y, in_width, in_height, in_color);
+        }
+
+        // Draws in_pixels (in_width * in_height palette indices, row by row) at in_x, in_y.
+        // The codec with the shortest encoding is used. In retained mode in_pixels has to stay valid until sendSwap().
+        bool sendBlit(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels)
+        {
+          if (m_isRetainedModeEnabled) { return retainBlitCommand(in_x, in_y, in_width, in_height, in_pixels, SerialGFXBlitCodec::raw, true); }
+          return writeBlit(in_x, in_y, in_width, in_height, in_pixels);
+        }
+
+        bool sendBlit(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels, SerialGFXBlitCodec in_codec)
+        {
+          if (m_isRetainedModeEnabled) { return retainBlitCommand(in_x, in_y, in_width, in_height, in_pixels, in_codec, false); }
+          return writeBlit(in_x, in_y, in_width, in_height, in_pixels, in_codec);
+        }
+
+        // Drops the bytes in front of the first sync word at or behind in_index in m_responseBuffer.
+        void resyncResponses(size_t in_index)
+        {
+          while (in_index < m_receivedResponseLength
+                 && not (isFrameSyncByte(m_responseBuffer[in_index], 0) && (in_index + 1 == m_receivedResponseLength || isFrameSyncByte(m_responseBuffer[in_index + 1], 1))))
+          {
+            ++in_index;
+          }
+
+          m_discardedResponseByteCount = m_discardedResponseByteCount + in_index;
+          m_receivedResponseLength = m_receivedResponseLength - in_index;
+          memmove(m_responseBuffer.data(), m_responseBuffer.data() + in_index, m_receivedResponseLength);
+        }
+
+        // m_responseBuffer holds the frame from its sync word on. After a corrupted frame the next sync word is searched
+        // behind the sync word of it, so a frame, which follows a damaged length, is not lost.
+        void receiveFramedResponses()
+        {
+          while (true)
+          {
+            size_t requiredLength = g_frameSyncLength + g_responseHeaderLength;
+            if (m_receivedResponseLength >= requiredLength) { requiredLength = requiredLength + m_responseBuffer[g_frameSyncLength + 1] + g_frameChecksumLength; }
+
+            // after a resync the buffer may already hold more than the frame
+            if (m_receivedResponseLength >= requiredLength)
+            {
+              const uint8_t* header = m_responseBuffer.data() + g_frameSyncLength;
+              uint8_t payloadLength = header[1];
+              size_t packetLength = g_responseHeaderLength + payloadLength;
+
+              if (updateCRC16(g_crc16InitialValue, header, packetLength) == readValue<uint16_t>(reinterpret_cast<const char*>(header) + packetLength))
+              {
+                handleResponse(toSerialGFXResponseCode(header[0]), header + g_responseHeaderLength, payloadLength);
+                m_receivedResponseLength = m_receivedResponseLength - requiredLength;
+                memmove(m_responseBuffer.data(), m_responseBuffer.data() + requiredLength, m_receivedResponseLength);
+                resyncResponses(0);
+              }
+              else
+              {
+                ++m_corruptedResponseCount;
+                resyncResponses(1);
+              }
+
+              continue;
+            }
+
+            if (m_serial.available() <= 0) { return; }
+            int value = m_serial.read(); if (value < 0) { return; }
+            m_responseBuffer[m_receivedResponseLength++] = static_cast<uint8_t>(value);
+
+            if (m_receivedResponseLength <= g_frameSyncLength && not isFrameSyncByte(value, m_receivedResponseLength - 1)) { resyncResponses(1); }
+          }
+        }
+
+        // Reads the responses of the GPU, as far as they are received, and returns immediately.
+        void receiveResponses()
+        {
+          if (m_isFramingEnabled) { receiveFramedResponses(); return; }
+
+          while (true)
+          {
+            size_t requiredLength = g_responseHeaderLength;
+            if (m_receivedResponseLength >= g_responseHeaderLength) { requiredLength = g_responseHeaderLength + m_responseBuffer[1]; }
+
+            if (m_receivedResponseLength == requiredLength)
+            {
+              handleResponse(toSerialGFXResponseCode(m_responseBuffer[0]), m_responseBuffer.data() + g_responseHeaderLength, m_responseBuffer[1]);
+              m_receivedResponseLength = 0;
+              continue;
+            }
+
+            if (m_serial.available() <= 0) { return; }
+            int value = m_serial.read(); if (value < 0) { return; }
+            m_responseBuffer[m_receivedResponseLength++] = static_cast<uint8_t>(value);
+          }
+        }
+
+        // false if the sprite was never uploaded or the GPU has reported, that it is evicted
+        bool isSpriteResident(uint8_t in_spriteID)
+        {
+          receiveResponses();
+          return m_sprites[in_spriteID].isResident;
+        }
+
+        // Uploads in_pixels (in_width * in_height palette indices, row by row) into the sprite cache of the GPU.
+        // Uploads are sent immediately, also in retained mode.
+        bool sendUploadSprite(uint8_t in_spriteID, int16_t in_width, int16_t in_height, const uint8_t* in_pixels)
+        {
+          if (in_pixels == nullptr || in_width <= 0 || in_height <= 0) { return false; }
+          SerialGFXBlitCodec codec = m_blitEncoder.getBestCodec(in_pixels, static_cast<size_t>(in_width) * in_height);
+          return writeUploadSprite(in_spriteID, in_width, in_height, in_pixels, codec);
+        }
+
+        bool sendUploadSprite(uint8_t in_spriteID, int16_t in_width, int16_t in_height, const uint8_t* in_pixels, SerialGFXBlitCodec in_codec)
+        {
+          return writeUploadSprite(in_spriteID, in_width, in_height, in_pixels, in_codec);
+        }
+
+        bool sendDrawSprite(uint8_t in_spriteID, int16_t in_x, int16_t in_y)
+        {
+          if (m_isRetainedModeEnabled) { return retainDrawSpriteCommand(in_spriteID, in_x, in_y, false, 0); }
+          return writeDrawSprite(in_spriteID, in_x, in_y, false, 0);
+        }
+
+        // Pixels with the value in_transparentColor are not drawn.
+        bool sendDrawSprite(uint8_t in_spriteID, int16_t in_x, int16_t in_y, uint8_t in_transparentColor)
+        {
+          if (m_isRetainedModeEnabled) { return retainDrawSpriteCommand(in_spriteID, in_x, in_y, true, in_transparentColor); }
+          return writeDrawSprite(in_spriteID, in_x, in_y, true, in_transparentColor);
+        }
+
+        // Draws a cached sprite and uploads in_pixels before, if the GPU does not have the sprite (anymore).
+        // A sprite, which the GPU evicts while the draw is still on its way, is reported as missing (not drawn)
+        // and uploaded again by the next sendSprite().
+        bool sendSprite(uint8_t in_spriteID, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels)
+        {
+          if (not isSpriteResident(in_spriteID) && not sendUploadSprite(in_spriteID, in_width, in_height, in_pixels)) { return false; }
+          return sendDrawSprite(in_spriteID, in_x, in_y);
+        }
+
+        bool sendSprite(uint8_t in_spriteID, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, const uint8_t* in_pixels,
+                        uint8_t in_transparentColor)
+        {
+          if (not isSpriteResident(in_spriteID) && not sendUploadSprite(in_spriteID, in_width, in_height, in_pixels)) { return false; }
+          return sendDrawSprite(in_spriteID, in_x, in_y, in_transparentColor);
+        }
+
+        bool sendSetFont(SerialGFXFont in_font)
+        {
+          const GFXfont* fontPointer = nullptr;
+          if (not getFontPointer(in_font, fontPointer)) { return false; }
+          m_helperGFX.setFont(fontPointer); // set for getTextBounds() atCPU
+          m_textMetrics.setFont(in_font);
+          m_textState.font = in_font;
+
+          // sent together with the next text, see writeTextState()
+          if (not m_isRetainedModeEnabled) { m_savedByteCount = m_savedByteCount + getCommandWireLength<SetFontSchema>(fromSerialGFXFont(in_font)); }
+          return true;
+        }
+
+        bool sendSetTextSize(uint8_t in_size)
+        {
+          m_helperGFX.setTextSize(in_size); // set for getTextBounds() atCPU
+          m_textMetrics.setTextSize(in_size);
+          m_textState.size = in_size;
+
+          if (not m_isRetainedModeEnabled) { m_savedByteCount = m_savedByteCount + getCommandWireLength<SetTextSizeSchema>(in_size); }
+          return true;
+        }
+
+        bool sendSetTextColor(uint16_t in_color)
+        {
+          m_textState.color = in_color;
+
+          if (not m_isRetainedModeEnabled) { m_savedByteCount = m_savedByteCount + getCommandWireLength<SetTextColorSchema>(in_color); }
+          return true;
+        }
+
+        // The cursor is sent with the next text (the text state as well), so the GPU does not get a cursor, which is not printed at.
+        bool sendSetCursor(int16_t in_x, int16_t in_y)
+        {
+          // the replaced cursor is not sent, its coordinates may encode to another length than the new ones
+          if (m_isCursorPending && not m_isRetainedModeEnabled)
+          {
+            m_savedByteCount = m_savedByteCount + getCommandWireLength<SetCursorSchema>(m_helperGFX.getCursorX(), m_helperGFX.getCursorY());
+          }
+
+          m_helperGFX.setCursor(in_x, in_y); // set for getTextBounds() atCPU
+          if (not m_isRetainedModeEnabled) { m_isCursorPending = true; }
+          return true;
+        }
+
+        bool sendPrint(const char* in_string)
+        {
+          return sendText(SerialGFXCommandCode::print, in_string);
+        }
+
+        bool sendPrintln(const char* in_string)
+        {
+          return sendText(SerialGFXCommandCode::println, in_string);
+        }
+
+        bool sendPrint(const String& in_string)
+        {
+          return sendText(SerialGFXCommandCode::print, in_string.c_str());
+        }
+
+        bool sendPrintln(const String& in_string)
+        {
+          return sendText(SerialGFXCommandCode::println, in_string.c_str());
+        }
+
+        // bytes, which the elimination of redundant text state and cursors and the merged commands have saved on the link
+        // (the retained mode does not count the commands, which it leaves out, here)
+        long getSavedByteCount() const
+        {
+          return m_savedByteCount;
+        }
+
+        bool isRetainedModeEnabled() const
+        {
+          return m_isRetainedModeEnabled;
+        }
+
+        // In retained mode the drawing commands of a frame are recorded and sent by sendSwap().
+        // sendSwap() compares the frame with the previous one and only sends the commands,
+        // which touch pixels that have changed. The GPU copies the displayed frame into the new back buffer
+        // on swap, so all other pixels are kept. Pixels, which no command of a frame touches, keep their old content.
+        // The cursor is unknown until the first sendSetCursor() after enabling, prints do not track the GPU cursor before.
+        void enableRetainedMode()
+        {
+          if (m_isRetainedModeEnabled) { return; }
+
+          m_previousFrame->clear();
+          m_currentFrame->clear();
+          m_isPreviousFrameValid = false; // the first frame is sent completely
+          m_isRetainedFrameOverflowed = false;
+          m_isGPUCursorKnown = false;
+          m_isRetainedModeEnabled = true;
+        }
+
+        // Sends the commands recorded since the last swap (without a swap). The next text is drawn
+        // in the text state set by the last sendSet*() calls, at the cursor behind the recorded text.
+        bool disableRetainedMode()
+        {
+          if (not m_isRetainedModeEnabled) { return true; }
+
+          bool isSent = m_isRetainedFrameOverflowed || sendRetainedFrameCompletely(*m_currentFrame);
+          m_currentFrame->clear();
+          m_isRetainedModeEnabled = false;
+          m_isCursorPending = true;
+          return isSent;
+        }
+
+        bool isMacroRecording() const
+        {
+          return m_isMacroRecording;
+        }
+
+        // The following send*() calls are recorded as the macro in_id (below g_maxMacroCount) instead of being drawn, until endMacro().
+        // The GPU keeps the macro and runs it on every sendCallMacro(), with the values of the call in the slots bound by bindMacroSlot().
+        // A macro does not depend on what is drawn before it: its first text sets the whole text state and every cursor goes with its text.
+        // Macros are not recorded in retained mode. A swap or a command, which is not batched, fails the macro.
+        bool beginMacro(uint8_t in_id)
+        {
+          if (m_isRetainedModeEnabled || m_isMacroRecording || in_id >= g_maxMacroCount) { return false; }
+          if (not flushBatch()) { return false; }
+
+          m_isMacroRecording = true;
+          m_isMacroFailed = false;
+          m_macroID = in_id;
+          m_macroSlots.fill(MacroSlotBinding());
+          m_macroSlotCount = 0;
+          m_macroProtocol = m_protocol;
+          m_isMacroBatchEnabled = m_isBatchEnabled;
+
+          m_protocol = SerialGFXProtocol::v1; // every field has a fixed length, so the slots have fixed offsets in the body
+          m_isBatchEnabled = true;
+          m_parameterBufferLength = g_maxMacroHeaderLength; // the body is recorded like a batch behind the room for the header
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+          m_isCursorPending = true;
+          return true;
+        }
+
+        // Binds field in_fieldIndex (as in the schema) of the last recorded in_commandCode to slot in_slot. The commands are the ones,
+        // which are recorded: the text state is recorded with the text (setFont, setTextSize, setTextColor only when it changes),
+        // the cursor in printAt and printlnAt (x, y). Coordinates and colors take the slot value as it is, uint8_t fields its low byte.
+        bool bindMacroSlot(uint8_t in_slot, SerialGFXCommandCode in_commandCode, size_t in_fieldIndex)
+        {
+          if (not m_isMacroRecording || in_slot >= g_maxMacroSlotCount) { return false; }
+
+          size_t fieldOffset = 0;
+          size_t fieldLength = 0;
+          if (not getMacroFieldLayout(in_commandCode, in_fieldIndex, fieldOffset, fieldLength)) { return false; }
+
+          bool isFound = false;
+          size_t slotOffset = 0;
+          size_t commandOffset = g_maxMacroHeaderLength;
+          while (commandOffset + g_commandHeaderLength <= m_parameterBufferLength)
+          {
+            SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+            uint16_t parameterLength = 0;
+            readCommandHeader(SerialGFXProtocol::v1, m_parameterBuffer.data() + commandOffset, commandCode, parameterLength);
+            if (commandCode == in_commandCode && fieldOffset + fieldLength <= parameterLength)
+            {
+              isFound = true;
+              slotOffset = commandOffset + g_commandHeaderLength + fieldOffset;
+            }
+
+            commandOffset = commandOffset + getBatchedCommandLength(SerialGFXProtocol::v1, g_commandHeaderLength, parameterLength);
+          }
+
+          if (not isFound) { return false; }
+          m_macroSlots[in_slot] = MacroSlotBinding{ static_cast<uint16_t>(slotOffset - g_maxMacroHeaderLength), static_cast<uint8_t>(fieldLength) };
+          m_macroSlotCount = max(m_macroSlotCount, static_cast<size_t>(in_slot) + 1);
+          return true;
+        }
+
+        // Sends the recorded macro, it replaces the macro with the same id on the GPU. Returns false, if the macro has failed or
+        // its body is longer than g_maxMacroBodyLength: the GPU removes the macro then. The text state and the cursor are sent
+        // with the next text, as the GPU has not drawn the recorded commands.
+        bool endMacro()
+        {
+          if (not m_isMacroRecording) { return false; }
+          m_isMacroRecording = false;
+          m_protocol = m_macroProtocol;
+          m_isBatchEnabled = m_isMacroBatchEnabled;
+          m_fillRectCount = 0;
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+          m_isCursorPending = true;
+
+          size_t bodyLength = m_parameterBufferLength - g_maxMacroHeaderLength;
+          bool isComplete = not m_isMacroFailed && bodyLength <= g_maxMacroBodyLength;
+          if (not isComplete) { bodyLength = 0; m_macroSlotCount = 0; }
+
+          char header[g_maxMacroHeaderLength];
+          size_t headerLength = DefineMacroSchema::encode(header, m_protocol, m_macroID, m_macroSlotCount);
+          for (size_t index = 0; index < m_macroSlotCount; ++index)
+          {
+            headerLength = headerLength + MacroSlotSchema::encode(header + headerLength, m_protocol, m_macroSlots[index].offset, m_macroSlots[index].length);
+          }
+
+          memmove(m_parameterBuffer.data() + headerLength, m_parameterBuffer.data() + g_maxMacroHeaderLength, bodyLength);
+          memcpy(m_parameterBuffer.data(), header, headerLength);
+          m_parameterBufferLength = headerLength + bodyLength;
+          bool isSent = sendCommand(SerialGFXCommandCode::defineMacro);
+          resetParameterBufferLength();
+          return isSent && isComplete;
+        }
+
+        // Runs the macro in_id on the GPU, in_slotValues go into its slots in order (slots without a value keep the recorded one).
+        // Afterwards atCPU sends the whole text state with the next text, as the macro may have changed it.
+        bool sendCallMacro(uint8_t in_id, std::initializer_list<int16_t> in_slotValues = {})
+        {
+          if (m_isRetainedModeEnabled || m_isMacroRecording) { return false; }
+
+          size_t slotValueCount = min(in_slotValues.size(), g_maxMacroSlotCount);
+          if (not beginCommand(SerialGFXCommandCode::callMacro, CallMacroSchema::getMaxLength(m_protocol) + slotValueCount * MacroSlotValueSchema::getMaxLength(m_protocol)))
+          {
+            return false;
+          }
+
+          addParametersToBuffer<CallMacroSchema>(in_id);
+          for (const int16_t* slotValue = in_slotValues.begin(); slotValue != in_slotValues.begin() + slotValueCount; ++slotValue)
+          {
+            addParametersToBuffer<MacroSlotValueSchema>(*slotValue);
+          }
+
+          if (not endCommand()) { return false; }
+          m_isGPUTextStateKnown = false;
+          m_isGPUCursorKnown = false;
+          return true;
+        }
+
+        // the GPU frees the body of the macro in_id
+        bool sendRemoveMacro(uint8_t in_id)
+        {
+          if (m_isMacroRecording || not flushBatch()) { return false; }
+
+          resetParameterBufferLength();
+          addParametersToBuffer<DefineMacroSchema>(in_id, 0);
+          bool isSent = sendCommand(SerialGFXCommandCode::defineMacro);
           resetParameterBufferLength();
-          addStringToBuffer(in_string);
-          return sendCommand(SerialGFXCommandCode::println);
+          return isSent;
         }
     };
   }
@@ -3,132 +3,901 @@
 #include <PicoDVI.h>
 #include <elapsedMillis.h>
 #include <array>
+#include <atomic>
 
+#include "halvoeBlitCodec.hpp"
+#include "halvoeCommandSchema.hpp"
 #include "halvoeCString.hpp"
+#include "halvoeFraming.hpp"
+#include "halvoeGlyphAtlas.hpp"
+#include "halvoeGPUStats.hpp"
+#include "halvoeMacroStore.hpp"
+#include "halvoeRaster.hpp"
+#include "halvoeReceiveRing.hpp"
+#include "halvoeSPSCQueue.hpp"
+#include "halvoeSpriteCache.hpp"
+#include "halvoeTileBinner.hpp"
+#include "halvoeTrace.hpp"
 #include "SerialGFXInterface.hpp"
 #include "halvoeVersion.hpp"
 
+// HALVOE_GPU_PIPELINE_NONE:      receiveCommand() and runCommand() are called one after the other
+// HALVOE_GPU_PIPELINE_LOOP:      pumpReceiver() and pumpRenderer() are both called from loop()
+// HALVOE_GPU_PIPELINE_TIMER_IRQ: pumpReceiver() is called from a repeating timer IRQ, pumpRenderer() from loop()
+// (core1 is not available for the receiver, because PicoDVI runs the TMDS encoding in setup1())
+#define HALVOE_GPU_PIPELINE_NONE 0
+#define HALVOE_GPU_PIPELINE_LOOP 1
+#define HALVOE_GPU_PIPELINE_TIMER_IRQ 2
+
+#ifndef HALVOE_GPU_PIPELINE
+  #define HALVOE_GPU_PIPELINE HALVOE_GPU_PIPELINE_NONE
+#endif // HALVOE_GPU_PIPELINE
+
 namespace halvoeGPU
 {
   namespace atGPU
   {
     const pin_size_t READY_PIN = 24;
-    const size_t GPU_SERIAL_RECEIVE_FIFO_SIZE = 1024;
+    constexpr const int16_t g_blitToFramebuffer = -1;
+    constexpr const size_t g_streamChunkLength = 256; // parameters of a streamed packet per command, see receiveStream()
+    // the longest block, which is decoded in place: the parameters and the checksum of a packet (see receiveParameters()),
+    // it is the spill area of the receive ring, a header or a chunk of a streamed packet are not longer
+    constexpr const size_t g_maxContiguousReceiveLength = g_maxParameterBufferLength + g_frameChecksumLength;
+    static_assert(g_maxContiguousReceiveLength >= g_maxCommandHeaderLength && g_maxContiguousReceiveLength >= g_streamChunkLength,
+                  "the spill area of the receive ring has to hold every block, which is decoded in place");
+
+    using GPUReceiveRing = ReceiveRing<g_gpuReceiveRingLength, g_maxContiguousReceiveLength, g_maxSchemaParameterLength>;
+
+    enum class ReceiveState : uint8_t
+    {
+      header = 0,
+      parameters,
+      discard,
+      stream,
+      ready
+    };
+
+    #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_NONE
+      const unsigned long RECEIVER_PUMP_INTERVAL_MICROS = 500;
+      constexpr const size_t g_maxQueuedParameterLength = 256;
+      constexpr const size_t g_commandQueueCapacity = 16;
+
+      // A single (unbatched) command as decoded by the receiver stage.
+      // Strings longer than g_maxQueuedParameterLength are split into several print commands,
+      // blitData longer than g_maxQueuedParameterLength into several blitData commands.
+      struct QueuedCommand
+      {
+        SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+        SerialGFXProtocol protocol = SerialGFXProtocol::v1;
+        uint16_t parameterLength = 0;
+        alignas(uint16_t) std::array<char, g_maxQueuedParameterLength + g_maxSchemaParameterLength> parameters;
+      };
+
+      // The parameters of a queued command start at the front of the slot and are followed by g_maxSchemaParameterLength bytes,
+      // so a schema can decode them up to their end, also repeated ones like the rectangles of fillRects (see CommandSchema::decode()).
+      static_assert(g_maxQueuedParameterLength >= g_maxSchemaParameterLength, "a QueuedCommand has to hold the parameters of every schema");
+    #endif // HALVOE_GPU_PIPELINE
+
+    // changeRequested and probeFailed pause the receiver, until serviceLink() has switched the baud
+    enum class BaudState : uint8_t
+    {
+      stable = 0,
+      changeRequested,
+      probing,
+      probeFailed
+    };
 
     class SerialGFXInterface
     {
       private:
+        // first, so its alignment does not pad the members in front of it,
+        // the padding lets the schemas decode the parameters of a packet at the end of the spill area (see CommandSchema::decode())
+        GPUReceiveRing m_receiveRing;
+
         HALVOE_SERIAL_TYPE& m_serial;
         DVIGFX8& m_dviGFX;
         elapsedMicros m_timeSinceLastFrame;
         bool m_isPrintFrameTimeEnabled = false;
         bool m_isPrintFPSEnabled = false;
 
+        // frame pacing: every swap is presented (at the next vertical blank) and acknowledged with swapPresented
+        bool m_isFramePacingEnabled = false;
+        uint32_t m_presentedFrameCount = 0;  // since setFramePacing
+        uint32_t m_frameRenderMicros = 0;    // spent in the commands of the frame, which is drawn
+        bool m_isMinFrameTimeEnabled = true; // see setMinFrameTimeEnabled()
+
+        // performance counters, queryStats sends them to the CPU
+        GPUStats m_stats;
+        uint32_t m_receiveHighWaterLength = 0;
+        uint32_t m_droppedSwapCount = 0;
+
+        // The received packet stays in m_receiveRing, until it is executed (or queued), its parameters are decoded in place.
+        ReceiveState m_receiveState = ReceiveState::header;
+        uint32_t m_lastWrittenCount = 0; // of m_receiveRing
+        size_t m_syncLength = 0;         // of the received packet, 0 without framing
+        size_t m_headerLength = 0;       // of the received packet, the compact long form may also carry a short length
+        size_t m_packetLength = 0;       // of the received packet in m_receiveRing, from its sync word to its checksum
+        size_t m_discardLength = 0;      // parameters of an oversized packet, which are still to be discarded
+        size_t m_streamLength = 0;       // parameters of an oversized packet, which are still to be streamed
+        SerialGFXCommandCode m_streamCommandCode = SerialGFXCommandCode::noCommand;
+        bool m_isStreamStringEnded = false;
+        alignas(uint16_t) std::array<char, g_streamChunkLength + g_maxSchemaParameterLength> m_streamChunk;
+        unsigned long m_streamedPacketCount = 0;
+        std::atomic<unsigned long> m_parseErrorCount{ 0 }; // written by the receiver, read by reportLinkErrors() and getStats()
+        SerialGFXProtocol m_protocol = SerialGFXProtocol::v1; // protocol of the packets we receive
+
+        // framing: written by the receiver, also read by writeResponse()
+        std::atomic<bool> m_isFramingEnabled{ false };
+        elapsedMillis m_timeSinceFrameByte;
+        std::atomic<unsigned long> m_corruptedFrameCount{ 0 }; // like m_parseErrorCount
+        unsigned long m_discardedByteCount = 0;
+
         SerialGFXCommandCode m_receivedCommandCode = SerialGFXCommandCode::noCommand;
-        uint16_t m_parameterBufferLength = 0;
-        std::array<char, 2> m_commandBuffer;
-        std::array<char, g_maxParameterBufferLength> m_parameterBuffer;
+        const char* m_receivedParameters = nullptr; // in m_receiveRing
+        uint16_t m_receivedParameterLength = 0;
         size_t m_parameterBufferOffset = 0;
 
+        // parameters of the currently executed command (in m_receiveRing or in a slot of m_commandQueue)
+        const char* m_commandParameters = nullptr;
+        uint16_t m_commandParameterLength = 0;
+        SerialGFXProtocol m_commandProtocol = SerialGFXProtocol::v1;
+
+        BlitDecoder m_blitDecoder;
+        int16_t m_blitSpriteID = g_blitToFramebuffer; // the sprite, into which blitData is decoded
+        unsigned long m_blitErrorCount = 0;
+        SpriteCache m_spriteCache;
+
+        GlyphAtlas m_glyphAtlas; // has the same text state as m_dviGFX
+        bool m_isGlyphAtlasEnabled = true;
+
+        // fillScreen, fillRect(s) and drawRect wait in m_tileBinner, until a command draws something else (see isDrawnImmediately())
+        TileBinner m_tileBinner;
+        bool m_isDeferredRasterEnabled = false;
+
+        // defineMacro is handled by the receiver, callMacro by the renderer (by the receiver in a pipeline), both run the same context then
+        MacroStore m_macroStore;
+        alignas(uint16_t) std::array<char, g_maxMacroBodyLength + g_maxSchemaParameterLength> m_macroBody; // the expanded body of a callMacro
+        unsigned long m_macroErrorCount = 0;
+
+        // credit flow control: the receiver counts, reportCredits() reports (in HALVOE_GPU_PIPELINE_TIMER_IRQ from another context)
+        std::atomic<uint32_t> m_receivedByteCount{ 0 };  // since the last resetCredits
+        std::atomic<uint32_t> m_creditResetCount{ 0 };   // 0: the CPU does not use credit flow control
+        uint32_t m_reportedByteCount = 0;
+        uint32_t m_reportedCreditResetCount = 0;
+
+        // baud negotiation: the receiver requests the change and records the testLink results, serviceLink() switches and reports
+        std::atomic<BaudState> m_baudState{ BaudState::stable };
+        unsigned long m_baud = 0;
+        unsigned long m_requestedBaud = 0;
+        unsigned long m_previousBaud = 0;
+        std::atomic<bool> m_isLinkTestPending{ false };
+        uint8_t m_linkTestSequence = 0;
+        uint16_t m_linkTestErrorCount = 0;
+        size_t m_passedLinkTestCount = 0;
+        elapsedMillis m_timeSinceLinkTest;
+        bool m_isLinkErrorReportEnabled = false; // only a CPU, which negotiates the baud, expects linkErrors
+        unsigned long m_reportedLinkErrorCount = 0;
+        unsigned long m_baudFallbackCount = 0;
+
+        #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_NONE
+          SPSCQueue<QueuedCommand, g_commandQueueCapacity> m_commandQueue;
+          size_t m_enqueueBatchOffset = 0;
+          size_t m_enqueueMacroOffset = 0;
+          size_t m_enqueueChunkOffset = 0;
+        #endif // HALVOE_GPU_PIPELINE
+
+        TraceWriter m_trace; // see beginCapture()
+
       private:
+        // only the receiver writes m_receivedByteCount
+        void addReceivedBytes(size_t in_count)
+        {
+          m_receivedByteCount.store(m_receivedByteCount.load(std::memory_order_relaxed) + in_count, std::memory_order_release);
+        }
+
+        // only the receiver writes m_parseErrorCount and m_corruptedFrameCount
+        void countParseError()
+        {
+          m_parseErrorCount.store(m_parseErrorCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        void countCorruptedFrame()
+        {
+          m_corruptedFrameCount.store(m_corruptedFrameCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // the bytes count as received for the credit flow control, when they are released from m_receiveRing
+        void consumeReceivedBytes(size_t in_length)
+        {
+          m_receiveRing.consume(in_length);
+          addReceivedBytes(in_length);
+        }
+
+        void consumePacket()
+        {
+          consumeReceivedBytes(m_packetLength);
+          m_packetLength = 0;
+          m_receiveState = m_streamLength > 0 ? ReceiveState::stream : ReceiveState::header;
+        }
+
+        // the bytes from the written count in_count on, as far as they are still in m_receiveRing
+        void writeTraceRecord(uint32_t in_count)
+        {
+          uint32_t writtenCount = m_receiveRing.getWrittenCount();
+          size_t length = min(static_cast<size_t>(writtenCount - in_count), m_receiveRing.getLength());
+          uint32_t count = writtenCount - length;
+          m_trace.beginRecord(length);
+
+          while (length > 0)
+          {
+            size_t pieceLength = length;
+            const uint8_t* piece = m_receiveRing.getWrittenBytes(count, pieceLength);
+            m_trace.write(piece, pieceLength);
+            count = count + pieceLength;
+            length = length - pieceLength;
+          }
+        }
+
+        // Takes over what the DMA has received since the last call. If it has overwritten unread bytes
+        // (only possible without credit flow control), they are lost and the packet in progress with them.
+        void updateReceiveRing()
+        {
+          size_t droppedLength = m_receiveRing.update();
+          if (droppedLength > 0)
+          {
+            addReceivedBytes(droppedLength);
+            m_discardLength = 0;
+            m_streamLength = 0;
+            m_receiveState = ReceiveState::header;
+          }
+
+          uint32_t writtenCount = m_receiveRing.getWrittenCount();
+          if (writtenCount == m_lastWrittenCount) { return; }
+          if (m_trace.isEnabled()) { writeTraceRecord(m_lastWrittenCount); }
+          m_lastWrittenCount = writtenCount;
+          m_timeSinceFrameByte = 0;
+          m_receiveHighWaterLength = max(m_receiveHighWaterLength, static_cast<uint32_t>(m_receiveRing.getAvailableLength()));
+        }
+
+        // Skips bytes until g_frameSyncWord, returns false until it is received.
+        bool receiveSync()
+        {
+          while (m_receiveRing.getAvailableLength() >= g_frameSyncLength)
+          {
+            if (isFrameSyncByte(m_receiveRing.peek(0), 0) && isFrameSyncByte(m_receiveRing.peek(1), 1)) { return true; }
+            consumeReceivedBytes(1);
+            ++m_discardedByteCount;
+          }
+
+          return false;
+        }
+
+        // Continues behind the first byte of a corrupted frame: its bytes are still in m_receiveRing, so the next sync word
+        // is also searched in them. A corrupted length, which has swallowed the following frames, does not lose them.
+        void resyncFrame()
+        {
+          countCorruptedFrame();
+          consumeReceivedBytes(1);
+          ++m_discardedByteCount;
+          m_receiveState = ReceiveState::header;
+        }
+
+        void receiveHeader()
+        {
+          bool isFramingEnabled = m_isFramingEnabled.load(std::memory_order_relaxed);
+          if (isFramingEnabled && not receiveSync()) { return; }
+          m_syncLength = isFramingEnabled ? g_frameSyncLength : 0;
+
+          const char* header = nullptr;
+          size_t headerLength = 0;
+          size_t requiredHeaderLength = 0;
+
+          // the compact header length is only known after its first bytes are received
+          while ((requiredHeaderLength = getRequiredCommandHeaderLength(m_protocol, header, headerLength)) > headerLength)
+          {
+            if (m_receiveRing.getAvailableLength() < m_syncLength + requiredHeaderLength) { return; }
+            header = m_receiveRing.getContiguous(m_syncLength, requiredHeaderLength);
+            headerLength = requiredHeaderLength;
+          }
+
+          readCommandHeader(m_protocol, header, m_receivedCommandCode, m_receivedParameterLength);
+          m_headerLength = headerLength;
+
+          if (m_receivedParameterLength > g_maxParameterBufferLength)
+          {
+            // a frame with an invalid length is not received any further, without framing the stream has to be followed
+            if (isFramingEnabled) { resyncFrame(); return; }
+            consumeReceivedBytes(m_headerLength);
+            if (isStreamedCommand(m_receivedCommandCode)) { beginStream(); return; }
+            m_discardLength = m_receivedParameterLength;
+            m_receiveState = ReceiveState::discard;
+            return;
+          }
+
+          // as above, an invalid command code is most likely a corrupted header
+          if (isFramingEnabled && m_receivedCommandCode == SerialGFXCommandCode::invalid) { resyncFrame(); return; }
+          m_receiveState = ReceiveState::parameters;
+        }
+
+        // Discards the parameters of a packet, which do not fit into m_receiveRing, as they arrive.
+        void discardParameters()
+        {
+          size_t discardLength = min(m_discardLength, m_receiveRing.getAvailableLength());
+          consumeReceivedBytes(discardLength);
+          m_discardLength = m_discardLength - discardLength;
+          if (m_discardLength > 0) { return; }
+
+          countParseError();
+          m_receiveState = ReceiveState::header;
+        }
+
+        // Strings and blit data do not have to be in one piece, a packet, which is too long for m_receiveRing, is run in chunks instead.
+        // Only without framing, because the checksum of a frame is checked, before any of it is run.
+        static bool isStreamedCommand(SerialGFXCommandCode in_commandCode)
+        {
+          return in_commandCode == SerialGFXCommandCode::print || in_commandCode == SerialGFXCommandCode::println ||
+                 in_commandCode == SerialGFXCommandCode::blitData;
+        }
+
+        void beginStream()
+        {
+          m_streamCommandCode = m_receivedCommandCode;
+          m_streamLength = m_receivedParameterLength;
+          m_isStreamStringEnded = false;
+          ++m_streamedPacketCount;
+          m_receiveState = ReceiveState::stream;
+        }
+
+        // Copies the next chunk of the streamed packet into m_streamChunk, as a blitData or print of its own, as soon as it is received.
+        // The line break of println goes with the chunk, in which the string ends, the bytes behind the string are only consumed.
+        void receiveStream()
+        {
+          while (m_streamLength > 0)
+          {
+            bool isString = m_streamCommandCode != SerialGFXCommandCode::blitData;
+            size_t chunkLength = min(m_streamLength, isString ? g_streamChunkLength - g_zeroTerminatorLength : g_streamChunkLength);
+            if (m_receiveRing.getAvailableLength() < chunkLength) { return; }
+
+            const char* chunk = m_receiveRing.getContiguous(0, chunkLength);
+            m_streamLength = m_streamLength - chunkLength;
+            if (m_isStreamStringEnded) { consumeReceivedBytes(chunkLength); continue; }
+
+            m_receivedCommandCode = m_streamCommandCode;
+            m_receivedParameterLength = chunkLength;
+            if (isString)
+            {
+              size_t stringLength = halvoeCString::getLength(chunk, chunkLength);
+              m_isStreamStringEnded = stringLength < chunkLength || m_streamLength == 0;
+              if (not m_isStreamStringEnded) { m_receivedCommandCode = SerialGFXCommandCode::print; }
+              halvoeCString::copy(chunk, m_streamChunk.data(), stringLength);
+              m_receivedParameterLength = stringLength + g_zeroTerminatorLength;
+            }
+            else
+            {
+              memcpy(m_streamChunk.data(), chunk, chunkLength);
+            }
+
+            m_receivedParameters = m_streamChunk.data();
+            m_packetLength = chunkLength;
+            m_receiveState = ReceiveState::ready;
+            return;
+          }
+
+          m_receiveState = ReceiveState::header;
+        }
+
+        // the header is read again, the parameters may have overwritten it in the spill area of m_receiveRing
+        bool isFrameChecksumValid(const char* in_parameters)
+        {
+          char header[g_maxCommandHeaderLength];
+          for (size_t index = 0; index < m_headerLength; ++index) { header[index] = static_cast<char>(m_receiveRing.peek(m_syncLength + index)); }
+          uint16_t crc = updateCRC16(updateCRC16(g_crc16InitialValue, header, m_headerLength), in_parameters, m_receivedParameterLength);
+          return crc == readValue<uint16_t>(in_parameters + m_receivedParameterLength);
+        }
+
+        void receiveParameters()
+        {
+          bool isFramingEnabled = m_syncLength > 0;
+          size_t checksumLength = isFramingEnabled ? g_frameChecksumLength : 0;
+          size_t packetLength = m_syncLength + m_headerLength + m_receivedParameterLength + checksumLength;
+
+          if (m_receiveRing.getAvailableLength() < packetLength)
+          {
+            if (isFramingEnabled && m_timeSinceFrameByte > g_frameTimeoutMillis) { resyncFrame(); }
+            return;
+          }
+
+          // parameters and checksum in one piece, so the checksum and the commands read them in place
+          const char* parameters = m_receiveRing.getContiguous(m_syncLength + m_headerLength, m_receivedParameterLength + checksumLength);
+          if (isFramingEnabled && not isFrameChecksumValid(parameters))
+          {
+            resyncFrame();
+            return;
+          }
+
+          m_receivedParameters = parameters;
+          m_packetLength = packetLength;
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::invalid)
+          {
+            countParseError();
+            consumePacket();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::setProtocol)
+          {
+            receiveSetProtocol();
+            consumePacket();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::resetCredits)
+          {
+            consumePacket(); // first, the byte count starts behind it
+            receiveResetCredits();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::setBaud)
+          {
+            receiveSetBaud();
+            consumePacket();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::testLink)
+          {
+            receiveTestLink();
+            consumePacket();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::setFraming)
+          {
+            receiveSetFraming();
+            consumePacket();
+            return;
+          }
+
+          if (m_receivedCommandCode == SerialGFXCommandCode::defineMacro)
+          {
+            receiveDefineMacro();
+            consumePacket();
+            return;
+          }
+
+          m_receiveState = ReceiveState::ready;
+        }
+
+        // decodes the parameters of the received packet in the protocol, in which its header was received
+        template<typename t_Schema>
+        bool getReceivedParameters(typename t_Schema::Values& out_values)
+        {
+          size_t length = 0;
+          return t_Schema::decode(m_receivedParameters, m_receivedParameterLength, m_protocol, out_values, length);
+        }
+
+        // setProtocol is handled by the receiver, because it changes how the next packet header is decoded.
+        void receiveSetProtocol()
+        {
+          SetProtocolSchema::Values values;
+          if (not getReceivedParameters<SetProtocolSchema>(values) || not isValidSerialGFXProtocol(std::get<0>(values)))
+          {
+            countParseError();
+            return;
+          }
+
+          m_protocol = static_cast<SerialGFXProtocol>(std::get<0>(values));
+        }
+
+        // setFraming is handled by the receiver, because it changes how the next packet is received.
+        void receiveSetFraming()
+        {
+          SetFramingSchema::Values values;
+          if (not getReceivedParameters<SetFramingSchema>(values)) { countParseError(); return; }
+          m_isFramingEnabled.store(std::get<0>(values) != 0, std::memory_order_release);
+        }
+
+        // resetCredits is handled by the receiver, because the byte count has to start exactly behind it.
+        void receiveResetCredits()
+        {
+          m_receivedByteCount.store(0, std::memory_order_relaxed);
+          m_creditResetCount.store(m_creditResetCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // setBaud is handled by the receiver, which pauses until serviceLink() has acknowledged it and switched the baud.
+        void receiveSetBaud()
+        {
+          SetBaudSchema::Values values;
+          if (not getReceivedParameters<SetBaudSchema>(values)) { countParseError(); return; }
+
+          uint32_t baud = std::get<0>(values);
+          if (not isValidSerialGFXBaud(baud)) { countParseError(); return; }
+
+          m_requestedBaud = baud;
+          m_baudState.store(BaudState::changeRequested, std::memory_order_release);
+        }
+
+        // uint8_t sequence number, then the pattern of getLinkTestByte()
+        void receiveTestLink()
+        {
+          if (m_receivedParameterLength < sizeof(uint8_t)) { countParseError(); return; }
+
+          uint8_t sequence = m_receivedParameters[0];
+          size_t patternLength = m_receivedParameterLength - sizeof(uint8_t);
+          size_t errorCount = patternLength > g_linkTestPatternLength ? patternLength - g_linkTestPatternLength : g_linkTestPatternLength - patternLength;
+
+          for (size_t index = 0; index < min(patternLength, g_linkTestPatternLength); ++index)
+          {
+            if (static_cast<uint8_t>(m_receivedParameters[sizeof(uint8_t) + index]) != getLinkTestByte(sequence, index)) { ++errorCount; }
+          }
+
+          m_linkTestSequence = sequence;
+          m_linkTestErrorCount = min(errorCount, static_cast<size_t>(UINT16_MAX));
+          m_isLinkTestPending.store(true, std::memory_order_release);
+        }
+
+        // The body has to consist of complete batched commands (in v1), which may be run from a macro. A macro, which can not
+        // be defined, is removed, so a later callMacro does not run an outdated body.
+        void receiveDefineMacro()
+        {
+          DefineMacroSchema::Values values;
+          size_t offset = 0;
+          if (not DefineMacroSchema::decode(m_receivedParameters, m_receivedParameterLength, m_protocol, values, offset)) { ++m_macroErrorCount; return; }
+          auto [id, slotCount] = values;
+          if (slotCount > g_maxMacroSlotCount) { ++m_macroErrorCount; m_macroStore.remove(id); return; }
+
+          std::array<MacroSlot, g_maxMacroSlotCount> slots;
+          for (size_t index = 0; index < slotCount; ++index)
+          {
+            MacroSlotSchema::Values slot;
+            size_t length = 0;
+            if (not MacroSlotSchema::decode(m_receivedParameters + offset, m_receivedParameterLength - offset, m_protocol, slot, length))
+            {
+              ++m_macroErrorCount;
+              m_macroStore.remove(id);
+              return;
+            }
+
+            slots[index] = MacroSlot{ std::get<0>(slot), std::get<1>(slot) };
+            offset = offset + length;
+          }
+
+          const char* body = m_receivedParameters + offset;
+          uint16_t bodyLength = m_receivedParameterLength - offset;
+          size_t bodyOffset = 0;
+          SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+          const char* parameters = nullptr;
+          uint16_t parameterLength = 0;
+          while (getNextBatchedCommand(SerialGFXProtocol::v1, body, bodyLength, bodyOffset, commandCode, parameters, parameterLength))
+          {
+            if (commandCode == SerialGFXCommandCode::callMacro) { break; } // macros do not call macros
+          }
+
+          if (bodyOffset != bodyLength || not m_macroStore.define(id, slots.data(), slotCount, body, bodyLength))
+          {
+            ++m_macroErrorCount;
+            m_macroStore.remove(id);
+          }
+        }
+
+        bool isReceivePaused() const
+        {
+          BaudState baudState = m_baudState.load(std::memory_order_acquire);
+          return baudState == BaudState::changeRequested || baudState == BaudState::probeFailed;
+        }
+
+        // must only be called while the receiver is paused
+        void switchBaud(unsigned long in_baud)
+        {
+          m_serial.flush(); // pending responses are still sent at the current baud
+          m_serial.begin(in_baud);
+          m_receiveRing.attach(m_serial);
+          m_baud = in_baud;
+        }
+
+        // Returns to the previous baud, the CPU does the same, when its testLink does not pass.
+        // Whatever is received until then was sent at the other baud, so it is discarded.
+        void fallBackBaud()
+        {
+          m_baudState.store(BaudState::probeFailed, std::memory_order_release);
+          switchBaud(m_previousBaud);
+          m_previousBaud = 0;
+          ++m_baudFallbackCount;
+
+          m_receiveRing.clear();
+          m_lastWrittenCount = m_receiveRing.getWrittenCount(); // the discarded bytes are not traced either
+          m_packetLength = 0;
+          m_discardLength = 0;
+          m_streamLength = 0;
+          m_receivedCommandCode = SerialGFXCommandCode::noCommand;
+          m_receiveState = ReceiveState::header;
+          m_baudState.store(BaudState::stable, std::memory_order_release);
+        }
+
+        // After a change the baud is on probation: g_baudProbeCount testLink have to pass, none may fail
+        // and the next has to come within g_baudProbeTimeoutMillis, otherwise the previous baud is restored.
+        void updateBaud()
+        {
+          BaudState baudState = m_baudState.load(std::memory_order_acquire);
+
+          if (baudState == BaudState::changeRequested)
+          {
+            uint8_t payload[sizeof(uint32_t)];
+            writeValue<uint32_t>(m_requestedBaud, reinterpret_cast<char*>(payload));
+            writeResponse(SerialGFXResponseCode::baudChanged, payload, sizeof(uint32_t));
+
+            m_previousBaud = m_baud;
+            switchBaud(m_requestedBaud);
+            m_isLinkErrorReportEnabled = true;
+            m_passedLinkTestCount = 0;
+            m_timeSinceLinkTest = 0;
+            m_baudState.store(BaudState::probing, std::memory_order_release);
+            return;
+          }
+
+          if (m_isLinkTestPending.load(std::memory_order_acquire))
+          {
+            uint8_t payload[sizeof(uint8_t) + sizeof(uint16_t)] = { m_linkTestSequence };
+            writeValue<uint16_t>(m_linkTestErrorCount, reinterpret_cast<char*>(payload) + sizeof(uint8_t));
+            writeResponse(SerialGFXResponseCode::linkTested, payload, sizeof(payload));
+            m_isLinkTestPending.store(false, std::memory_order_release);
+
+            if (baudState != BaudState::probing) { return; }
+            if (m_linkTestErrorCount > 0) { fallBackBaud(); return; }
+
+            m_timeSinceLinkTest = 0;
+            if (++m_passedLinkTestCount < g_baudProbeCount) { return; }
+            m_previousBaud = 0;
+            m_baudState.store(BaudState::stable, std::memory_order_release);
+            return;
+          }
+
+          if (baudState == BaudState::probing && m_timeSinceLinkTest > g_baudProbeTimeoutMillis) { fallBackBaud(); }
+        }
+
+        // parse errors and corrupted frames tell the CPU, that the link is not stable at the current baud
+        void reportLinkErrors()
+        {
+          if (not m_isLinkErrorReportEnabled) { return; }
+
+          unsigned long linkErrorCount = m_parseErrorCount.load(std::memory_order_acquire) + m_corruptedFrameCount.load(std::memory_order_acquire);
+          if (linkErrorCount == m_reportedLinkErrorCount) { return; }
+
+          uint8_t payload[sizeof(uint16_t)];
+          writeValue<uint16_t>(static_cast<uint16_t>(linkErrorCount), reinterpret_cast<char*>(payload));
+          writeResponse(SerialGFXResponseCode::linkErrors, payload, sizeof(uint16_t));
+          m_reportedLinkErrorCount = linkErrorCount;
+        }
+
+        // All responses, which are not caused by a command, are written from here.
+        // While a baud is on probation, only linkTested is sent, because the CPU may not have switched yet.
+        void serviceLink()
+        {
+          updateBaud();
+          if (m_baudState.load(std::memory_order_acquire) != BaudState::stable) { return; }
+          reportCredits();
+          reportLinkErrors();
+        }
+
+        // Sends the received byte count to the CPU, whenever g_creditReportLength bytes are read since the last report.
+        // atCPU only waits, when g_creditWindowLength (> g_creditReportLength) bytes are unreported, so it always gets a report.
+        // A resetCredits is acknowledged first.
+        void reportCredits()
+        {
+          uint32_t creditResetCount = m_creditResetCount.load(std::memory_order_acquire);
+          if (creditResetCount == 0) { return; }
+
+          if (creditResetCount != m_reportedCreditResetCount)
+          {
+            writeResponse(SerialGFXResponseCode::creditReset, nullptr, 0);
+            m_reportedCreditResetCount = creditResetCount;
+            m_reportedByteCount = 0;
+          }
+
+          uint32_t receivedByteCount = m_receivedByteCount.load(std::memory_order_acquire);
+          uint32_t unreportedCount = receivedByteCount - m_reportedByteCount;
+          if (unreportedCount < g_creditReportLength) { return; }
+
+          uint8_t payload[sizeof(uint32_t)];
+          writeValue<uint32_t>(receivedByteCount, reinterpret_cast<char*>(payload));
+          writeResponse(SerialGFXResponseCode::credit, payload, sizeof(uint32_t));
+          m_reportedByteCount = receivedByteCount;
+        }
+
         void resetParameterBufferOffset()
         {
           m_parameterBufferOffset = 0;
         }
 
         template<typename ParameterType>
-        ParameterType* getParameterFromBuffer(size_t in_bufferOffset = 0)
+        bool getNextParameterFromBuffer(ParameterType& out_value)
         {
-          if (in_bufferOffset >= m_parameterBufferLength) { return nullptr; }
-          return reinterpret_cast<ParameterType*>(m_parameterBuffer.data() + in_bufferOffset);
+          if (m_parameterBufferOffset + sizeof(ParameterType) > m_commandParameterLength) { return false; }
+          out_value = readValue<ParameterType>(m_commandParameters + m_parameterBufferOffset);
+          m_parameterBufferOffset = m_parameterBufferOffset + sizeof(ParameterType);
+          return true;
         }
 
-        template<typename ParameterType>
-        ParameterType* getNextParameterFromBuffer()
+        // One bounds check for all fields of t_Schema, the parameters behind them can be read with getNext*FromBuffer().
+        template<typename t_Schema>
+        bool getParametersFromBuffer(typename t_Schema::Values& out_values)
         {
-          size_t currentParameterBufferOffset = m_parameterBufferOffset;
-          m_parameterBufferOffset = m_parameterBufferOffset + sizeof(ParameterType);
-          return getParameterFromBuffer<ParameterType>(currentParameterBufferOffset);
+          size_t length = 0;
+          if (not t_Schema::decode(m_commandParameters, m_commandParameterLength, m_commandProtocol, out_values, length)) { return false; }
+          m_parameterBufferOffset = length;
+          return true;
+        }
+
+        // the next repetition of t_Schema behind the parameters, which are read so far, see cmd_fillRects()
+        template<typename t_Schema>
+        bool getNextParametersFromBuffer(typename t_Schema::Values& out_values)
+        {
+          if (m_parameterBufferOffset >= m_commandParameterLength) { return false; }
+
+          size_t length = 0;
+          if (not t_Schema::decode(m_commandParameters + m_parameterBufferOffset, m_commandParameterLength - m_parameterBufferOffset,
+                                   m_commandProtocol, out_values, length)) { return false; }
+          m_parameterBufferOffset = m_parameterBufferOffset + length;
+          return true;
         }
 
         const char* getCStringFromBuffer(size_t in_bufferOffset = 0)
         {
-          if (in_bufferOffset >= m_parameterBufferLength) { return nullptr; }
-          return reinterpret_cast<const char*>(m_parameterBuffer.data() + in_bufferOffset);
+          if (in_bufferOffset >= m_commandParameterLength) { return nullptr; }
+          return m_commandParameters + in_bufferOffset;
         }
 
         const char* getNextCStringFromBuffer()
         {
           const char* string = getCStringFromBuffer(m_parameterBufferOffset);
-          m_parameterBufferOffset = m_parameterBufferOffset + halvoeCString::getLength(string, g_maxParameterBufferLength - m_parameterBufferOffset);
+          m_parameterBufferOffset = m_parameterBufferOffset + halvoeCString::getLength(string, m_commandParameterLength - m_parameterBufferOffset);
           return string;
         }
 
         void cmd_swap()
         {
-          if (m_timeSinceLastFrame < g_minFrameTimeMicros) { return; }
-          if (m_isPrintFrameTimeEnabled) { printFrameTime(); }
-          if (m_isPrintFPSEnabled) { printFPS(); }
-          m_dviGFX.swap();
+          if (not m_isFramePacingEnabled && m_isMinFrameTimeEnabled && m_timeSinceLastFrame < g_minFrameTimeMicros) { ++m_droppedSwapCount; return; }
+          m_stats.addFrameTime(m_timeSinceLastFrame);
+          printOverlay();
+          uint8_t isCopyFramebuffer = 0; getNextParameterFromBuffer<uint8_t>(isCopyFramebuffer); // optional, used by the retained mode atCPU
+          m_dviGFX.swap(isCopyFramebuffer != 0); // returns at the vertical blank, in which the frame is presented
           m_timeSinceLastFrame = 0;
+          if (m_isFramePacingEnabled) { writeSwapPresented(); }
+          m_frameRenderMicros = 0;
+        }
+
+        void writeSwapPresented()
+        {
+          ++m_presentedFrameCount;
+          uint8_t payload[3 * sizeof(uint32_t)];
+          writeValue<uint32_t>(m_presentedFrameCount, reinterpret_cast<char*>(payload));
+          writeValue<uint32_t>(micros(), reinterpret_cast<char*>(payload) + sizeof(uint32_t));
+          writeValue<uint32_t>(m_frameRenderMicros, reinterpret_cast<char*>(payload) + 2 * sizeof(uint32_t));
+          writeResponse(SerialGFXResponseCode::swapPresented, payload, sizeof(payload));
+        }
+
+        // Sends the sections of the stats as separate responses, totals last. The counters are reset behind them, if requested.
+        void cmd_queryStats()
+        {
+          QueryStatsSchema::Values values; if (not getParametersFromBuffer<QueryStatsSchema>(values)) { return; }
+          auto [sequence, isReset] = values;
+          const GPUStats& stats = getStats();
+          uint8_t payload[g_maxResponsePayloadLength];
+
+          for (GPUStatsSection section : { GPUStatsSection::commands, GPUStatsSection::frameTimes, GPUStatsSection::totals })
+          {
+            size_t index = 0;
+            do
+            {
+              size_t payloadLength = stats.writeSection(sequence, section, index, payload);
+              writeResponse(SerialGFXResponseCode::stats, payload, payloadLength);
+            }
+            while (section == GPUStatsSection::commands && index < stats.commands.size());
+          }
+
+          if (isReset != 0) { resetStats(); }
+        }
+
+        // With frame pacing no swap is dropped, the GPU waits for the vertical blank instead and acknowledges every swap.
+        // The frame numbers start at 1 behind it.
+        void cmd_setFramePacing()
+        {
+          SetFramePacingSchema::Values values; if (not getParametersFromBuffer<SetFramePacingSchema>(values)) { return; }
+          auto [isEnabled] = values;
+          m_isFramePacingEnabled = isEnabled != 0;
+          m_presentedFrameCount = 0;
+          m_frameRenderMicros = 0;
         }
 
         void cmd_fillScreen()
         {
-          uint16_t* color = getParameterFromBuffer<uint16_t>(); if (color == nullptr) { return; }
-          m_dviGFX.fillScreen(*color);
+          FillScreenSchema::Values values; if (not getParametersFromBuffer<FillScreenSchema>(values)) { return; }
+          auto [color] = values;
+          if (m_isDeferredRasterEnabled) { m_tileBinner.fillScreen(m_dviGFX.getBuffer(), color); }
+          else { fillScreen(m_dviGFX.getBuffer(), color); }
         }
 
         void cmd_fillRect()
         {
-          resetParameterBufferOffset();
-          int16_t*  x      = getNextParameterFromBuffer<int16_t>();  if (x == nullptr) { return; }
-          int16_t*  y      = getNextParameterFromBuffer<int16_t>();  if (y == nullptr) { return; }
-          int16_t*  width  = getNextParameterFromBuffer<int16_t>();  if (width == nullptr) { return; }
-          int16_t*  height = getNextParameterFromBuffer<int16_t>();  if (height == nullptr) { return; }
-          uint16_t* color  = getNextParameterFromBuffer<uint16_t>(); if (color == nullptr) { return; }
-          m_dviGFX.fillRect(*x, *y, *width, *height, *color);
+          FillRectSchema::Values values; if (not getParametersFromBuffer<FillRectSchema>(values)) { return; }
+          auto [x, y, width, height, color] = values;
+          if (m_isDeferredRasterEnabled) { m_tileBinner.fillRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
+          else { fillRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
+        }
+
+        // rectangles of one color, atCPU merges consecutive fillRects into it
+        void cmd_fillRects()
+        {
+          FillRectsSchema::Values values; if (not getParametersFromBuffer<FillRectsSchema>(values)) { return; }
+          auto [color] = values;
+
+          FillRectsRectSchema::Values rect;
+          while (getNextParametersFromBuffer<FillRectsRectSchema>(rect))
+          {
+            auto [x, y, width, height] = rect;
+            if (m_isDeferredRasterEnabled) { m_tileBinner.fillRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
+            else { fillRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
+          }
         }
 
         void cmd_drawRect()
         {
-          resetParameterBufferOffset();
-          int16_t*  x      = getNextParameterFromBuffer<int16_t>();  if (x == nullptr) { return; }
-          int16_t*  y      = getNextParameterFromBuffer<int16_t>();  if (y == nullptr) { return; }
-          int16_t*  width  = getNextParameterFromBuffer<int16_t>();  if (width == nullptr) { return; }
-          int16_t*  height = getNextParameterFromBuffer<int16_t>();  if (height == nullptr) { return; }
-          uint16_t* color  = getNextParameterFromBuffer<uint16_t>(); if (color == nullptr) { return; }
-          m_dviGFX.drawRect(*x, *y, *width, *height, *color);
+          DrawRectSchema::Values values; if (not getParametersFromBuffer<DrawRectSchema>(values)) { return; }
+          auto [x, y, width, height, color] = values;
+          if (m_isDeferredRasterEnabled) { m_tileBinner.drawRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
+          else { drawRect(m_dviGFX.getBuffer(), x, y, width, height, color); }
         }
 
         void cmd_setFont()
         {
-          uint8_t* font = getParameterFromBuffer<uint8_t>(); if (font == nullptr) { return; }
+          SetFontSchema::Values values; if (not getParametersFromBuffer<SetFontSchema>(values)) { return; }
+          auto [font] = values;
           
-          if (GFXfont* fontPointer = nullptr; getFontPointer(static_cast<SerialGFXFont>(*font), fontPointer))
+          if (const GFXfont* fontPointer = nullptr; getFontPointer(static_cast<SerialGFXFont>(font), fontPointer))
           {
             m_dviGFX.setFont(fontPointer);
+            m_glyphAtlas.setFont(fontPointer);
           }
         }
 
         void cmd_setTextSize()
         {
-          uint8_t* size = getParameterFromBuffer<uint8_t>(); if (size == nullptr) { return; }
-          m_dviGFX.setTextSize(*size);
+          SetTextSizeSchema::Values values; if (not getParametersFromBuffer<SetTextSizeSchema>(values)) { return; }
+          auto [size] = values;
+          m_dviGFX.setTextSize(size);
+          m_glyphAtlas.setTextSize(size);
         }
 
         void cmd_setTextColor()
         {
-          uint16_t* color = getParameterFromBuffer<uint16_t>(); if (color == nullptr) { return; }
-          m_dviGFX.setTextColor(*color);
+          SetTextColorSchema::Values values; if (not getParametersFromBuffer<SetTextColorSchema>(values)) { return; }
+          auto [color] = values;
+          m_dviGFX.setTextColor(color);
+          m_glyphAtlas.setTextColor(color);
         }
 
         void cmd_setCursor()
         {
-          resetParameterBufferOffset();
-          int16_t* x = getNextParameterFromBuffer<int16_t>(); if (x == nullptr) { return; }
-          int16_t* y = getNextParameterFromBuffer<int16_t>(); if (y == nullptr) { return; }
-          m_dviGFX.setCursor(*x, *y);
+          SetCursorSchema::Values values; if (not getParametersFromBuffer<SetCursorSchema>(values)) { return; }
+          auto [x, y] = values;
+          m_dviGFX.setCursor(x, y);
+        }
+
+        // Draws like m_dviGFX.print(), but through m_glyphAtlas, if it has the current font.
+        void printText(const char* in_string)
+        {
+          if (not m_isGlyphAtlasEnabled || not m_glyphAtlas.isValid())
+          {
+            m_dviGFX.print(in_string);
+            return;
+          }
+
+          int16_t cursorX = m_dviGFX.getCursorX();
+          int16_t cursorY = m_dviGFX.getCursorY();
+          m_glyphAtlas.print(in_string, cursorX, cursorY, m_dviGFX.getBuffer());
+          m_dviGFX.setCursor(cursorX, cursorY);
         }
 
         void cmd_print()
@@ -136,12 +905,416 @@ namespace halvoeGPU
           #ifdef HALVOE_GPU_DEBUG
             Serial.println(getCStringFromBuffer());
           #endif // HALVOE_GPU_DEBUG
-          m_dviGFX.print(getCStringFromBuffer());
+          printText(getCStringFromBuffer());
         }
 
         void cmd_println()
         {
-          m_dviGFX.println(getCStringFromBuffer());
+          printText(getCStringFromBuffer());
+          printText("\r\n");
+        }
+
+        // setCursor and print in one command
+        bool printTextAt()
+        {
+          PrintAtSchema::Values values; if (not getParametersFromBuffer<PrintAtSchema>(values)) { return false; }
+          auto [x, y] = values;
+          m_dviGFX.setCursor(x, y);
+          printText(getCStringFromBuffer(m_parameterBufferOffset));
+          return true;
+        }
+
+        void cmd_printAt()
+        {
+          printTextAt();
+        }
+
+        void cmd_printlnAt()
+        {
+          if (printTextAt()) { printText("\r\n"); }
+        }
+
+        void writeResponse(SerialGFXResponseCode in_responseCode, const uint8_t* in_payload, uint8_t in_payloadLength)
+        {
+          uint8_t header[g_responseHeaderLength] = { static_cast<uint8_t>(in_responseCode), in_payloadLength };
+          bool isFramingEnabled = m_isFramingEnabled.load(std::memory_order_acquire);
+
+          if (isFramingEnabled) { m_serial.write(g_frameSyncWord, g_frameSyncLength); }
+          m_serial.write(header, g_responseHeaderLength);
+          if (in_payloadLength > 0) { m_serial.write(in_payload, in_payloadLength); }
+
+          if (isFramingEnabled)
+          {
+            uint8_t checksum[g_frameChecksumLength];
+            writeValue<uint16_t>(updateCRC16(updateCRC16(g_crc16InitialValue, header, g_responseHeaderLength), in_payload, in_payloadLength),
+                                 reinterpret_cast<char*>(checksum));
+            m_serial.write(checksum, g_frameChecksumLength);
+          }
+        }
+
+        void writeSpriteResponse(SerialGFXResponseCode in_responseCode, uint8_t in_spriteID)
+        {
+          writeResponse(in_responseCode, &in_spriteID, sizeof(uint8_t));
+        }
+
+        uint8_t* getBlitTarget()
+        {
+          if (m_blitSpriteID == g_blitToFramebuffer) { return m_dviGFX.getBuffer(); }
+
+          SpriteEntry* sprite = m_spriteCache.find(m_blitSpriteID, false);
+          if (sprite == nullptr) { return nullptr; } // the upload is skipped
+          return m_spriteCache.getPixels(*sprite);
+        }
+
+        void cmd_blitBegin()
+        {
+          BlitBeginSchema::Values values; if (not getParametersFromBuffer<BlitBeginSchema>(values)) { return; }
+          auto [x, y, width, height, codec] = values;
+          m_blitSpriteID = g_blitToFramebuffer;
+          if (not m_blitDecoder.begin(Rect{ x, y, width, height }, static_cast<SerialGFXBlitCodec>(codec))) { ++m_blitErrorCount; }
+        }
+
+        // The data is decoded straight into the back buffer, so a blit may span any number of blitData commands.
+        void cmd_blitData()
+        {
+          if (not m_blitDecoder.isActive()) { ++m_blitErrorCount; return; }
+
+          if (not m_blitDecoder.decode(reinterpret_cast<const uint8_t*>(m_commandParameters), m_commandParameterLength, getBlitTarget()))
+          {
+            ++m_blitErrorCount;
+          }
+        }
+
+        // The pixels follow as blitData, like for blitBegin.
+        void cmd_uploadSprite()
+        {
+          UploadSpriteSchema::Values values; if (not getParametersFromBuffer<UploadSpriteSchema>(values)) { return; }
+          auto [id, width, height, codec] = values;
+
+          m_blitSpriteID = id;
+          if (not m_blitDecoder.begin(Rect{ 0, 0, width, height }, static_cast<SerialGFXBlitCodec>(codec), width, height))
+          {
+            ++m_blitErrorCount;
+            return;
+          }
+
+          SpriteIDList evictedIDs;
+          bool isAllocated = m_spriteCache.allocate(id, width, height, evictedIDs) != nullptr;
+          for (size_t index = 0; index < evictedIDs.count; ++index) { writeSpriteResponse(SerialGFXResponseCode::spriteEvicted, evictedIDs.ids[index]); }
+          if (not isAllocated) { writeSpriteResponse(SerialGFXResponseCode::spriteEvicted, id); } // larger than the cache
+        }
+
+        void cmd_drawSprite()
+        {
+          DrawSpriteSchema::Values values; if (not getParametersFromBuffer<DrawSpriteSchema>(values)) { return; }
+          auto [id, x, y] = values;
+          uint8_t transparentColor = 0;
+          bool isTransparent = getNextParameterFromBuffer<uint8_t>(transparentColor); // optional
+
+          SpriteEntry* sprite = m_spriteCache.find(id);
+          if (sprite == nullptr) { writeSpriteResponse(SerialGFXResponseCode::spriteMissing, id); return; }
+          m_spriteCache.draw(*sprite, m_dviGFX.getBuffer(), x, y, isTransparent, transparentColor);
+        }
+
+        // Reads the batched command at io_batchOffset and moves io_batchOffset to the next one.
+        // Returns false at the end of the batch or if the batch is malformed.
+        bool getNextBatchedCommand(SerialGFXProtocol in_protocol, const char* in_batch, uint16_t in_batchLength, size_t& io_batchOffset,
+                                   SerialGFXCommandCode& out_commandCode, const char*& out_parameters, uint16_t& out_parameterLength)
+        {
+          const char* header = in_batch + io_batchOffset;
+          size_t headerLength = getRequiredCommandHeaderLength(in_protocol, header, 0);
+          if (io_batchOffset + headerLength > in_batchLength) { return false; }
+          headerLength = getRequiredCommandHeaderLength(in_protocol, header, headerLength);
+          if (io_batchOffset + headerLength > in_batchLength) { return false; }
+
+          readCommandHeader(in_protocol, header, out_commandCode, out_parameterLength);
+          if (io_batchOffset + headerLength + out_parameterLength > in_batchLength) { return false; } // truncated batch
+          if (out_commandCode == SerialGFXCommandCode::batch) { return false; } // nested batches are not allowed
+          if (out_commandCode == SerialGFXCommandCode::setProtocol) { return false; } // only allowed unbatched, see receiveSetProtocol()
+          if (out_commandCode == SerialGFXCommandCode::resetCredits) { return false; } // only allowed unbatched, see receiveResetCredits()
+          if (out_commandCode == SerialGFXCommandCode::setBaud || out_commandCode == SerialGFXCommandCode::testLink) { return false; } // see receiveSetBaud()
+          if (out_commandCode == SerialGFXCommandCode::setFraming) { return false; } // see receiveSetFraming()
+          if (out_commandCode == SerialGFXCommandCode::defineMacro) { return false; } // see receiveDefineMacro()
+
+          out_parameters = header + headerLength;
+          io_batchOffset = io_batchOffset + getBatchedCommandLength(in_protocol, headerLength, out_parameterLength);
+          return true;
+        }
+
+        void cmd_batch()
+        {
+          const char* batch = m_commandParameters;
+          uint16_t batchLength = m_commandParameterLength;
+          size_t batchOffset = 0;
+          SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+
+          while (getNextBatchedCommand(m_commandProtocol, batch, batchLength, batchOffset, commandCode, m_commandParameters, m_commandParameterLength))
+          {
+            executeCommand(commandCode);
+          }
+        }
+
+        // Writes the body of the called macro with the slot values of the callMacro into m_macroBody.
+        bool expandMacro(const char* in_parameters, uint16_t in_parameterLength, SerialGFXProtocol in_protocol, size_t& out_bodyLength)
+        {
+          CallMacroSchema::Values values;
+          size_t offset = 0;
+          if (not CallMacroSchema::decode(in_parameters, in_parameterLength, in_protocol, values, offset)) { return false; }
+          auto [id] = values;
+
+          std::array<int16_t, g_maxMacroSlotCount> slotValues;
+          size_t slotValueCount = 0;
+          MacroSlotValueSchema::Values slotValue;
+          size_t length = 0;
+          while (offset < in_parameterLength && slotValueCount < slotValues.size() &&
+                 MacroSlotValueSchema::decode(in_parameters + offset, in_parameterLength - offset, in_protocol, slotValue, length))
+          {
+            slotValues[slotValueCount++] = std::get<0>(slotValue);
+            offset = offset + length;
+          }
+
+          return m_macroStore.expand(id, slotValues.data(), slotValueCount, m_macroBody.data(), out_bodyLength);
+        }
+
+        // runs the commands of the macro like a batch (in v1, the protocol of the batch around the call is kept)
+        void cmd_callMacro()
+        {
+          size_t bodyLength = 0;
+          if (not expandMacro(m_commandParameters, m_commandParameterLength, m_commandProtocol, bodyLength)) { ++m_macroErrorCount; return; }
+
+          SerialGFXProtocol protocol = m_commandProtocol;
+          size_t bodyOffset = 0;
+          SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+
+          while (getNextBatchedCommand(SerialGFXProtocol::v1, m_macroBody.data(), bodyLength, bodyOffset, commandCode, m_commandParameters, m_commandParameterLength))
+          {
+            m_commandProtocol = SerialGFXProtocol::v1;
+            if (commandCode != SerialGFXCommandCode::callMacro) { executeCommand(commandCode); } // a slot may have changed a command code
+          }
+
+          m_commandProtocol = protocol;
+        }
+
+        #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_NONE
+          // in_prefixLength bytes in front of the string (the cursor of printAt) go with the first chunk, the line break with the last one
+          bool enqueueStringCommand(SerialGFXCommandCode in_commandCode, const char* in_parameters, uint16_t in_parameterLength, SerialGFXProtocol in_protocol,
+                                    size_t in_prefixLength = 0)
+          {
+            const char* string = in_parameters + in_prefixLength;
+            size_t stringLength = halvoeCString::getLength(string, in_parameterLength - in_prefixLength);
+            bool isLineBreak = in_commandCode == SerialGFXCommandCode::println || in_commandCode == SerialGFXCommandCode::printlnAt;
+
+            do
+            {
+              QueuedCommand* queuedCommand = m_commandQueue.getPushSlot(); if (queuedCommand == nullptr) { return false; }
+              size_t prefixLength = m_enqueueChunkOffset == 0 ? in_prefixLength : 0;
+              size_t chunkLength = min(stringLength - m_enqueueChunkOffset, g_maxQueuedParameterLength - prefixLength - g_zeroTerminatorLength);
+              bool isLastChunk = m_enqueueChunkOffset + chunkLength == stringLength;
+
+              if (prefixLength > 0) { queuedCommand->commandCode = isLastChunk ? in_commandCode : SerialGFXCommandCode::printAt; }
+              else { queuedCommand->commandCode = isLastChunk && isLineBreak ? SerialGFXCommandCode::println : SerialGFXCommandCode::print; }
+              queuedCommand->protocol = in_protocol;
+              memcpy(queuedCommand->parameters.data(), in_parameters, prefixLength);
+              halvoeCString::copy(string + m_enqueueChunkOffset, queuedCommand->parameters.data() + prefixLength, chunkLength);
+              queuedCommand->parameterLength = prefixLength + chunkLength + g_zeroTerminatorLength;
+              m_commandQueue.push();
+
+              m_enqueueChunkOffset = m_enqueueChunkOffset + chunkLength;
+            }
+            while (m_enqueueChunkOffset < stringLength);
+
+            m_enqueueChunkOffset = 0;
+            return true;
+          }
+
+          bool enqueueBlitDataCommand(const char* in_parameters, uint16_t in_parameterLength, SerialGFXProtocol in_protocol)
+          {
+            while (m_enqueueChunkOffset < in_parameterLength)
+            {
+              QueuedCommand* queuedCommand = m_commandQueue.getPushSlot(); if (queuedCommand == nullptr) { return false; }
+              size_t chunkLength = min(in_parameterLength - m_enqueueChunkOffset, g_maxQueuedParameterLength);
+
+              queuedCommand->commandCode = SerialGFXCommandCode::blitData;
+              queuedCommand->protocol = in_protocol;
+              memcpy(queuedCommand->parameters.data(), in_parameters + m_enqueueChunkOffset, chunkLength);
+              queuedCommand->parameterLength = chunkLength;
+              m_commandQueue.push();
+
+              m_enqueueChunkOffset = m_enqueueChunkOffset + chunkLength;
+            }
+
+            m_enqueueChunkOffset = 0;
+            return true;
+          }
+
+          // The commands of the macro are queued one by one, the macros stay with the receiver.
+          bool enqueueMacroCommands(const char* in_parameters, uint16_t in_parameterLength, SerialGFXProtocol in_protocol)
+          {
+            size_t bodyLength = 0;
+            if (not expandMacro(in_parameters, in_parameterLength, in_protocol, bodyLength)) { ++m_macroErrorCount; return true; }
+
+            size_t bodyOffset = m_enqueueMacroOffset;
+            SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+            const char* parameters = nullptr;
+            uint16_t parameterLength = 0;
+
+            while (getNextBatchedCommand(SerialGFXProtocol::v1, m_macroBody.data(), bodyLength, bodyOffset, commandCode, parameters, parameterLength))
+            {
+              if (commandCode != SerialGFXCommandCode::callMacro && not enqueueCommand(commandCode, parameters, parameterLength, SerialGFXProtocol::v1)) { return false; }
+              m_enqueueMacroOffset = bodyOffset;
+            }
+
+            m_enqueueMacroOffset = 0;
+            return true;
+          }
+
+          // Returns false if the queue is full. The receiver stage then retries the same command later.
+          bool enqueueCommand(SerialGFXCommandCode in_commandCode, const char* in_parameters, uint16_t in_parameterLength, SerialGFXProtocol in_protocol)
+          {
+            if (in_commandCode == SerialGFXCommandCode::print || in_commandCode == SerialGFXCommandCode::println)
+            {
+              return enqueueStringCommand(in_commandCode, in_parameters, in_parameterLength, in_protocol);
+            }
+
+            if (in_commandCode == SerialGFXCommandCode::printAt || in_commandCode == SerialGFXCommandCode::printlnAt)
+            {
+              PrintAtSchema::Values values;
+              size_t cursorLength = 0;
+              if (not PrintAtSchema::decode(in_parameters, in_parameterLength, in_protocol, values, cursorLength)) { countParseError(); return true; }
+              return enqueueStringCommand(in_commandCode, in_parameters, in_parameterLength, in_protocol, cursorLength);
+            }
+
+            if (in_commandCode == SerialGFXCommandCode::blitData) { return enqueueBlitDataCommand(in_parameters, in_parameterLength, in_protocol); }
+            if (in_commandCode == SerialGFXCommandCode::callMacro) { return enqueueMacroCommands(in_parameters, in_parameterLength, in_protocol); }
+
+            if (in_parameterLength > g_maxQueuedParameterLength) { countParseError(); return true; }
+
+            QueuedCommand* queuedCommand = m_commandQueue.getPushSlot(); if (queuedCommand == nullptr) { return false; }
+            queuedCommand->commandCode = in_commandCode;
+            queuedCommand->protocol = in_protocol;
+            queuedCommand->parameterLength = in_parameterLength;
+            memcpy(queuedCommand->parameters.data(), in_parameters, in_parameterLength);
+            m_commandQueue.push();
+            return true;
+          }
+
+          bool enqueueReceivedBatch()
+          {
+            size_t batchOffset = m_enqueueBatchOffset;
+            SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+            const char* parameters = nullptr;
+            uint16_t parameterLength = 0;
+
+            while (getNextBatchedCommand(m_protocol, m_receivedParameters, m_receivedParameterLength, batchOffset, commandCode, parameters, parameterLength))
+            {
+              if (not enqueueCommand(commandCode, parameters, parameterLength, m_protocol)) { return false; }
+              m_enqueueBatchOffset = batchOffset;
+            }
+
+            m_enqueueBatchOffset = 0;
+            return true;
+          }
+        #endif // HALVOE_GPU_PIPELINE
+
+        // the commands, which draw into the back buffer (or show it) without m_tileBinner, the deferred rects have to be drawn before them
+        static bool isDrawnImmediately(SerialGFXCommandCode in_commandCode)
+        {
+          switch (in_commandCode)
+          {
+            case SerialGFXCommandCode::swap:
+            case SerialGFXCommandCode::print:
+            case SerialGFXCommandCode::println:
+            case SerialGFXCommandCode::printAt:
+            case SerialGFXCommandCode::printlnAt:
+            case SerialGFXCommandCode::blitData:
+            case SerialGFXCommandCode::drawSprite:
+              return true;
+
+            default:
+              return false;
+          }
+        }
+
+        // draws the deferred rects, the time counts to the render time of the frame (not to the command, which needs them drawn)
+        void renderDeferredRects()
+        {
+          if (m_tileBinner.isEmpty()) { return; }
+          uint32_t beginMicros = micros();
+          m_tileBinner.render(m_dviGFX.getBuffer());
+          m_frameRenderMicros = m_frameRenderMicros + (micros() - beginMicros);
+        }
+
+        void executeCommand(SerialGFXCommandCode in_commandCode)
+        {
+          #ifdef HALVOE_GPU_DEBUG
+            Serial.print("runCommand: ");
+            Serial.println(fromSerialGFXCommandCode(in_commandCode));
+          #endif // HALVOE_GPU_DEBUG
+
+          resetParameterBufferOffset();
+
+          // indexed by the command code, the commands without handler are handled by the receiver (or are no commands)
+          using CommandHandler = void (SerialGFXInterface::*)();
+          static constexpr const std::array<CommandHandler, g_commandCodeCount> handlers = []()
+          {
+            std::array<CommandHandler, g_commandCodeCount> table = {};
+            table[static_cast<size_t>(SerialGFXCommandCode::swap)]             = &SerialGFXInterface::cmd_swap;
+            table[static_cast<size_t>(SerialGFXCommandCode::fillScreen)]       = &SerialGFXInterface::cmd_fillScreen;
+            table[static_cast<size_t>(SerialGFXCommandCode::fillRect)]         = &SerialGFXInterface::cmd_fillRect;
+            table[static_cast<size_t>(SerialGFXCommandCode::drawRect)]         = &SerialGFXInterface::cmd_drawRect;
+            table[static_cast<size_t>(SerialGFXCommandCode::setFont)]          = &SerialGFXInterface::cmd_setFont;
+            table[static_cast<size_t>(SerialGFXCommandCode::setTextSize)]      = &SerialGFXInterface::cmd_setTextSize;
+            table[static_cast<size_t>(SerialGFXCommandCode::setTextColor)]     = &SerialGFXInterface::cmd_setTextColor;
+            table[static_cast<size_t>(SerialGFXCommandCode::setCursor)]        = &SerialGFXInterface::cmd_setCursor;
+            table[static_cast<size_t>(SerialGFXCommandCode::print)]            = &SerialGFXInterface::cmd_print;
+            table[static_cast<size_t>(SerialGFXCommandCode::println)]          = &SerialGFXInterface::cmd_println;
+            table[static_cast<size_t>(SerialGFXCommandCode::batch)]            = &SerialGFXInterface::cmd_batch;
+            table[static_cast<size_t>(SerialGFXCommandCode::blitBegin)]        = &SerialGFXInterface::cmd_blitBegin;
+            table[static_cast<size_t>(SerialGFXCommandCode::blitData)]         = &SerialGFXInterface::cmd_blitData;
+            table[static_cast<size_t>(SerialGFXCommandCode::uploadSprite)]     = &SerialGFXInterface::cmd_uploadSprite;
+            table[static_cast<size_t>(SerialGFXCommandCode::drawSprite)]       = &SerialGFXInterface::cmd_drawSprite;
+            table[static_cast<size_t>(SerialGFXCommandCode::setFramePacing)]   = &SerialGFXInterface::cmd_setFramePacing;
+            table[static_cast<size_t>(SerialGFXCommandCode::queryStats)]       = &SerialGFXInterface::cmd_queryStats;
+            table[static_cast<size_t>(SerialGFXCommandCode::printAt)]          = &SerialGFXInterface::cmd_printAt;
+            table[static_cast<size_t>(SerialGFXCommandCode::printlnAt)]        = &SerialGFXInterface::cmd_printlnAt;
+            table[static_cast<size_t>(SerialGFXCommandCode::fillRects)]        = &SerialGFXInterface::cmd_fillRects;
+            table[static_cast<size_t>(SerialGFXCommandCode::callMacro)]        = &SerialGFXInterface::cmd_callMacro;
+            return table;
+          }();
+
+          size_t index = static_cast<size_t>(in_commandCode);
+          if (index >= g_commandCodeCount || handlers[index] == nullptr) { return; }
+          if (m_isDeferredRasterEnabled && isDrawnImmediately(in_commandCode)) { renderDeferredRects(); }
+
+          uint32_t beginMicros = micros();
+          (this->*handlers[index])();
+          uint32_t commandMicros = micros() - beginMicros;
+          m_stats.addCommand(in_commandCode, commandMicros);
+
+          // the render time of a frame, swapPresented reports it (a batch and a macro are accounted by their commands, the swap waits for the vertical blank)
+          if (in_commandCode != SerialGFXCommandCode::swap && in_commandCode != SerialGFXCommandCode::batch && in_commandCode != SerialGFXCommandCode::callMacro)
+          {
+            m_frameRenderMicros = m_frameRenderMicros + commandMicros;
+          }
+        }
+
+        // The overlay is drawn with its own text color and cursor, the ones of the commands are restored behind it,
+        // so the next frame can rely on the text state, which it has set before (m_glyphAtlas has the same colors as m_dviGFX).
+        void printOverlay()
+        {
+          if (not m_isPrintFrameTimeEnabled && not m_isPrintFPSEnabled) { return; }
+
+          uint16_t textColor = m_glyphAtlas.getTextColor();
+          uint16_t textBackgroundColor = m_glyphAtlas.getTextBackgroundColor();
+          int16_t cursorX = m_dviGFX.getCursorX();
+          int16_t cursorY = m_dviGFX.getCursorY();
+
+          if (m_isPrintFrameTimeEnabled) { printFrameTime(); }
+          if (m_isPrintFPSEnabled) { printFPS(); }
+
+          m_dviGFX.setTextColor(textColor, textBackgroundColor);
+          m_glyphAtlas.setTextColor(textColor, textBackgroundColor);
+          m_dviGFX.setCursor(cursorX, cursorY);
         }
 
         void printFPS()
@@ -150,9 +1323,10 @@ namespace halvoeGPU
           fps.concat(" FPS");
           uint16_t width = 0;
           m_dviGFX.setTextColor(255, 0);
+          m_glyphAtlas.setTextColor(255, 0);
           m_dviGFX.getTextBounds(fps, 0, 0, nullptr, nullptr, &width, nullptr);
           m_dviGFX.setCursor(320 - 5 - width, m_isPrintFrameTimeEnabled ? 15 : 5);
-          m_dviGFX.print(fps);
+          printText(fps.c_str());
         }
 
         void printFrameTime()
@@ -161,9 +1335,10 @@ namespace halvoeGPU
           frameTime.concat(" micros");
           uint16_t width = 0;
           m_dviGFX.setTextColor(255, 0);
+          m_glyphAtlas.setTextColor(255, 0);
           m_dviGFX.getTextBounds(frameTime, 0, 0, nullptr, nullptr, &width, nullptr);
           m_dviGFX.setCursor(320 - 5 - width, 5);
-          m_dviGFX.print(frameTime);
+          printText(frameTime.c_str());
         }
 
       public:
@@ -177,17 +1352,22 @@ namespace halvoeGPU
           writeReady(false);
 
           if (not m_dviGFX.begin()) { return false; } // false if (probably) insufficient RAM
+          if (not m_receiveRing.begin()) { return false; }  // before the sprite cache takes what is left
           m_dviGFX.cp437(true);
+          m_glyphAtlas.cp437(true);
           setupDefaultPalette();
 
+          // after m_dviGFX.begin(), so the framebuffers are allocated first
           #ifdef HALVOE_GPU_DEBUG
-            if (not m_serial.setFIFOSize(GPU_SERIAL_RECEIVE_FIFO_SIZE))
-            { Serial.println("setFIFOSize(" + String(GPU_SERIAL_RECEIVE_FIFO_SIZE) + ") failed!"); }
+            if (not m_spriteCache.begin()) { Serial.println("sprite cache: no memory left!"); }
+            else { Serial.println("sprite cache: " + String(m_spriteCache.getArenaLength()) + " bytes"); }
           #else
-            m_serial.setFIFOSize(GPU_SERIAL_RECEIVE_FIFO_SIZE);
+            m_spriteCache.begin();
           #endif // HALVOE_GPU_DEBUG
 
           m_serial.begin(fromSerialGFXBaud(in_baud));
+          if (not m_receiveRing.attach(m_serial)) { return false; } // no DMA channel left
+          m_baud = fromSerialGFXBaud(in_baud);
           elapsedMillis timeSinceBegin;
           while (not m_serial && timeSinceBegin < 10000) {}
           return m_serial;
@@ -225,53 +1405,227 @@ namespace halvoeGPU
           m_dviGFX.swap();
         }
 
+        // Decodes whatever bytes m_receiveRing already holds and returns immediately.
+        // Returns true, as soon as a complete command is ready for runCommand().
         bool receiveCommand()
         {
-          if (m_receivedCommandCode != SerialGFXCommandCode::noCommand) { return false; }
+          if (not isReceivePaused() && m_receiveState != ReceiveState::ready)
+          {
+            updateReceiveRing();
+            if (m_receiveState == ReceiveState::discard) { discardParameters(); }
+            if (m_receiveState == ReceiveState::header) { receiveHeader(); }
+            if (m_receiveState == ReceiveState::stream) { receiveStream(); }
+            if (m_receiveState == ReceiveState::parameters) { receiveParameters(); }
+          }
+
+          #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_TIMER_IRQ
+            serviceLink(); // otherwise in pumpRenderer(), so all responses are written from the same context
+          #endif // HALVOE_GPU_PIPELINE
+          return m_receiveState == ReceiveState::ready;
+        }
+
+        bool runCommand()
+        {
+          if (m_receiveState != ReceiveState::ready) { return false; }
+          m_commandParameters = m_receivedParameters;
+          m_commandParameterLength = m_receivedParameterLength;
+          m_commandProtocol = m_protocol;
+          executeCommand(m_receivedCommandCode);
 
-          // 2 * m_commandBuffer.size() because we read two times the size of m_commandBuffer
-          if (static_cast<size_t>(m_serial.available()) >= 2 * m_commandBuffer.size())
+          m_receivedCommandCode = SerialGFXCommandCode::noCommand;
+          consumePacket(); // only now, the parameters were read from m_receiveRing
+          return true;
+        }
+
+        #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_NONE
+          // receiver stage: decodes received commands into m_commandQueue, until the serial or the queue runs dry/full
+          void pumpReceiver()
           {
-            size_t receivedBytesCount = m_serial.readBytes(m_commandBuffer.data(), m_commandBuffer.size());
-            if (receivedBytesCount != m_commandBuffer.size()) { return false; }
-            m_receivedCommandCode = toSerialGFXCommandCode(*reinterpret_cast<uint16_t*>(m_commandBuffer.data()));
+            while (receiveCommand())
+            {
+              if (m_receivedCommandCode == SerialGFXCommandCode::batch)
+              {
+                if (not enqueueReceivedBatch()) { return; }
+              }
+              else if (not enqueueCommand(m_receivedCommandCode, m_receivedParameters, m_receivedParameterLength, m_protocol))
+              {
+                return;
+              }
 
-            receivedBytesCount = m_serial.readBytes(m_commandBuffer.data(), m_commandBuffer.size());
-            if (receivedBytesCount != m_commandBuffer.size()) { return false; }
-            m_parameterBufferLength = *reinterpret_cast<uint16_t*>(m_commandBuffer.data());
+              m_receivedCommandCode = SerialGFXCommandCode::noCommand;
+              consumePacket();
+            }
+          }
 
-            receivedBytesCount = m_serial.readBytes(m_parameterBuffer.data(), m_parameterBufferLength);
-            if (receivedBytesCount != m_parameterBufferLength) { return false; }
+          // renderer stage: executes all commands queued by pumpReceiver()
+          void pumpRenderer()
+          {
+            #if HALVOE_GPU_PIPELINE == HALVOE_GPU_PIPELINE_TIMER_IRQ
+              serviceLink();
+            #endif // HALVOE_GPU_PIPELINE
 
-            return true;
+            while (QueuedCommand* queuedCommand = m_commandQueue.getFront())
+            {
+              m_commandParameters = queuedCommand->parameters.data();
+              m_commandParameterLength = queuedCommand->parameterLength;
+              m_commandProtocol = queuedCommand->protocol;
+              executeCommand(queuedCommand->commandCode);
+              m_commandQueue.pop();
+            }
           }
+        #endif // HALVOE_GPU_PIPELINE
 
-          return false;
+        unsigned long getParseErrorCount() const
+        {
+          return m_parseErrorCount.load(std::memory_order_acquire);
         }
 
-        bool runCommand()
+        unsigned long getBaud() const
         {
-          #ifdef HALVOE_GPU_DEBUG
-            Serial.print("runCommand: ");
-            Serial.println(fromSerialGFXCommandCode(m_receivedCommandCode));
-          #endif // HALVOE_GPU_DEBUG
+          return m_baud;
+        }
 
-          switch (m_receivedCommandCode)
-          {
-            case SerialGFXCommandCode::swap:         cmd_swap(); break;
-            case SerialGFXCommandCode::fillScreen:   cmd_fillScreen(); break;
-            case SerialGFXCommandCode::fillRect:     cmd_fillRect(); break;
-            case SerialGFXCommandCode::drawRect:     cmd_drawRect(); break;
-            case SerialGFXCommandCode::setFont:      cmd_setFont(); break;
-            case SerialGFXCommandCode::setTextSize:  cmd_setTextSize(); break;
-            case SerialGFXCommandCode::setTextColor: cmd_setTextColor(); break;
-            case SerialGFXCommandCode::setCursor:    cmd_setCursor(); break;
-            case SerialGFXCommandCode::print:        cmd_print(); break;
-            case SerialGFXCommandCode::println:      cmd_println(); break;
-          }
+        // frames with an invalid header or checksum
+        unsigned long getCorruptedFrameCount() const
+        {
+          return m_corruptedFrameCount.load(std::memory_order_acquire);
+        }
 
-          m_receivedCommandCode = SerialGFXCommandCode::noCommand;
-          return true;
+        // bytes skipped, while searching for the next frame
+        unsigned long getDiscardedByteCount() const
+        {
+          return m_discardedByteCount;
+        }
+
+        // how often the DMA has overwritten bytes of m_receiveRing, before they were decoded
+        unsigned long getReceiveOverrunCount() const
+        {
+          return m_receiveRing.getOverrunCount();
+        }
+
+        // how often a baud change was reverted, because its testLink did not pass
+        unsigned long getBaudFallbackCount() const
+        {
+          return m_baudFallbackCount;
+        }
+
+        // blits with an invalid rect or codec, malformed or unexpected blitData
+        unsigned long getBlitErrorCount() const
+        {
+          return m_blitErrorCount;
+        }
+
+        // Records the received bytes with a timestamp into io_trace, see halvoeTrace.hpp, from the packet on,
+        // which is received now. host/replayTrace.cpp runs the trace through atGPU again. With HALVOE_GPU_PIPELINE_TIMER_IRQ
+        // the receiver writes the records in the timer IRQ, so io_trace has to be usable there.
+        void beginCapture(Print& io_trace)
+        {
+          m_trace.begin(io_trace, TraceSide::gpu, m_protocol, m_isFramingEnabled.load(std::memory_order_relaxed), m_baud);
+          if (m_receiveRing.getAvailableLength() > 0) { writeTraceRecord(m_receiveRing.getWrittenCount() - m_receiveRing.getAvailableLength()); }
+        }
+
+        void endCapture()
+        {
+          m_trace.end();
+        }
+
+        bool isCapturing() const
+        {
+          return m_trace.isEnabled();
+        }
+
+        // bytes of the trace, which the Print of beginCapture() did not take
+        unsigned long getCaptureLostByteCount() const
+        {
+          return m_trace.getLostByteCount();
+        }
+
+        // Without frame pacing, swaps within g_minFrameTimeMicros of the last one are dropped. Disabling that is meant for
+        // replaying a trace as fast as possible, where the timing of the swaps is not the one of the capture.
+        void setMinFrameTimeEnabled(bool in_isEnabled)
+        {
+          m_isMinFrameTimeEnabled = in_isEnabled;
+        }
+
+        // packets, which were too long for m_receiveRing and were run in chunks as they arrived
+        unsigned long getStreamedPacketCount() const
+        {
+          return m_streamedPacketCount;
+        }
+
+        // defineMacro, which could not be defined, and callMacro of macros, which are not defined
+        unsigned long getMacroErrorCount() const
+        {
+          return m_macroErrorCount;
+        }
+
+        const MacroStore& getMacroStore() const
+        {
+          return m_macroStore;
+        }
+
+        // The glyph atlas draws the same pixels as Adafruit_GFX, disabling it is meant for comparisons.
+        void setGlyphAtlasEnabled(bool in_isEnabled)
+        {
+          m_isGlyphAtlasEnabled = in_isEnabled;
+        }
+
+        // With the deferred rasterizer, fillScreen, fillRect(s) and drawRect are binned into tiles and drawn together,
+        // before anything else is drawn (at the latest at the swap). The pixels are the same, the overdraw is less.
+        void setDeferredRasterEnabled(bool in_isEnabled)
+        {
+          if (not in_isEnabled) { renderDeferredRects(); }
+          m_isDeferredRasterEnabled = in_isEnabled;
+        }
+
+        bool isDeferredRasterEnabled() const
+        {
+          return m_isDeferredRasterEnabled;
+        }
+
+        const TileBinner& getTileBinner() const
+        {
+          return m_tileBinner;
+        }
+
+        const SpriteCache& getSpriteCache() const
+        {
+          return m_spriteCache;
+        }
+
+        // the counters, which queryStats sends, as of now
+        const GPUStats& getStats()
+        {
+          GPUStats::Totals& totals = m_stats.totals;
+          totals.receivedByteCount = m_receiveRing.getWrittenCount();
+          totals.receiveHighWaterLength = m_receiveHighWaterLength;
+          totals.receiveOverrunCount = m_receiveRing.getOverrunCount();
+          totals.droppedSwapCount = m_droppedSwapCount;
+          totals.parseErrorCount = m_parseErrorCount.load(std::memory_order_acquire);
+          totals.corruptedFrameCount = m_corruptedFrameCount.load(std::memory_order_acquire);
+          totals.blitErrorCount = m_blitErrorCount;
+          totals.deferredPixelCount = m_tileBinner.getDeferredPixelCount();
+          totals.writtenDeferredPixelCount = m_tileBinner.getWrittenPixelCount();
+          totals.culledRectCount = m_tileBinner.getCulledRectCount();
+          return m_stats;
+        }
+
+        // Resets the command counters, the frame time histogram and the high-water mark, the other totals keep counting.
+        void resetStats()
+        {
+          m_stats.clear();
+          m_receiveHighWaterLength = 0;
+        }
+
+        bool isFramePacingEnabled() const
+        {
+          return m_isFramePacingEnabled;
+        }
+
+        // swaps presented since setFramePacing
+        uint32_t getPresentedFrameCount() const
+        {
+          return m_presentedFrameCount;
         }
 
         unsigned long getFrameTimeMicros() const
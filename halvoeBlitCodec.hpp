@@ -0,0 +1,384 @@
+#pragma once
+
+#include <array>
+#include <string.h>
+
+#include "halvoeRect.hpp"
+#include "SerialGFXInterface.hpp"
+
+// Codecs of the blitData command (8-bit palette indices, row by row):
+// raw: the pixels as they are
+// rle: opcode < 0x80: (opcode + 1) literal pixels follow,
+//      opcode >= 0x80: the next pixel is repeated (opcode - 0x80 + 2) times
+// lz:  opcode < 0x80: (opcode + 1) literal pixels follow,
+//      opcode >= 0x80: 1LLLLLDD DDDDDDDD copies pixels decoded before, distance = D + 1 (1..1024),
+//      length = L + 3 (3..33), L = 31: one more byte E follows and length = E + 34 (34..289).
+//      A distance smaller than the length repeats pixels, so runs are matches with distance 1.
+
+namespace halvoeGPU
+{
+  constexpr const size_t g_maxBlitDataChunkLength = g_maxParameterBufferLength < 1024 ? g_maxParameterBufferLength : 1024; // per blitData
+  constexpr const size_t g_maxBlitLiteralLength = 128;
+  constexpr const size_t g_maxBlitRunLength = 129;
+  constexpr const size_t g_minBlitRunLength = 3; // shorter runs are cheaper as literals
+  constexpr const size_t g_blitHistoryLength = 1024; // = maximum lz distance, power of two
+  constexpr const size_t g_minBlitMatchLength = 3;
+  constexpr const size_t g_maxBlitShortMatchLength = 33;
+  constexpr const size_t g_maxBlitMatchLength = 289;
+  constexpr const size_t g_blitHashBits = 12;
+
+  enum class BlitDecodeState : uint8_t
+  {
+    opcode = 0,
+    literal,
+    runValue,
+    matchDistance,
+    matchLength
+  };
+
+  // Decodes blitData chunks directly into a target buffer (the framebuffer or a sprite) of in_targetWidth x in_targetHeight.
+  // Opcodes may be split between chunks, pixels outside of the target are skipped.
+  class BlitDecoder
+  {
+    private:
+      Rect m_rect;
+      uint16_t m_targetWidth = g_screenWidth;
+      uint16_t m_targetHeight = g_screenHeight;
+      SerialGFXBlitCodec m_codec = SerialGFXBlitCodec::raw;
+      uint32_t m_pixelCount = 0;
+      uint32_t m_decodedCount = 0;
+      int16_t m_column = 0;
+      int16_t m_row = 0;
+
+      BlitDecodeState m_state = BlitDecodeState::opcode;
+      uint8_t m_opcode = 0;
+      size_t m_remainingLength = 0;
+      size_t m_matchDistance = 0;
+      std::array<uint8_t, g_blitHistoryLength> m_history;
+
+    private:
+      void advance(size_t in_count)
+      {
+        m_decodedCount = m_decodedCount + in_count;
+        m_column = m_column + in_count;
+        if (m_column == m_rect.width) { m_column = 0; ++m_row; }
+      }
+
+      // Returns the part of the next in_count pixels of the current row, which is inside of the target, as target offset.
+      bool getVisibleSegment(size_t in_count, size_t& out_skipCount, size_t& out_targetOffset, size_t& out_visibleCount) const
+      {
+        int32_t y = static_cast<int32_t>(m_rect.y) + m_row;
+        if (y < 0 || y >= m_targetHeight) { return false; }
+
+        int32_t left = static_cast<int32_t>(m_rect.x) + m_column;
+        int32_t right = left + static_cast<int32_t>(in_count);
+        int32_t visibleLeft = max(left, static_cast<int32_t>(0));
+        int32_t visibleRight = min(right, static_cast<int32_t>(m_targetWidth));
+        if (visibleLeft >= visibleRight) { return false; }
+
+        out_skipCount = visibleLeft - left;
+        out_targetOffset = static_cast<size_t>(y) * m_targetWidth + visibleLeft;
+        out_visibleCount = visibleRight - visibleLeft;
+        return true;
+      }
+
+      void putPixels(const uint8_t* in_pixels, size_t in_count, uint8_t* io_target)
+      {
+        in_count = min(in_count, static_cast<size_t>(m_pixelCount - m_decodedCount));
+
+        while (in_count > 0)
+        {
+          size_t segmentLength = min(in_count, static_cast<size_t>(m_rect.width - m_column));
+          size_t skipCount = 0, targetOffset = 0, visibleCount = 0;
+          if (io_target != nullptr && getVisibleSegment(segmentLength, skipCount, targetOffset, visibleCount))
+          {
+            memcpy(io_target + targetOffset, in_pixels + skipCount, visibleCount);
+          }
+
+          if (m_codec == SerialGFXBlitCodec::lz)
+          {
+            for (size_t index = 0; index < segmentLength; ++index) { m_history[(m_decodedCount + index) & (g_blitHistoryLength - 1)] = in_pixels[index]; }
+          }
+
+          advance(segmentLength);
+          in_pixels = in_pixels + segmentLength;
+          in_count = in_count - segmentLength;
+        }
+      }
+
+      void fillPixels(uint8_t in_pixel, size_t in_count, uint8_t* io_target)
+      {
+        in_count = min(in_count, static_cast<size_t>(m_pixelCount - m_decodedCount));
+
+        while (in_count > 0)
+        {
+          size_t segmentLength = min(in_count, static_cast<size_t>(m_rect.width - m_column));
+          size_t skipCount = 0, targetOffset = 0, visibleCount = 0;
+          if (io_target != nullptr && getVisibleSegment(segmentLength, skipCount, targetOffset, visibleCount))
+          {
+            memset(io_target + targetOffset, in_pixel, visibleCount);
+          }
+
+          advance(segmentLength);
+          in_count = in_count - segmentLength;
+        }
+      }
+
+      bool copyMatch(size_t in_length, uint8_t* io_target)
+      {
+        if (m_matchDistance > m_decodedCount) { return false; } // refers to pixels before the image
+
+        in_length = min(in_length, static_cast<size_t>(m_pixelCount - m_decodedCount));
+        for (size_t index = 0; index < in_length; ++index)
+        {
+          uint8_t pixel = m_history[(m_decodedCount - m_matchDistance) & (g_blitHistoryLength - 1)];
+          putPixels(&pixel, 1, io_target);
+        }
+
+        return true;
+      }
+
+    public:
+      bool begin(const Rect& in_rect, SerialGFXBlitCodec in_codec, uint16_t in_targetWidth = g_screenWidth, uint16_t in_targetHeight = g_screenHeight)
+      {
+        m_pixelCount = 0;
+        if (in_rect.isEmpty() || not isValidSerialGFXBlitCodec(static_cast<uint8_t>(in_codec))) { return false; }
+
+        m_rect = in_rect;
+        m_targetWidth = in_targetWidth;
+        m_targetHeight = in_targetHeight;
+        m_codec = in_codec;
+        m_pixelCount = static_cast<uint32_t>(in_rect.width) * static_cast<uint32_t>(in_rect.height);
+        m_decodedCount = 0;
+        m_column = 0;
+        m_row = 0;
+        m_state = BlitDecodeState::opcode;
+        return true;
+      }
+
+      bool isActive() const
+      {
+        return m_decodedCount < m_pixelCount;
+      }
+
+      // Returns false if the data is malformed, the rest of the image is skipped then.
+      bool decode(const uint8_t* in_data, size_t in_length, uint8_t* io_target)
+      {
+        size_t offset = 0;
+
+        while (offset < in_length && isActive())
+        {
+          if (m_codec == SerialGFXBlitCodec::raw)
+          {
+            putPixels(in_data + offset, in_length - offset, io_target);
+            return true;
+          }
+
+          switch (m_state)
+          {
+            case BlitDecodeState::opcode:
+              m_opcode = in_data[offset++];
+              if (m_opcode < 0x80) { m_remainingLength = m_opcode + 1; m_state = BlitDecodeState::literal; }
+              else if (m_codec == SerialGFXBlitCodec::rle) { m_remainingLength = m_opcode - 0x80 + 2; m_state = BlitDecodeState::runValue; }
+              else { m_state = BlitDecodeState::matchDistance; }
+              break;
+
+            case BlitDecodeState::literal:
+            {
+              size_t count = min(m_remainingLength, in_length - offset);
+              putPixels(in_data + offset, count, io_target);
+              offset = offset + count;
+              m_remainingLength = m_remainingLength - count;
+              if (m_remainingLength == 0) { m_state = BlitDecodeState::opcode; }
+              break;
+            }
+
+            case BlitDecodeState::runValue:
+              fillPixels(in_data[offset++], m_remainingLength, io_target);
+              m_state = BlitDecodeState::opcode;
+              break;
+
+            case BlitDecodeState::matchDistance:
+            {
+              m_matchDistance = (((m_opcode & 0x03) << 8) | in_data[offset++]) + 1;
+              size_t lengthCode = (m_opcode >> 2) & 0x1F;
+              if (lengthCode == 0x1F) { m_state = BlitDecodeState::matchLength; break; }
+              m_state = BlitDecodeState::opcode;
+              if (not copyMatch(lengthCode + g_minBlitMatchLength, io_target)) { m_pixelCount = 0; return false; }
+              break;
+            }
+
+            case BlitDecodeState::matchLength:
+              m_state = BlitDecodeState::opcode;
+              if (not copyMatch(in_data[offset++] + g_maxBlitShortMatchLength + 1, io_target)) { m_pixelCount = 0; return false; }
+              break;
+          }
+        }
+
+        return true;
+      }
+  };
+
+  // Encodes pixels for the blitData command. SinkType needs a bool write(const uint8_t* in_data, size_t in_length).
+  class BlitEncoder
+  {
+    private:
+      std::array<int32_t, 1 << g_blitHashBits> m_hashTable;
+
+    private:
+      class LengthSink
+      {
+        public:
+          size_t m_length = 0;
+
+          bool write(const uint8_t*, size_t in_length)
+          {
+            m_length = m_length + in_length;
+            return true;
+          }
+      };
+
+      static uint32_t getHash(const uint8_t* in_pixels)
+      {
+        uint32_t value = in_pixels[0] | (in_pixels[1] << 8) | (in_pixels[2] << 16);
+        return (value * 2654435761u) >> (32 - g_blitHashBits);
+      }
+
+      static size_t getMatchLength(const uint8_t* in_pixels, size_t in_count, size_t in_source, size_t in_index)
+      {
+        size_t maxLength = min(in_count - in_index, g_maxBlitMatchLength);
+        size_t length = 0;
+        while (length < maxLength && in_pixels[in_source + length] == in_pixels[in_index + length]) { ++length; }
+        return length;
+      }
+
+      template<typename SinkType>
+      static bool writeLiterals(const uint8_t* in_pixels, size_t in_count, SinkType& io_sink)
+      {
+        while (in_count > 0)
+        {
+          size_t literalLength = min(in_count, g_maxBlitLiteralLength);
+          uint8_t opcode = literalLength - 1;
+          if (not io_sink.write(&opcode, 1) || not io_sink.write(in_pixels, literalLength)) { return false; }
+          in_pixels = in_pixels + literalLength;
+          in_count = in_count - literalLength;
+        }
+
+        return true;
+      }
+
+      template<typename SinkType>
+      bool encodeRLE(const uint8_t* in_pixels, size_t in_count, SinkType& io_sink)
+      {
+        size_t index = 0;
+        size_t literalBegin = 0;
+
+        while (index < in_count)
+        {
+          size_t runLength = 1;
+          while (index + runLength < in_count && runLength < g_maxBlitRunLength && in_pixels[index + runLength] == in_pixels[index]) { ++runLength; }
+
+          if (runLength < g_minBlitRunLength) { index = index + runLength; continue; }
+
+          if (not writeLiterals(in_pixels + literalBegin, index - literalBegin, io_sink)) { return false; }
+          uint8_t run[] = { static_cast<uint8_t>(0x80 + runLength - 2), in_pixels[index] };
+          if (not io_sink.write(run, sizeof(run))) { return false; }
+          index = index + runLength;
+          literalBegin = index;
+        }
+
+        return writeLiterals(in_pixels + literalBegin, in_count - literalBegin, io_sink);
+      }
+
+      template<typename SinkType>
+      bool encodeLZ(const uint8_t* in_pixels, size_t in_count, SinkType& io_sink)
+      {
+        m_hashTable.fill(-1);
+        size_t index = 0;
+        size_t literalBegin = 0;
+
+        while (index < in_count)
+        {
+          size_t bestLength = 0;
+          size_t bestDistance = 0;
+
+          if (index + g_minBlitMatchLength <= in_count)
+          {
+            uint32_t hash = getHash(in_pixels + index);
+            int32_t candidate = m_hashTable[hash];
+            m_hashTable[hash] = index;
+
+            if (candidate >= 0 && index - candidate <= g_blitHistoryLength)
+            {
+              bestLength = getMatchLength(in_pixels, in_count, candidate, index);
+              bestDistance = index - candidate;
+            }
+
+            if (index > 0 && bestLength < g_maxBlitMatchLength) // runs
+            {
+              size_t runLength = getMatchLength(in_pixels, in_count, index - 1, index);
+              if (runLength > bestLength) { bestLength = runLength; bestDistance = 1; }
+            }
+          }
+
+          if (bestLength < g_minBlitMatchLength) { ++index; continue; }
+
+          if (not writeLiterals(in_pixels + literalBegin, index - literalBegin, io_sink)) { return false; }
+
+          uint8_t match[3];
+          size_t distanceCode = bestDistance - 1;
+          size_t lengthCode = bestLength <= g_maxBlitShortMatchLength ? bestLength - g_minBlitMatchLength : 0x1F;
+          match[0] = static_cast<uint8_t>(0x80 | (lengthCode << 2) | (distanceCode >> 8));
+          match[1] = static_cast<uint8_t>(distanceCode & 0xFF);
+          match[2] = static_cast<uint8_t>(bestLength - g_maxBlitShortMatchLength - 1);
+          if (not io_sink.write(match, lengthCode == 0x1F ? 3 : 2)) { return false; }
+
+          for (size_t matchIndex = index + 1; matchIndex < index + bestLength && matchIndex + g_minBlitMatchLength <= in_count; ++matchIndex)
+          {
+            m_hashTable[getHash(in_pixels + matchIndex)] = matchIndex;
+          }
+
+          index = index + bestLength;
+          literalBegin = index;
+        }
+
+        return writeLiterals(in_pixels + literalBegin, in_count - literalBegin, io_sink);
+      }
+
+    public:
+      template<typename SinkType>
+      bool encode(SerialGFXBlitCodec in_codec, const uint8_t* in_pixels, size_t in_count, SinkType& io_sink)
+      {
+        switch (in_codec)
+        {
+          case SerialGFXBlitCodec::raw: return io_sink.write(in_pixels, in_count);
+          case SerialGFXBlitCodec::rle: return encodeRLE(in_pixels, in_count, io_sink);
+          case SerialGFXBlitCodec::lz:  return encodeLZ(in_pixels, in_count, io_sink);
+        }
+
+        return false;
+      }
+
+      size_t getEncodedLength(SerialGFXBlitCodec in_codec, const uint8_t* in_pixels, size_t in_count)
+      {
+        LengthSink sink;
+        encode(in_codec, in_pixels, in_count, sink);
+        return sink.m_length;
+      }
+
+      // The codec with the shortest encoding, raw wins ties, because it decodes fastest.
+      SerialGFXBlitCodec getBestCodec(const uint8_t* in_pixels, size_t in_count)
+      {
+        SerialGFXBlitCodec bestCodec = SerialGFXBlitCodec::raw;
+        size_t bestLength = in_count;
+
+        for (SerialGFXBlitCodec codec : { SerialGFXBlitCodec::rle, SerialGFXBlitCodec::lz })
+        {
+          size_t length = getEncodedLength(codec, in_pixels, in_count);
+          if (length < bestLength) { bestCodec = codec; bestLength = length; }
+        }
+
+        return bestCodec;
+      }
+  };
+}
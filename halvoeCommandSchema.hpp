@@ -0,0 +1,258 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  // A field encodes one value of a command in both protocols. encode() and decode() return the length of the field,
+  // decode() returns 0 for a field, which can not be decoded. Neither checks the bounds, the schema does that once per command.
+  struct UInt8Field
+  {
+    using ValueType = uint8_t;
+
+    static constexpr size_t getMaxLength(SerialGFXProtocol)
+    {
+      return sizeof(uint8_t);
+    }
+
+    static size_t encode(char* out_buffer, SerialGFXProtocol, uint8_t in_value)
+    {
+      out_buffer[0] = static_cast<char>(in_value);
+      return sizeof(uint8_t);
+    }
+
+    static size_t decode(const char* in_buffer, SerialGFXProtocol, uint8_t& out_value)
+    {
+      out_value = static_cast<uint8_t>(in_buffer[0]);
+      return sizeof(uint8_t);
+    }
+  };
+
+  struct UInt16Field
+  {
+    using ValueType = uint16_t;
+
+    static constexpr size_t getMaxLength(SerialGFXProtocol)
+    {
+      return sizeof(uint16_t);
+    }
+
+    static size_t encode(char* out_buffer, SerialGFXProtocol, uint16_t in_value)
+    {
+      writeValue<uint16_t>(in_value, out_buffer);
+      return sizeof(uint16_t);
+    }
+
+    static size_t decode(const char* in_buffer, SerialGFXProtocol, uint16_t& out_value)
+    {
+      out_value = readValue<uint16_t>(in_buffer);
+      return sizeof(uint16_t);
+    }
+  };
+
+  struct UInt32Field
+  {
+    using ValueType = uint32_t;
+
+    static constexpr size_t getMaxLength(SerialGFXProtocol)
+    {
+      return sizeof(uint32_t);
+    }
+
+    static size_t encode(char* out_buffer, SerialGFXProtocol, uint32_t in_value)
+    {
+      writeValue<uint32_t>(in_value, out_buffer);
+      return sizeof(uint32_t);
+    }
+
+    static size_t decode(const char* in_buffer, SerialGFXProtocol, uint32_t& out_value)
+    {
+      out_value = readValue<uint32_t>(in_buffer);
+      return sizeof(uint32_t);
+    }
+  };
+
+  // uint16_t (v1) or uint8_t palette index (compact)
+  struct ColorField
+  {
+    using ValueType = uint16_t;
+
+    static constexpr size_t getMaxLength(SerialGFXProtocol in_protocol)
+    {
+      return in_protocol == SerialGFXProtocol::compact ? sizeof(uint8_t) : sizeof(uint16_t);
+    }
+
+    static size_t encode(char* out_buffer, SerialGFXProtocol in_protocol, uint16_t in_color)
+    {
+      if (in_protocol == SerialGFXProtocol::compact) { return UInt8Field::encode(out_buffer, in_protocol, static_cast<uint8_t>(in_color)); }
+      writeValue<uint16_t>(in_color, out_buffer);
+      return sizeof(uint16_t);
+    }
+
+    static size_t decode(const char* in_buffer, SerialGFXProtocol in_protocol, uint16_t& out_color)
+    {
+      if (in_protocol == SerialGFXProtocol::compact) { out_color = static_cast<uint8_t>(in_buffer[0]); return sizeof(uint8_t); }
+      out_color = readValue<uint16_t>(in_buffer);
+      return sizeof(uint16_t);
+    }
+  };
+
+  // int16_t (v1) or zigzag varint (compact)
+  struct CoordinateField
+  {
+    using ValueType = int16_t;
+
+    static constexpr size_t getMaxLength(SerialGFXProtocol in_protocol)
+    {
+      return in_protocol == SerialGFXProtocol::compact ? g_maxCompactVarUInt16Length : sizeof(int16_t);
+    }
+
+    static size_t encode(char* out_buffer, SerialGFXProtocol in_protocol, int16_t in_value)
+    {
+      if (in_protocol != SerialGFXProtocol::compact) { writeValue<int16_t>(in_value, out_buffer); return sizeof(int16_t); }
+
+      uint16_t value = toZigZag(in_value);
+      size_t length = 0;
+      while (value >= 0x80)
+      {
+        out_buffer[length++] = static_cast<char>(value | 0x80);
+        value = value >> 7;
+      }
+
+      out_buffer[length++] = static_cast<char>(value);
+      return length;
+    }
+
+    static size_t decode(const char* in_buffer, SerialGFXProtocol in_protocol, int16_t& out_value)
+    {
+      if (in_protocol != SerialGFXProtocol::compact) { out_value = readValue<int16_t>(in_buffer); return sizeof(int16_t); }
+
+      uint16_t value = 0;
+      for (size_t index = 0; index < g_maxCompactVarUInt16Length; ++index)
+      {
+        uint8_t byte = static_cast<uint8_t>(in_buffer[index]);
+        value = value | static_cast<uint16_t>((byte & 0x7F) << (7 * index));
+        if ((byte & 0x80) == 0) { out_value = fromZigZag(value); return index + 1; }
+      }
+
+      return 0; // longer than a uint16_t
+    }
+  };
+
+  // The parameters of a command as a list of fields. The encoder of atCPU and the decoder of the GPU are both generated from it,
+  // so they can not disagree. Optional trailing parameters (swap, drawSprite) are not part of the schema.
+  template<SerialGFXCommandCode t_commandCode, typename... t_Fields>
+  class CommandSchema
+  {
+    public:
+      using Values = std::tuple<typename t_Fields::ValueType...>;
+
+      static constexpr const SerialGFXCommandCode s_commandCode = t_commandCode;
+
+      static constexpr size_t getMaxLength(SerialGFXProtocol in_protocol)
+      {
+        return (t_Fields::getMaxLength(in_protocol) + ... + 0);
+      }
+
+      // over both protocols
+      static constexpr size_t getMaxLength()
+      {
+        return getMaxLength(SerialGFXProtocol::v1) > getMaxLength(SerialGFXProtocol::compact) ? getMaxLength(SerialGFXProtocol::v1)
+                                                                                             : getMaxLength(SerialGFXProtocol::compact);
+      }
+
+      // out_buffer has to have room for getMaxLength(in_protocol) bytes, returns the encoded length
+      template<typename... t_ValueTypes>
+      static size_t encode(char* out_buffer, SerialGFXProtocol in_protocol, t_ValueTypes... in_values)
+      {
+        static_assert(sizeof...(t_ValueTypes) == sizeof...(t_Fields), "one value per field");
+
+        size_t length = 0;
+        ((length = length + t_Fields::encode(out_buffer + length, in_protocol, static_cast<typename t_Fields::ValueType>(in_values))), ...);
+        return length;
+      }
+
+      // The fields are decoded without bounds checks, then the decoded length is checked against in_length once.
+      // So getMaxLength(in_protocol) bytes behind in_parameters have to be readable, even if in_length is shorter
+      // (see g_maxSchemaParameterLength). Returns false, if the parameters are too short or malformed.
+      static bool decode(const char* in_parameters, size_t in_length, SerialGFXProtocol in_protocol, Values& out_values, size_t& out_length)
+      {
+        return decodeFields(in_parameters, in_length, in_protocol, out_values, out_length, std::index_sequence_for<t_Fields...>{});
+      }
+
+      // The offset and the length of field in_index, as long as every field has its maximum length (always in v1).
+      // Returns false, if the schema has no such field.
+      static constexpr bool getFieldLayout(size_t in_index, SerialGFXProtocol in_protocol, size_t& out_offset, size_t& out_length)
+      {
+        size_t offset = 0;
+        size_t index = 0;
+        for (size_t length : { t_Fields::getMaxLength(in_protocol)... })
+        {
+          if (index++ == in_index) { out_offset = offset; out_length = length; return true; }
+          offset = offset + length;
+        }
+
+        return false;
+      }
+
+    private:
+      template<size_t... t_indices>
+      static bool decodeFields(const char* in_parameters, size_t in_length, SerialGFXProtocol in_protocol, Values& out_values, size_t& out_length,
+                               std::index_sequence<t_indices...>)
+      {
+        bool isValid = true;
+        size_t length = 0;
+        size_t fieldLength = 0;
+        ((fieldLength = t_Fields::decode(in_parameters + length, in_protocol, std::get<t_indices>(out_values)),
+          isValid = isValid && fieldLength > 0,
+          length = length + fieldLength), ...);
+
+        out_length = length;
+        return isValid && length <= in_length;
+      }
+  };
+
+  using FillScreenSchema     = CommandSchema<SerialGFXCommandCode::fillScreen, ColorField>;
+  using FillRectSchema       = CommandSchema<SerialGFXCommandCode::fillRect, CoordinateField, CoordinateField, CoordinateField, CoordinateField, ColorField>;
+  using DrawRectSchema       = CommandSchema<SerialGFXCommandCode::drawRect, CoordinateField, CoordinateField, CoordinateField, CoordinateField, ColorField>;
+  using SetFontSchema        = CommandSchema<SerialGFXCommandCode::setFont, UInt8Field>;
+  using SetTextSizeSchema    = CommandSchema<SerialGFXCommandCode::setTextSize, UInt8Field>;
+  using SetTextColorSchema   = CommandSchema<SerialGFXCommandCode::setTextColor, ColorField>;
+  using SetCursorSchema      = CommandSchema<SerialGFXCommandCode::setCursor, CoordinateField, CoordinateField>;
+  using SetProtocolSchema    = CommandSchema<SerialGFXCommandCode::setProtocol, UInt8Field>;
+  using BlitBeginSchema      = CommandSchema<SerialGFXCommandCode::blitBegin, CoordinateField, CoordinateField, CoordinateField, CoordinateField, UInt8Field>;
+  using UploadSpriteSchema   = CommandSchema<SerialGFXCommandCode::uploadSprite, UInt8Field, CoordinateField, CoordinateField, UInt8Field>;
+  using DrawSpriteSchema     = CommandSchema<SerialGFXCommandCode::drawSprite, UInt8Field, CoordinateField, CoordinateField>; // + optional uint8_t transparent color
+  using SetBaudSchema        = CommandSchema<SerialGFXCommandCode::setBaud, UInt32Field>;
+  using SetFramingSchema     = CommandSchema<SerialGFXCommandCode::setFraming, UInt8Field>;
+  using SetFramePacingSchema = CommandSchema<SerialGFXCommandCode::setFramePacing, UInt8Field>;
+  using QueryStatsSchema     = CommandSchema<SerialGFXCommandCode::queryStats, UInt8Field, UInt8Field>; // sequence number, reset
+  using PrintAtSchema        = CommandSchema<SerialGFXCommandCode::printAt, CoordinateField, CoordinateField>; // + string, also printlnAt
+  using FillRectsSchema      = CommandSchema<SerialGFXCommandCode::fillRects, ColorField>; // + FillRectsRectSchema up to the end
+  using FillRectsRectSchema  = CommandSchema<SerialGFXCommandCode::fillRects, CoordinateField, CoordinateField, CoordinateField, CoordinateField>;
+  using DefineMacroSchema    = CommandSchema<SerialGFXCommandCode::defineMacro, UInt8Field, UInt8Field>; // id, slot count, + the slots, + the body
+  using MacroSlotSchema      = CommandSchema<SerialGFXCommandCode::defineMacro, UInt16Field, UInt8Field>; // offset in the body, length (1 or 2)
+  using CallMacroSchema      = CommandSchema<SerialGFXCommandCode::callMacro, UInt8Field>; // id, + MacroSlotValueSchema up to the end
+  using MacroSlotValueSchema = CommandSchema<SerialGFXCommandCode::callMacro, CoordinateField>;
+
+  template<typename... t_Schemas>
+  constexpr size_t getMaxSchemaParameterLength()
+  {
+    size_t maxLength = 0;
+    for (size_t length : { t_Schemas::getMaxLength()... }) { if (length > maxLength) { maxLength = length; } }
+    return maxLength;
+  }
+
+  // Every buffer, from which the GPU decodes parameters with a schema, is followed by at least this many readable bytes.
+  constexpr const size_t g_maxSchemaParameterLength =
+    getMaxSchemaParameterLength<FillScreenSchema, FillRectSchema, DrawRectSchema, SetFontSchema, SetTextSizeSchema, SetTextColorSchema,
+                                SetCursorSchema, SetProtocolSchema, BlitBeginSchema, UploadSpriteSchema, DrawSpriteSchema, SetBaudSchema, SetFramingSchema,
+                                SetFramePacingSchema, QueryStatsSchema, PrintAtSchema, FillRectsSchema, FillRectsRectSchema, DefineMacroSchema, MacroSlotSchema,
+                                CallMacroSchema, MacroSlotValueSchema>();
+}
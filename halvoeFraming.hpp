@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  // A frame (see setFraming) is g_frameSyncWord, the packet (header and parameters or response header and payload)
+  // and the CRC16 of the packet. A receiver, which has lost the packet boundaries, skips bytes until the next sync word.
+  constexpr const uint8_t g_frameSyncWord[] = { 0xA5, 0x3C };
+  constexpr const size_t g_frameSyncLength = sizeof(g_frameSyncWord);
+  constexpr const size_t g_frameChecksumLength = sizeof(uint16_t);
+  constexpr const unsigned long g_frameTimeoutMillis = 50; // a frame, that stops arriving, is treated as corrupted (its length may be)
+  constexpr const uint16_t g_crc16InitialValue = 0xFFFF;
+  constexpr const uint16_t g_crc16Polynomial = 0x1021; // CRC-16/CCITT-FALSE
+
+  struct CRC16Table
+  {
+    uint16_t values[256] = {};
+
+    constexpr CRC16Table()
+    {
+      for (uint16_t index = 0; index < 256; ++index)
+      {
+        uint16_t value = index << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit) { value = (value & 0x8000) ? (value << 1) ^ g_crc16Polynomial : value << 1; }
+        values[index] = value;
+      }
+    }
+  };
+
+  constexpr const CRC16Table g_crc16Table;
+
+  // one table lookup per byte, so a frame costs about as much as copying it
+  uint16_t updateCRC16(uint16_t in_crc, const uint8_t* in_bytes, size_t in_length)
+  {
+    for (size_t index = 0; index < in_length; ++index)
+    {
+      in_crc = static_cast<uint16_t>(in_crc << 8) ^ g_crc16Table.values[((in_crc >> 8) ^ in_bytes[index]) & 0xFF];
+    }
+
+    return in_crc;
+  }
+
+  uint16_t updateCRC16(uint16_t in_crc, const char* in_bytes, size_t in_length)
+  {
+    return updateCRC16(in_crc, reinterpret_cast<const uint8_t*>(in_bytes), in_length);
+  }
+
+  bool isFrameSyncByte(uint8_t in_byte, size_t in_position)
+  {
+    return in_position < g_frameSyncLength && in_byte == g_frameSyncWord[in_position];
+  }
+}
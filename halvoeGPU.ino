@@ -10,6 +10,16 @@
 DVIGFX8 dviGFX(DVI_RES_320x240p60, true, adafruit_feather_dvi_cfg);
 halvoeGPU::atGPU::SerialGFXInterface serialGFXInterface(Serial1, dviGFX);
 
+#if HALVOE_GPU_PIPELINE == HALVOE_GPU_PIPELINE_TIMER_IRQ
+  repeating_timer receiverTimer;
+
+  bool onReceiverTimer(repeating_timer* io_timer)
+  {
+    serialGFXInterface.pumpReceiver();
+    return true;
+  }
+#endif // HALVOE_GPU_PIPELINE
+
 void setup()
 {
   pinMode(LED_BUILTIN, OUTPUT);
@@ -29,12 +39,24 @@ void setup()
   serialGFXInterface.enablePrintFPS();
   serialGFXInterface.printVersion();
   serialGFXInterface.writeReady(true);
+
+  #if HALVOE_GPU_PIPELINE == HALVOE_GPU_PIPELINE_TIMER_IRQ
+    // negative interval: the period is measured from start to start of the callback
+    add_repeating_timer_us(-static_cast<int64_t>(halvoeGPU::atGPU::RECEIVER_PUMP_INTERVAL_MICROS), onReceiverTimer, nullptr, &receiverTimer);
+  #endif // HALVOE_GPU_PIPELINE
 }
 
 void loop()
 {
-  if (serialGFXInterface.receiveCommand())
-  {
-    serialGFXInterface.runCommand();
-  }
+  #if HALVOE_GPU_PIPELINE == HALVOE_GPU_PIPELINE_NONE
+    if (serialGFXInterface.receiveCommand())
+    {
+      serialGFXInterface.runCommand();
+    }
+  #elif HALVOE_GPU_PIPELINE == HALVOE_GPU_PIPELINE_LOOP
+    serialGFXInterface.pumpReceiver();
+    serialGFXInterface.pumpRenderer();
+  #else
+    serialGFXInterface.pumpRenderer();
+  #endif // HALVOE_GPU_PIPELINE
 }
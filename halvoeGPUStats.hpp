@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  constexpr const size_t g_frameTimeHistogramLength = 16;
+  constexpr const unsigned long g_frameTimeHistogramBucketMicros = 4000; // the last bucket holds all longer frames
+  constexpr const size_t g_statsHeaderLength = 3; // uint8_t sequence number, uint8_t section, uint8_t first index
+  constexpr const size_t g_statsCommandEntryLength = 2 * sizeof(uint32_t);
+  constexpr const size_t g_maxStatsCommandEntryCount = (g_maxResponsePayloadLength - g_statsHeaderLength) / g_statsCommandEntryLength;
+
+  // queryStats is answered with one stats response per section (the commands may take several), totals comes last.
+  enum class GPUStatsSection : uint8_t
+  {
+    commands = 0, // uint32_t count, uint32_t micros per command code, from the first index on
+    frameTimes,   // uint32_t count per bucket of the frame time histogram
+    totals        // uint32_t each, see GPUStats::totals
+  };
+
+  struct CommandStats
+  {
+    uint32_t count = 0;
+    uint32_t micros = 0; // spent executing the command, a batch includes its commands
+  };
+
+  // The counters of the GPU. Counts wrap, so monitors should look at the difference between two queries (or reset them).
+  struct GPUStats
+  {
+    std::array<CommandStats, g_commandCodeCount> commands;
+    std::array<uint32_t, g_frameTimeHistogramLength> frameTimes = {}; // time between two presented swaps
+    struct Totals
+    {
+      uint32_t receivedByteCount = 0;
+      uint32_t receiveHighWaterLength = 0; // the most bytes, which were waiting in the receive ring
+      uint32_t receiveOverrunCount = 0;
+      uint32_t droppedSwapCount = 0;       // without frame pacing, within g_minFrameTimeMicros
+      uint32_t parseErrorCount = 0;
+      uint32_t corruptedFrameCount = 0;
+      uint32_t blitErrorCount = 0;
+      uint32_t deferredPixelCount = 0;     // of the deferred rasterizer, see TileBinner
+      uint32_t writtenDeferredPixelCount = 0;
+      uint32_t culledRectCount = 0;
+    } totals;
+
+    static constexpr const size_t s_totalsCount = sizeof(Totals) / sizeof(uint32_t);
+
+    void addCommand(SerialGFXCommandCode in_commandCode, uint32_t in_micros)
+    {
+      CommandStats& stats = commands[static_cast<size_t>(in_commandCode)];
+      ++stats.count;
+      stats.micros = stats.micros + in_micros;
+    }
+
+    void addFrameTime(unsigned long in_frameTimeMicros)
+    {
+      ++frameTimes[min(in_frameTimeMicros / g_frameTimeHistogramBucketMicros, g_frameTimeHistogramLength - 1)];
+    }
+
+    // clears what the GPU counts in GPUStats itself, the totals are taken from the counters of the GPU
+    void clear()
+    {
+      commands.fill(CommandStats());
+      frameTimes.fill(0);
+    }
+
+    // Writes the stats response of in_section from io_firstIndex on into out_payload (g_maxResponsePayloadLength bytes),
+    // returns its length. io_firstIndex is moved behind the written entries, it is at the end, when the section is complete.
+    size_t writeSection(uint8_t in_sequence, GPUStatsSection in_section, size_t& io_firstIndex, uint8_t* out_payload) const
+    {
+      char* payload = reinterpret_cast<char*>(out_payload);
+      payload[0] = static_cast<char>(in_sequence);
+      payload[1] = static_cast<char>(in_section);
+      payload[2] = static_cast<char>(io_firstIndex);
+      size_t length = g_statsHeaderLength;
+
+      switch (in_section)
+      {
+        case GPUStatsSection::commands:
+          for (size_t count = 0; count < g_maxStatsCommandEntryCount && io_firstIndex < commands.size(); ++count, ++io_firstIndex)
+          {
+            writeValue<uint32_t>(commands[io_firstIndex].count, payload + length);
+            writeValue<uint32_t>(commands[io_firstIndex].micros, payload + length + sizeof(uint32_t));
+            length = length + g_statsCommandEntryLength;
+          }
+          break;
+
+        case GPUStatsSection::frameTimes:
+          for (; io_firstIndex < frameTimes.size(); ++io_firstIndex)
+          {
+            writeValue<uint32_t>(frameTimes[io_firstIndex], payload + length);
+            length = length + sizeof(uint32_t);
+          }
+          break;
+
+        case GPUStatsSection::totals:
+          memcpy(payload + length, &totals, sizeof(Totals));
+          length = length + sizeof(Totals);
+          io_firstIndex = s_totalsCount;
+          break;
+      }
+
+      return length;
+    }
+
+    // Reads a stats response into the stats, returns false, if it is malformed. Entries of a GPU with more command codes are ignored.
+    bool readSection(const uint8_t* in_payload, uint8_t in_payloadLength, uint8_t& out_sequence, GPUStatsSection& out_section)
+    {
+      if (in_payloadLength < g_statsHeaderLength) { return false; }
+      const char* payload = reinterpret_cast<const char*>(in_payload);
+      out_sequence = in_payload[0];
+      out_section = static_cast<GPUStatsSection>(in_payload[1]);
+      size_t index = in_payload[2];
+      size_t length = g_statsHeaderLength;
+
+      switch (out_section)
+      {
+        case GPUStatsSection::commands:
+          for (; length + g_statsCommandEntryLength <= in_payloadLength && index < commands.size(); length = length + g_statsCommandEntryLength, ++index)
+          {
+            commands[index].count = readValue<uint32_t>(payload + length);
+            commands[index].micros = readValue<uint32_t>(payload + length + sizeof(uint32_t));
+          }
+          return true;
+
+        case GPUStatsSection::frameTimes:
+          for (; length + sizeof(uint32_t) <= in_payloadLength && index < frameTimes.size(); length = length + sizeof(uint32_t), ++index)
+          {
+            frameTimes[index] = readValue<uint32_t>(payload + length);
+          }
+          return true;
+
+        case GPUStatsSection::totals:
+          if (in_payloadLength < g_statsHeaderLength + sizeof(Totals)) { return false; }
+          memcpy(&totals, payload + length, sizeof(Totals));
+          return true;
+      }
+
+      return false;
+    }
+  };
+}
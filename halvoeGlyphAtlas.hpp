@@ -0,0 +1,287 @@
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <array>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+#include "halvoeRaster.hpp"
+
+namespace halvoeGPU
+{
+  namespace atGPU
+  {
+    constexpr const size_t g_glyphCount = 256;
+    constexpr const size_t g_glyphAtlasLength = 4096; // row masks of all glyphs of the current font
+    constexpr const size_t g_maxMaskSpanCount = 4;    // an 8 pixel row mask has at most 4 spans
+    constexpr const uint8_t g_classicGlyphWidth = 5;
+    constexpr const uint8_t g_classicGlyphHeight = 8;
+    constexpr const uint8_t g_classicCellWidth = 6;   // the glyph and one column of spacing
+
+    struct GlyphSpan
+    {
+      uint8_t x = 0;
+      uint8_t length = 0;
+    };
+
+    // the runs of set bits in one byte of a row mask (bit 7 is the leftmost pixel)
+    struct MaskSpans
+    {
+      uint8_t count = 0;
+      std::array<GlyphSpan, g_maxMaskSpanCount> spans;
+    };
+
+    struct AtlasGlyph
+    {
+      uint16_t maskOffset = 0;
+      uint8_t width = 0;
+      uint8_t height = 0;
+      int8_t xOffset = 0;
+      int8_t yOffset = 0;
+      uint8_t xAdvance = 0;
+      bool isPresent = false;
+
+      uint8_t getBytesPerRow() const
+      {
+        return (width + 7) / 8;
+      }
+    };
+
+    // Records the pixels Adafruit_GFX::drawChar() draws as row masks, so the atlas has exactly the glyphs of Adafruit_GFX.
+    class GlyphCaptureGFX : public Adafruit_GFX
+    {
+      private:
+        uint8_t* m_masks = nullptr;
+        uint8_t m_width = 0;
+        uint8_t m_height = 0;
+
+      public:
+        GlyphCaptureGFX() : Adafruit_GFX(g_screenWidth, g_screenHeight)
+        {}
+
+        void beginGlyph(uint8_t* out_masks, uint8_t in_width, uint8_t in_height)
+        {
+          m_masks = out_masks;
+          m_width = in_width;
+          m_height = in_height;
+          memset(m_masks, 0, static_cast<size_t>(in_height) * ((in_width + 7) / 8));
+        }
+
+        void drawPixel(int16_t x, int16_t y, uint16_t) override
+        {
+          if (m_masks == nullptr || x < 0 || y < 0 || x >= m_width || y >= m_height) { return; }
+          m_masks[y * ((m_width + 7) / 8) + x / 8] |= 0x80 >> (x % 8);
+        }
+    };
+
+    // Draws text like Adafruit_GFX::print() (without rotation), but from row masks, which are prepared by setFont(),
+    // and span by span (memset) straight into the 8-bit framebuffer instead of pixel by pixel through drawPixel().
+    // The text state has to be set here as well as on the Adafruit_GFX.
+    class GlyphAtlas
+    {
+      private:
+        std::array<MaskSpans, 256> m_maskSpans;
+        std::array<AtlasGlyph, g_glyphCount> m_glyphs;
+        std::array<uint8_t, g_glyphAtlasLength> m_masks;
+        bool m_isValid = false;
+
+        const GFXfont* m_font = nullptr;
+        bool m_isCP437 = false;
+        uint8_t m_textSize = 1;
+        uint16_t m_textColor = 0xFFFF;
+        uint16_t m_textBackgroundColor = 0xFFFF; // == m_textColor: transparent background
+
+      private:
+        // Returns false if the font does not fit into m_masks, print() must not be used then.
+        bool build()
+        {
+          GlyphCaptureGFX captureGFX;
+          captureGFX.setFont(m_font);
+          captureGFX.cp437(m_isCP437);
+          size_t maskOffset = 0;
+          m_glyphs.fill(AtlasGlyph());
+
+          if (m_font == nullptr)
+          {
+            for (size_t character = 0; character < g_glyphCount; ++character)
+            {
+              AtlasGlyph& glyph = m_glyphs[character];
+              glyph = AtlasGlyph{ static_cast<uint16_t>(maskOffset), g_classicGlyphWidth, g_classicGlyphHeight, 0, 0, g_classicCellWidth, true };
+              captureGFX.beginGlyph(m_masks.data() + maskOffset, glyph.width, glyph.height);
+              captureGFX.drawChar(0, 0, character, 1, 1, 1, 1);
+              maskOffset = maskOffset + glyph.height * glyph.getBytesPerRow();
+            }
+
+            return true;
+          }
+
+          if (m_font->last >= g_glyphCount) { return false; }
+
+          for (size_t character = m_font->first; character <= m_font->last; ++character)
+          {
+            const GFXglyph& fontGlyph = m_font->glyph[character - m_font->first];
+            AtlasGlyph& glyph = m_glyphs[character];
+            glyph = AtlasGlyph{ static_cast<uint16_t>(maskOffset), fontGlyph.width, fontGlyph.height,
+                                fontGlyph.xOffset, fontGlyph.yOffset, fontGlyph.xAdvance, true };
+
+            size_t maskLength = glyph.height * glyph.getBytesPerRow();
+            if (maskOffset + maskLength > m_masks.size()) { return false; }
+            if (glyph.width == 0 || glyph.height == 0) { continue; }
+
+            captureGFX.beginGlyph(m_masks.data() + maskOffset, glyph.width, glyph.height);
+            captureGFX.drawChar(-glyph.xOffset, -glyph.yOffset, character, 1, 1, 1, 1);
+            maskOffset = maskOffset + maskLength;
+          }
+
+          return true;
+        }
+
+        // like Adafruit_GFX::drawChar(), in_x/in_y is the top-left of the classic glyph or the baseline origin of a GFX font glyph
+        void drawGlyph(const AtlasGlyph& in_glyph, uint8_t* io_framebuffer, int16_t in_x, int16_t in_y)
+        {
+          int32_t size = m_textSize;
+
+          if (m_font == nullptr && m_textBackgroundColor != m_textColor)
+          {
+            fillClippedRect(io_framebuffer, in_x, in_y, in_x + g_classicCellWidth * size, in_y + g_classicGlyphHeight * size, m_textBackgroundColor);
+          }
+
+          const uint8_t* mask = m_masks.data() + in_glyph.maskOffset;
+          uint8_t bytesPerRow = in_glyph.getBytesPerRow();
+          int32_t left = in_x + in_glyph.xOffset * size;
+          int32_t top = in_y + in_glyph.yOffset * size;
+
+          // the usual case: the glyph is completely on the screen, so its spans are not clipped
+          if (left >= 0 && top >= 0 && left + bytesPerRow * 8 * size <= g_screenWidth && top + in_glyph.height * size <= g_screenHeight)
+          {
+            uint8_t color = m_textColor;
+            uint8_t* target = io_framebuffer + static_cast<size_t>(top) * g_screenWidth + left;
+            for (int32_t row = 0; row < in_glyph.height; ++row)
+            {
+              for (int32_t byteIndex = 0; byteIndex < bytesPerRow; ++byteIndex)
+              {
+                const MaskSpans& maskSpans = m_maskSpans[*mask++];
+                for (size_t spanIndex = 0; spanIndex < maskSpans.count; ++spanIndex)
+                {
+                  const GlyphSpan& span = maskSpans.spans[spanIndex];
+                  uint8_t* spanTarget = target + (byteIndex * 8 + span.x) * size;
+                  for (int32_t y = 0; y < size; ++y) { memset(spanTarget + y * g_screenWidth, color, span.length * size); }
+                }
+              }
+
+              target = target + size * g_screenWidth;
+            }
+
+            return;
+          }
+
+          for (int32_t row = 0; row < in_glyph.height; ++row)
+          {
+            int32_t y = in_y + (in_glyph.yOffset + row) * size;
+            if (y >= g_screenHeight || y + size <= 0) { mask = mask + bytesPerRow; continue; }
+
+            for (int32_t byteIndex = 0; byteIndex < bytesPerRow; ++byteIndex)
+            {
+              const MaskSpans& maskSpans = m_maskSpans[*mask++];
+              for (size_t spanIndex = 0; spanIndex < maskSpans.count; ++spanIndex)
+              {
+                const GlyphSpan& span = maskSpans.spans[spanIndex];
+                int32_t x = in_x + (in_glyph.xOffset + byteIndex * 8 + span.x) * size;
+                fillClippedRect(io_framebuffer, x, y, x + span.length * size, y + size, m_textColor);
+              }
+            }
+          }
+        }
+
+        // Adafruit_GFX::write() with text wrap enabled
+        void write(uint8_t in_character, int16_t& io_cursorX, int16_t& io_cursorY, uint8_t* io_framebuffer)
+        {
+          int16_t lineHeight = m_font == nullptr ? g_classicGlyphHeight : m_font->yAdvance;
+          if (in_character == '\n') { io_cursorX = 0; io_cursorY = io_cursorY + m_textSize * lineHeight; return; }
+          if (in_character == '\r') { return; }
+
+          const AtlasGlyph& glyph = m_glyphs[in_character];
+          if (not glyph.isPresent) { return; }
+
+          if (m_font == nullptr || (glyph.width > 0 && glyph.height > 0))
+          {
+            int16_t right = m_font == nullptr ? m_textSize * g_classicCellWidth : m_textSize * (glyph.xOffset + glyph.width);
+            if (io_cursorX + right > g_screenWidth) { io_cursorX = 0; io_cursorY = io_cursorY + m_textSize * lineHeight; }
+            drawGlyph(glyph, io_framebuffer, io_cursorX, io_cursorY);
+          }
+
+          io_cursorX = io_cursorX + glyph.xAdvance * m_textSize;
+        }
+
+      public:
+        GlyphAtlas()
+        {
+          for (size_t mask = 0; mask < m_maskSpans.size(); ++mask)
+          {
+            MaskSpans& maskSpans = m_maskSpans[mask];
+            for (uint8_t x = 0; x < 8; ++x)
+            {
+              if ((mask & (0x80 >> x)) == 0) { continue; }
+              if (x > 0 && (mask & (0x80 >> (x - 1))) != 0) { ++maskSpans.spans[maskSpans.count - 1].length; continue; }
+              maskSpans.spans[maskSpans.count++] = GlyphSpan{ x, 1 };
+            }
+          }
+
+          m_isValid = build();
+        }
+
+        bool isValid() const
+        {
+          return m_isValid;
+        }
+
+        void setFont(const GFXfont* in_font)
+        {
+          if (in_font == m_font) { return; }
+          m_font = in_font;
+          m_isValid = build();
+        }
+
+        void cp437(bool in_isEnabled)
+        {
+          if (in_isEnabled == m_isCP437) { return; }
+          m_isCP437 = in_isEnabled;
+          m_isValid = build();
+        }
+
+        void setTextSize(uint8_t in_size)
+        {
+          m_textSize = in_size > 0 ? in_size : 1;
+        }
+
+        void setTextColor(uint16_t in_color)
+        {
+          m_textColor = in_color;
+          m_textBackgroundColor = in_color;
+        }
+
+        void setTextColor(uint16_t in_color, uint16_t in_backgroundColor)
+        {
+          m_textColor = in_color;
+          m_textBackgroundColor = in_backgroundColor;
+        }
+
+        uint16_t getTextColor() const
+        {
+          return m_textColor;
+        }
+
+        uint16_t getTextBackgroundColor() const
+        {
+          return m_textBackgroundColor;
+        }
+
+        // Draws in_string at io_cursor into io_framebuffer (g_screenWidth x g_screenHeight) and moves io_cursor behind it.
+        void print(const char* in_string, int16_t& io_cursorX, int16_t& io_cursorY, uint8_t* io_framebuffer)
+        {
+          if (in_string == nullptr || io_framebuffer == nullptr) { return; }
+          while (*in_string != '\0') { write(static_cast<uint8_t>(*in_string++), io_cursorX, io_cursorY, io_framebuffer); }
+        }
+    };
+  }
+}
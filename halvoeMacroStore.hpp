@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+#ifndef HALVOE_GPU_MACRO_ARENA_LENGTH
+  #define HALVOE_GPU_MACRO_ARENA_LENGTH 4096
+#endif // HALVOE_GPU_MACRO_ARENA_LENGTH
+
+namespace halvoeGPU
+{
+  namespace atGPU
+  {
+    constexpr const size_t g_macroArenaLength = HALVOE_GPU_MACRO_ARENA_LENGTH;
+
+    // A value of callMacro is written into the body at offset (int16_t or its low byte), before the body is run.
+    // A slot of length 0 is not bound, its value is ignored.
+    struct MacroSlot
+    {
+      uint16_t offset = 0;
+      uint8_t length = 0;
+    };
+
+    struct MacroEntry
+    {
+      uint16_t offset = 0; // in the arena
+      uint16_t length = 0;
+      std::array<MacroSlot, g_maxMacroSlotCount> slots;
+      uint8_t slotCount = 0;
+      bool isDefined = false;
+    };
+
+    // The bodies of the macros (batched commands in v1) one after the other in a static arena.
+    // A macro, which is defined again or removed, leaves no gap, the bodies behind it are moved to the front.
+    class MacroStore
+    {
+      static_assert(g_macroArenaLength <= UINT16_MAX, "the offsets in the arena are uint16_t");
+
+      private:
+        std::array<char, g_macroArenaLength> m_arena;
+        size_t m_usedLength = 0;
+        std::array<MacroEntry, g_maxMacroCount> m_entries;
+
+      public:
+        void remove(uint8_t in_id)
+        {
+          if (in_id >= m_entries.size() || not m_entries[in_id].isDefined) { return; }
+
+          MacroEntry& entry = m_entries[in_id];
+          size_t end = entry.offset + entry.length;
+          memmove(m_arena.data() + entry.offset, m_arena.data() + end, m_usedLength - end);
+          m_usedLength = m_usedLength - entry.length;
+
+          for (MacroEntry& other : m_entries)
+          {
+            if (other.isDefined && other.offset > entry.offset) { other.offset = other.offset - entry.length; }
+          }
+
+          entry = MacroEntry();
+        }
+
+        // Replaces the macro in_id, an empty body only removes it. Returns false, if the slots are outside of the body
+        // or the body does not fit into the arena (the previous macro in_id is removed then as well).
+        bool define(uint8_t in_id, const MacroSlot* in_slots, size_t in_slotCount, const char* in_body, size_t in_bodyLength)
+        {
+          if (in_id >= m_entries.size() || in_slotCount > g_maxMacroSlotCount || in_bodyLength > g_maxMacroBodyLength) { return false; }
+
+          for (size_t index = 0; index < in_slotCount; ++index)
+          {
+            const MacroSlot& slot = in_slots[index];
+            if (slot.length > sizeof(int16_t) || slot.offset + slot.length > in_bodyLength) { return false; }
+          }
+
+          remove(in_id);
+          if (in_bodyLength == 0) { return true; }
+          if (m_usedLength + in_bodyLength > m_arena.size()) { return false; }
+
+          MacroEntry& entry = m_entries[in_id];
+          entry.offset = m_usedLength;
+          entry.length = in_bodyLength;
+          entry.slotCount = in_slotCount;
+          for (size_t index = 0; index < in_slotCount; ++index) { entry.slots[index] = in_slots[index]; }
+          entry.isDefined = true;
+
+          memcpy(m_arena.data() + m_usedLength, in_body, in_bodyLength);
+          m_usedLength = m_usedLength + in_bodyLength;
+          return true;
+        }
+
+        // Copies the body of the macro in_id into out_body (g_maxMacroBodyLength bytes) and writes in_values into its slots.
+        // Slots without a value keep the value, with which the macro was recorded. Returns false, if in_id is not defined.
+        bool expand(uint8_t in_id, const int16_t* in_values, size_t in_valueCount, char* out_body, size_t& out_length) const
+        {
+          if (in_id >= m_entries.size() || not m_entries[in_id].isDefined) { return false; }
+
+          const MacroEntry& entry = m_entries[in_id];
+          memcpy(out_body, m_arena.data() + entry.offset, entry.length);
+
+          for (size_t index = 0; index < min(in_valueCount, static_cast<size_t>(entry.slotCount)); ++index)
+          {
+            const MacroSlot& slot = entry.slots[index];
+            if (slot.length == sizeof(uint8_t)) { out_body[slot.offset] = static_cast<char>(in_values[index]); }
+            else if (slot.length == sizeof(int16_t)) { writeValue<int16_t>(in_values[index], out_body + slot.offset); }
+          }
+
+          out_length = entry.length;
+          return true;
+        }
+
+        bool isDefined(uint8_t in_id) const
+        {
+          return in_id < m_entries.size() && m_entries[in_id].isDefined;
+        }
+
+        size_t getUsedLength() const
+        {
+          return m_usedLength;
+        }
+
+        static constexpr size_t getLength()
+        {
+          return g_macroArenaLength;
+        }
+    };
+  }
+}
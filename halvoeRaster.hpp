@@ -0,0 +1,184 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "halvoeRect.hpp"
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  namespace atGPU
+  {
+    // Span fill kernels for the g_screenWidth x g_screenHeight 8-bit framebuffer.
+    // Rects and lines are clipped once, then every row is filled with aligned 32-bit stores.
+    // Rows of the full screen width are one contiguous block, those are left to memset(), which is faster for large blocks.
+    // fillRect(), drawHLine(), drawVLine() and drawRect() change the same pixels as their Adafruit_GFX (GFXcanvas8) versions.
+
+    constexpr const size_t g_rasterWordLength = sizeof(uint32_t);
+    constexpr const size_t g_rasterUnrollCount = 4;
+    constexpr const size_t g_rectEdgeCount = 4;
+
+    struct RasterLine
+    {
+      int16_t x = 0;
+      int16_t y = 0;
+      int16_t length = 0; // a negative length ends the line at x/y, like in GFXcanvas8::drawFastHLine()/drawFastVLine()
+      bool isVertical = false;
+    };
+
+    uint32_t getColorWord(uint8_t in_color)
+    {
+      return in_color * 0x01010101u;
+    }
+
+    // bytes up to the first word boundary, then g_rasterUnrollCount words per iteration, then the remaining words and bytes
+    void fillSpan(uint8_t* io_target, size_t in_length, uint32_t in_colorWord)
+    {
+      uint8_t color = static_cast<uint8_t>(in_colorWord);
+      for (; in_length > 0 && (reinterpret_cast<uintptr_t>(io_target) & (g_rasterWordLength - 1)) != 0; --in_length) { *io_target++ = color; }
+
+      uint32_t* word = reinterpret_cast<uint32_t*>(io_target);
+      for (; in_length >= g_rasterUnrollCount * g_rasterWordLength; in_length = in_length - g_rasterUnrollCount * g_rasterWordLength)
+      {
+        word[0] = in_colorWord;
+        word[1] = in_colorWord;
+        word[2] = in_colorWord;
+        word[3] = in_colorWord;
+        word = word + g_rasterUnrollCount;
+      }
+
+      for (; in_length >= g_rasterWordLength; in_length = in_length - g_rasterWordLength) { *word++ = in_colorWord; }
+
+      io_target = reinterpret_cast<uint8_t*>(word);
+      for (; in_length > 0; --in_length) { *io_target++ = color; }
+    }
+
+    // Clips [in_left, in_right) x [in_top, in_bottom) to the screen, returns false, if nothing of it is on the screen.
+    bool clipToScreen(int32_t in_left, int32_t in_top, int32_t in_right, int32_t in_bottom, Rect& out_area)
+    {
+      int32_t left = max(in_left, static_cast<int32_t>(0));
+      int32_t top = max(in_top, static_cast<int32_t>(0));
+      int32_t right = min(in_right, static_cast<int32_t>(g_screenWidth));
+      int32_t bottom = min(in_bottom, static_cast<int32_t>(g_screenHeight));
+      if (left >= right || top >= bottom) { return false; }
+
+      out_area = Rect{ static_cast<int16_t>(left), static_cast<int16_t>(top), static_cast<int16_t>(right - left), static_cast<int16_t>(bottom - top) };
+      return true;
+    }
+
+    // Fills in_area (not empty) of a buffer with rows of in_stride pixels, the framebuffer or a tile (see TileBinner).
+    void fillArea(uint8_t* io_pixels, size_t in_stride, const Rect& in_area, uint8_t in_color)
+    {
+      uint8_t* row = io_pixels + static_cast<size_t>(in_area.y) * in_stride + in_area.x;
+      size_t width = in_area.width;
+      int32_t height = in_area.height;
+
+      if (width == in_stride) { memset(row, in_color, width * height); return; }
+
+      if (width == 1)
+      {
+        for (; height >= static_cast<int32_t>(g_rasterUnrollCount); height = height - g_rasterUnrollCount)
+        {
+          row[0] = in_color;
+          row[in_stride] = in_color;
+          row[2 * in_stride] = in_color;
+          row[3 * in_stride] = in_color;
+          row = row + g_rasterUnrollCount * in_stride;
+        }
+
+        for (; height > 0; --height) { *row = in_color; row = row + in_stride; }
+        return;
+      }
+
+      uint32_t colorWord = getColorWord(in_color);
+      for (; height > 0; --height)
+      {
+        fillSpan(row, width, colorWord);
+        row = row + in_stride;
+      }
+    }
+
+    // Clips [in_left, in_right) x [in_top, in_bottom) to the screen and fills it.
+    void fillClippedRect(uint8_t* io_framebuffer, int32_t in_left, int32_t in_top, int32_t in_right, int32_t in_bottom, uint8_t in_color)
+    {
+      Rect area;
+      if (io_framebuffer == nullptr || not clipToScreen(in_left, in_top, in_right, in_bottom, area)) { return; }
+      fillArea(io_framebuffer, g_screenWidth, area, in_color);
+    }
+
+    void fillScreen(uint8_t* io_framebuffer, uint8_t in_color)
+    {
+      if (io_framebuffer == nullptr) { return; }
+      memset(io_framebuffer, in_color, g_screenWidth * g_screenHeight);
+    }
+
+    // The part of the screen, which fillRect() fills. Returns false, if that is nothing.
+    // Like Adafruit_GFX::fillRect(): nothing is drawn for a width <= 0 or a height of 0, a negative height ends the rect at in_y.
+    bool getFillRectArea(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, Rect& out_area)
+    {
+      if (in_width <= 0 || in_height == 0) { return false; }
+      int32_t top = in_height > 0 ? in_y : static_cast<int32_t>(in_y) + in_height + 1;
+      return clipToScreen(in_x, top, static_cast<int32_t>(in_x) + in_width, top + abs(in_height), out_area);
+    }
+
+    void fillRect(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint8_t in_color)
+    {
+      Rect area;
+      if (io_framebuffer == nullptr || not getFillRectArea(in_x, in_y, in_width, in_height, area)) { return; }
+      fillArea(io_framebuffer, g_screenWidth, area, in_color);
+    }
+
+    // the part of the screen, which drawLine() fills
+    bool getLineArea(const RasterLine& in_line, Rect& out_area)
+    {
+      if (in_line.length == 0) { return false; }
+
+      int32_t position = in_line.isVertical ? in_line.y : in_line.x;
+      int32_t begin = in_line.length > 0 ? position : position + in_line.length + 1;
+      int32_t end = begin + abs(in_line.length);
+
+      if (in_line.isVertical) { return clipToScreen(in_line.x, begin, static_cast<int32_t>(in_line.x) + 1, end, out_area); }
+      return clipToScreen(begin, in_line.y, end, static_cast<int32_t>(in_line.y) + 1, out_area);
+    }
+
+    void drawLine(uint8_t* io_framebuffer, const RasterLine& in_line, uint8_t in_color)
+    {
+      Rect area;
+      if (io_framebuffer == nullptr || not getLineArea(in_line, area)) { return; }
+      fillArea(io_framebuffer, g_screenWidth, area, in_color);
+    }
+
+    void drawLines(uint8_t* io_framebuffer, const RasterLine* in_lines, size_t in_count, uint8_t in_color)
+    {
+      for (size_t index = 0; index < in_count; ++index) { drawLine(io_framebuffer, in_lines[index], in_color); }
+    }
+
+    void drawHLine(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_width, uint8_t in_color)
+    {
+      drawLine(io_framebuffer, RasterLine{ in_x, in_y, in_width, false }, in_color);
+    }
+
+    void drawVLine(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_height, uint8_t in_color)
+    {
+      drawLine(io_framebuffer, RasterLine{ in_x, in_y, in_height, true }, in_color);
+    }
+
+    // Like Adafruit_GFX::drawRect(): the four edges as lines, so rects with a negative or zero size are drawn the same way.
+    void getRectEdges(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, RasterLine (&out_edges)[g_rectEdgeCount])
+    {
+      out_edges[0] = RasterLine{ in_x, in_y, in_width, false };
+      out_edges[1] = RasterLine{ in_x, static_cast<int16_t>(in_y + in_height - 1), in_width, false };
+      out_edges[2] = RasterLine{ in_x, in_y, in_height, true };
+      out_edges[3] = RasterLine{ static_cast<int16_t>(in_x + in_width - 1), in_y, in_height, true };
+    }
+
+    void drawRect(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint8_t in_color)
+    {
+      RasterLine edges[g_rectEdgeCount];
+      getRectEdges(in_x, in_y, in_width, in_height, edges);
+      drawLines(io_framebuffer, edges, g_rectEdgeCount, in_color);
+    }
+  }
+}
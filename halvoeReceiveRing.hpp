@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+#ifdef ARDUINO_ARCH_RP2040
+  #include <hardware/dma.h>
+  #include <hardware/uart.h>
+#endif // ARDUINO_ARCH_RP2040
+
+namespace halvoeGPU
+{
+  // Receive ring, into which a DMA channel writes the bytes of the UART, so nobody has to poll available() and copy them out.
+  // The consumer decodes the bytes in place (peek(), getContiguous()) and releases them with consume(), when it is done with them.
+  // The DMA does not know about the consumer: if it gets t_length bytes ahead, it overwrites unread bytes (see update()).
+  // Bytes, which straddle the end of the ring, are copied to the spill area behind it by getContiguous(), so they are contiguous too.
+  // On the host the HostSerial stands in for the DMA channel, it writes the arrived bytes into the ring, when it is updated.
+  // t_paddingLength bytes behind the spill area are never written, but may be read behind the end of contiguous bytes.
+  // The buffer is allocated by begin(), the alignment, which the DMA needs, would otherwise pad the class (and the one it is in)
+  // to a multiple of t_length.
+  template<size_t t_length, size_t t_spillLength, size_t t_paddingLength = 0>
+  class ReceiveRing
+  {
+    static_assert(t_length >= 2 && (t_length & (t_length - 1)) == 0, "t_length must be a power of two");
+    static_assert(t_spillLength <= t_length, "t_spillLength must not exceed t_length");
+    #ifdef ARDUINO_ARCH_RP2040
+      static_assert(t_length <= 32768, "the DMA ring wrap of the RP2040 has at most 15 bits");
+    #endif // ARDUINO_ARCH_RP2040
+
+    private:
+      static constexpr const size_t s_bufferLength = t_length + t_spillLength + t_paddingLength;
+
+      uint8_t* m_buffer = nullptr; // aligned to t_length, the DMA ring wrap of the RP2040 needs that
+      uint32_t m_writtenCount = 0; // by the DMA, as of the last update()
+      uint32_t m_readCount = 0;
+      unsigned long m_overrunCount = 0;
+
+      #ifdef ARDUINO_ARCH_RP2040
+        // the transfer count of the channel only counts down, it is rearmed long before it runs out
+        static constexpr const uint32_t s_dmaTransferCount = UINT32_MAX;
+        static constexpr const uint32_t s_dmaRearmTransferCount = UINT32_MAX / 2;
+
+        int m_dmaChannel = -1;
+        uint32_t m_armedWrittenCount = 0; // m_writtenCount, when the channel was (re)armed
+
+        static uart_inst_t* getUART(SerialUART& in_serial)
+        {
+          return &in_serial == &Serial2 ? uart1 : uart0;
+        }
+
+        static constexpr uint getRingSizeBits()
+        {
+          uint sizeBits = 0;
+          while ((static_cast<size_t>(1) << sizeBits) < t_length) { ++sizeBits; }
+          return sizeBits;
+        }
+
+        uint32_t fetchWrittenCount()
+        {
+          uint32_t writtenCount = m_armedWrittenCount + (s_dmaTransferCount - dma_channel_hw_addr(m_dmaChannel)->transfer_count);
+
+          if (dma_channel_hw_addr(m_dmaChannel)->transfer_count < s_dmaRearmTransferCount)
+          {
+            // the write address stays where it is, so the ring continues seamlessly
+            dma_channel_abort(m_dmaChannel);
+            writtenCount = m_armedWrittenCount + (s_dmaTransferCount - dma_channel_hw_addr(m_dmaChannel)->transfer_count);
+            m_armedWrittenCount = writtenCount;
+            dma_channel_set_trans_count(m_dmaChannel, s_dmaTransferCount, true);
+          }
+
+          return writtenCount;
+        }
+      #elif defined(HALVOE_GPU_HOST)
+        HALVOE_SERIAL_TYPE* m_serial = nullptr;
+
+        uint32_t fetchWrittenCount()
+        {
+          return m_serial->getReceiveRingWrittenCount(m_readCount);
+        }
+      #endif // ARDUINO_ARCH_RP2040
+
+    public:
+      ~ReceiveRing()
+      {
+        free(m_buffer);
+      }
+
+      // Allocates the buffer, call this before the heap is handed out to the sprite arena. Returns false, if there is no memory left.
+      bool begin()
+      {
+        if (m_buffer != nullptr) { return true; }
+        m_buffer = static_cast<uint8_t*>(memalign(t_length, s_bufferLength)); // s_bufferLength is no multiple of t_length, as aligned_alloc() needs
+        if (m_buffer == nullptr) { return false; }
+        memset(m_buffer, 0, s_bufferLength);
+        return true;
+      }
+
+      // Has to be called after begin() and after every io_serial.begin(), because that hands the received bytes back to the serial.
+      // Returns false, if there is no buffer or no DMA channel left.
+      bool attach(HALVOE_SERIAL_TYPE& io_serial)
+      {
+        if (m_buffer == nullptr) { return false; }
+
+        #ifdef ARDUINO_ARCH_RP2040
+          uart_inst_t* uart = getUART(io_serial);
+          uart_set_irq_enables(uart, false, false); // the receive IRQ of SerialUART would take the bytes away from the DMA
+          hw_set_bits(&uart_get_hw(uart)->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+          if (m_dmaChannel >= 0) { return true; } // the channel keeps running through the begin()
+
+          m_dmaChannel = dma_claim_unused_channel(false);
+          if (m_dmaChannel < 0) { return false; }
+
+          dma_channel_config config = dma_channel_get_default_config(m_dmaChannel);
+          channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+          channel_config_set_read_increment(&config, false);
+          channel_config_set_write_increment(&config, true);
+          channel_config_set_ring(&config, true, getRingSizeBits());
+          channel_config_set_dreq(&config, uart_get_dreq(uart, false));
+          dma_channel_configure(m_dmaChannel, &config, m_buffer, &uart_get_hw(uart)->dr, s_dmaTransferCount, true);
+          return true;
+        #elif defined(HALVOE_GPU_HOST)
+          m_serial = &io_serial;
+          m_serial->attachReceiveRing(m_buffer, t_length);
+          return true;
+        #endif // ARDUINO_ARCH_RP2040
+      }
+
+      // Takes over the bytes, which the DMA has written since the last update().
+      // Returns how many unread bytes are dropped, because the DMA has overwritten them.
+      size_t update()
+      {
+        m_writtenCount = fetchWrittenCount();
+        if (m_writtenCount - m_readCount <= t_length) { return 0; }
+
+        size_t droppedLength = m_writtenCount - m_readCount;
+        m_readCount = m_writtenCount;
+        ++m_overrunCount;
+        return droppedLength;
+      }
+
+      // drops all bytes, which are received until now
+      void clear()
+      {
+        m_writtenCount = fetchWrittenCount();
+        m_readCount = m_writtenCount;
+      }
+
+      uint32_t getWrittenCount() const
+      {
+        return m_writtenCount;
+      }
+
+      size_t getAvailableLength() const
+      {
+        return m_writtenCount - m_readCount;
+      }
+
+      uint8_t peek(size_t in_offset) const
+      {
+        return m_buffer[(m_readCount + in_offset) & (t_length - 1)];
+      }
+
+      // Returns in_length bytes from in_offset on, they have to be available. Only the last returned bytes stay valid,
+      // if they straddle the end of the ring. Returns nullptr, if in_length exceeds t_spillLength.
+      const char* getContiguous(size_t in_offset, size_t in_length)
+      {
+        if (in_length > t_spillLength) { return nullptr; }
+
+        size_t beginIndex = (m_readCount + in_offset) & (t_length - 1);
+        if (beginIndex + in_length > t_length) { memcpy(m_buffer + t_length, m_buffer, beginIndex + in_length - t_length); }
+        return reinterpret_cast<const char*>(m_buffer + beginIndex);
+      }
+
+      // The bytes from the written count in_count on, up to the end of m_buffer and at most io_length of them (which is set to
+      // their length), the next ones are at its begin. Bytes, which the DMA has overwritten since in_count, are not told apart.
+      const uint8_t* getWrittenBytes(uint32_t in_count, size_t& io_length) const
+      {
+        size_t beginIndex = in_count & (t_length - 1);
+        io_length = min(io_length, t_length - beginIndex);
+        return m_buffer + beginIndex;
+      }
+
+      void consume(size_t in_length)
+      {
+        m_readCount = m_readCount + min(in_length, getAvailableLength());
+      }
+
+      unsigned long getOverrunCount() const
+      {
+        return m_overrunCount;
+      }
+
+      static constexpr size_t getLength()
+      {
+        return t_length;
+      }
+
+      // of the allocated buffer: the ring, the spill area and the padding
+      static constexpr size_t getBufferLength()
+      {
+        return s_bufferLength;
+      }
+
+      // The heap in front of the buffer, which its alignment may leave unused at most. memalign() returns it to the heap,
+      // but only allocations, which are small enough, fit into it.
+      static constexpr size_t getMaxAlignmentLength()
+      {
+        return t_length - 1;
+      }
+  };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace halvoeGPU
+{
+  // Axis aligned rectangle in screen coordinates. A rect with width <= 0 or height <= 0 is empty.
+  struct Rect
+  {
+    int16_t x = 0;
+    int16_t y = 0;
+    int16_t width = 0;
+    int16_t height = 0;
+
+    int32_t getRight() const { return static_cast<int32_t>(x) + width; }
+    int32_t getBottom() const { return static_cast<int32_t>(y) + height; }
+    int32_t getArea() const { return isEmpty() ? 0 : static_cast<int32_t>(width) * height; }
+
+    bool isEmpty() const
+    {
+      return width <= 0 || height <= 0;
+    }
+
+    bool intersects(const Rect& in_other) const
+    {
+      if (isEmpty() || in_other.isEmpty()) { return false; }
+      return x < in_other.getRight() && in_other.x < getRight() && y < in_other.getBottom() && in_other.y < getBottom();
+    }
+
+    bool contains(const Rect& in_other) const
+    {
+      if (in_other.isEmpty()) { return true; }
+      if (isEmpty()) { return false; }
+      return x <= in_other.x && y <= in_other.y && in_other.getRight() <= getRight() && in_other.getBottom() <= getBottom();
+    }
+
+    bool operator==(const Rect& in_other) const
+    {
+      return x == in_other.x && y == in_other.y && width == in_other.width && height == in_other.height;
+    }
+
+    bool operator!=(const Rect& in_other) const
+    {
+      return not (*this == in_other);
+    }
+  };
+
+  Rect getIntersection(const Rect& in_a, const Rect& in_b)
+  {
+    if (not in_a.intersects(in_b)) { return Rect(); }
+
+    int32_t left = max(in_a.x, in_b.x);
+    int32_t top = max(in_a.y, in_b.y);
+    int32_t right = min(in_a.getRight(), in_b.getRight());
+    int32_t bottom = min(in_a.getBottom(), in_b.getBottom());
+    return Rect{ static_cast<int16_t>(left), static_cast<int16_t>(top), static_cast<int16_t>(right - left), static_cast<int16_t>(bottom - top) };
+  }
+
+  Rect getUnion(const Rect& in_a, const Rect& in_b)
+  {
+    if (in_a.isEmpty()) { return in_b; }
+    if (in_b.isEmpty()) { return in_a; }
+
+    int32_t left = min(in_a.x, in_b.x);
+    int32_t top = min(in_a.y, in_b.y);
+    int32_t right = max(in_a.getRight(), in_b.getRight());
+    int32_t bottom = max(in_a.getBottom(), in_b.getBottom());
+    return Rect{ static_cast<int16_t>(left), static_cast<int16_t>(top), static_cast<int16_t>(right - left), static_cast<int16_t>(bottom - top) };
+  }
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <array>
+
+#include "halvoeCString.hpp"
+#include "halvoeRect.hpp"
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  namespace atCPU
+  {
+    constexpr const size_t g_maxRetainedCommandCount = 256;
+    constexpr const size_t g_retainedStringBufferLength = 4096;
+    constexpr const size_t g_maxDirtyRectCount = 16;
+    constexpr const size_t g_retainedMatchWindow = 8; // how far ahead the previous frame is searched for a command of the current frame
+    constexpr const size_t g_maxClippedRectCount = 4;
+
+    struct TextState
+    {
+      SerialGFXFont font = SerialGFXFont::Default;
+      uint8_t size = 1;
+      uint16_t color = 0xFFFF;
+
+      bool operator==(const TextState& in_other) const
+      {
+        return font == in_other.font && size == in_other.size && color == in_other.color;
+      }
+    };
+
+    // A drawing command as recorded in retained mode (fillScreen, fillRect, drawRect, print, println, drawSprite or a blit as blitBegin).
+    struct RetainedCommand
+    {
+      SerialGFXCommandCode commandCode = SerialGFXCommandCode::noCommand;
+      Rect rect;          // fillRect/drawRect/blit: the parameters as given, print/println: the cursor (width and height are 0),
+                          // drawSprite: the position and the size of the sprite
+      uint16_t color = 0; // fillScreen/fillRect/drawRect, drawSprite: the transparent color
+      TextState textState;
+      int16_t endCursorX = 0; // print/println: the cursor after the string is printed
+      int16_t endCursorY = 0;
+      uint16_t stringOffset = 0;
+      uint16_t stringLength = 0;
+      const uint8_t* pixels = nullptr; // blit: not copied, the caller keeps them until the frame is sent
+      uint32_t pixelHash = 0;          // blit: hash of the pixels, drawSprite: how often the sprite was uploaded
+      uint8_t spriteID = 0;
+      bool isTransparent = false;
+      SerialGFXBlitCodec blitCodec = SerialGFXBlitCodec::raw;
+      bool isBestBlitCodec = false;
+      Rect bounds;        // the (clipped to the screen) pixels, which the command may change
+      bool isMatched = false;
+
+      bool isText() const
+      {
+        return commandCode == SerialGFXCommandCode::print || commandCode == SerialGFXCommandCode::println;
+      }
+
+      // Clippable commands are redrawn only inside the dirty region, all others are redrawn completely.
+      // Rects with a negative or zero size are not clipped, because Adafruit_GFX draws them in its own ways.
+      bool isClippable() const
+      {
+        if (commandCode == SerialGFXCommandCode::fillScreen) { return true; }
+        if (commandCode == SerialGFXCommandCode::fillRect || commandCode == SerialGFXCommandCode::drawRect) { return not rect.isEmpty(); }
+        return false;
+      }
+
+      // The parts of a clippable command inside in_dirtyRect, each one is sent as a fillRect.
+      // A drawRect is split into its (up to four) outline lines.
+      size_t getClippedRects(const Rect& in_dirtyRect, std::array<Rect, g_maxClippedRectCount>& out_rects) const
+      {
+        if (commandCode != SerialGFXCommandCode::drawRect)
+        {
+          out_rects[0] = getIntersection(bounds, in_dirtyRect);
+          return out_rects[0].isEmpty() ? 0 : 1;
+        }
+
+        int16_t right = rect.x + rect.width - 1;
+        int16_t bottom = rect.y + rect.height - 1;
+        const Rect lines[] = { Rect{ rect.x, rect.y, rect.width, 1 }, Rect{ rect.x, bottom, rect.width, 1 },
+                               Rect{ rect.x, rect.y, 1, rect.height }, Rect{ right, rect.y, 1, rect.height } };
+
+        size_t rectCount = 0;
+        for (const Rect& line : lines)
+        {
+          Rect clippedLine = getIntersection(line, in_dirtyRect);
+          if (not clippedLine.isEmpty()) { out_rects[rectCount++] = clippedLine; }
+        }
+
+        return rectCount;
+      }
+    };
+
+    // FNV-1a, blits are compared by the hash of their pixels, so an unchanged image is not sent again.
+    uint32_t getPixelHash(const uint8_t* in_pixels, size_t in_count)
+    {
+      uint32_t hash = 2166136261u;
+      for (size_t index = 0; index < in_count; ++index) { hash = (hash ^ in_pixels[index]) * 16777619u; }
+      return hash;
+    }
+
+    Rect getScreenRect()
+    {
+      return Rect{ 0, 0, g_screenWidth, g_screenHeight };
+    }
+
+    // The pixels fillRect()/drawRect() may change, clipped to the screen.
+    // Adafruit_GFX draws the edges of rects with a negative or zero size from x + width - 1 to x,
+    // for all other rects this is just the rect itself.
+    Rect getRectCommandBounds(int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height)
+    {
+      int32_t lastX = static_cast<int32_t>(in_x) + in_width - 1;
+      int32_t lastY = static_cast<int32_t>(in_y) + in_height - 1;
+      int32_t left = max(min(static_cast<int32_t>(in_x), lastX), static_cast<int32_t>(0));
+      int32_t top = max(min(static_cast<int32_t>(in_y), lastY), static_cast<int32_t>(0));
+      int32_t right = min(max(static_cast<int32_t>(in_x), lastX) + 1, static_cast<int32_t>(g_screenWidth));
+      int32_t bottom = min(max(static_cast<int32_t>(in_y), lastY) + 1, static_cast<int32_t>(g_screenHeight));
+      if (right <= left || bottom <= top) { return Rect(); }
+      return Rect{ static_cast<int16_t>(left), static_cast<int16_t>(top), static_cast<int16_t>(right - left), static_cast<int16_t>(bottom - top) };
+    }
+
+    // The command list of one frame, strings are stored in the frame as well.
+    class RetainedFrame
+    {
+      private:
+        std::array<RetainedCommand, g_maxRetainedCommandCount> m_commands;
+        size_t m_commandCount = 0;
+        std::array<char, g_retainedStringBufferLength> m_stringBuffer;
+        size_t m_stringBufferLength = 0;
+
+      public:
+        void clear()
+        {
+          m_commandCount = 0;
+          m_stringBufferLength = 0;
+        }
+
+        // Returns false if the frame is full.
+        bool addCommand(const RetainedCommand& in_command, const char* in_string = nullptr)
+        {
+          if (m_commandCount >= m_commands.size()) { return false; }
+
+          RetainedCommand& command = m_commands[m_commandCount];
+          command = in_command;
+          command.isMatched = false;
+
+          if (command.isText())
+          {
+            size_t stringLength = halvoeCString::getLength(in_string, g_retainedStringBufferLength);
+            if (m_stringBufferLength + stringLength + g_zeroTerminatorLength > m_stringBuffer.size()) { return false; }
+            halvoeCString::copy(in_string, m_stringBuffer.data() + m_stringBufferLength, stringLength);
+            command.stringOffset = m_stringBufferLength;
+            command.stringLength = stringLength;
+            m_stringBufferLength = m_stringBufferLength + stringLength + g_zeroTerminatorLength;
+          }
+
+          ++m_commandCount;
+          return true;
+        }
+
+        size_t getCommandCount() const
+        {
+          return m_commandCount;
+        }
+
+        RetainedCommand& getCommand(size_t in_index)
+        {
+          return m_commands[in_index];
+        }
+
+        const RetainedCommand& getCommand(size_t in_index) const
+        {
+          return m_commands[in_index];
+        }
+
+        const char* getString(const RetainedCommand& in_command) const
+        {
+          if (not in_command.isText()) { return nullptr; }
+          return m_stringBuffer.data() + in_command.stringOffset;
+        }
+
+        bool isSameCommand(size_t in_index, const RetainedFrame& in_otherFrame, size_t in_otherIndex) const
+        {
+          const RetainedCommand& command = m_commands[in_index];
+          const RetainedCommand& otherCommand = in_otherFrame.m_commands[in_otherIndex];
+
+          if (command.commandCode != otherCommand.commandCode || command.rect != otherCommand.rect) { return false; }
+          if (command.isText())
+          {
+            return command.textState == otherCommand.textState && command.stringLength == otherCommand.stringLength
+                   && memcmp(getString(command), in_otherFrame.getString(otherCommand), command.stringLength) == 0;
+          }
+
+          if (command.commandCode == SerialGFXCommandCode::blitBegin)
+          {
+            return command.pixelHash == otherCommand.pixelHash && command.blitCodec == otherCommand.blitCodec
+                   && command.isBestBlitCodec == otherCommand.isBestBlitCodec;
+          }
+
+          if (command.commandCode == SerialGFXCommandCode::drawSprite)
+          {
+            return command.spriteID == otherCommand.spriteID && command.pixelHash == otherCommand.pixelHash
+                   && command.isTransparent == otherCommand.isTransparent && command.color == otherCommand.color;
+          }
+
+          return command.color == otherCommand.color;
+        }
+    };
+
+    // A set of rects, which covers (at least) all pixels that have to be redrawn.
+    // If there are more than g_maxDirtyRectCount rects, rects are merged, so the region only grows.
+    class DirtyRegion
+    {
+      private:
+        std::array<Rect, g_maxDirtyRectCount> m_rects;
+        size_t m_rectCount = 0;
+
+      private:
+        void removeRect(size_t in_index)
+        {
+          m_rects[in_index] = m_rects[m_rectCount - 1];
+          --m_rectCount;
+        }
+
+      public:
+        void clear()
+        {
+          m_rectCount = 0;
+        }
+
+        bool isEmpty() const
+        {
+          return m_rectCount == 0;
+        }
+
+        size_t getRectCount() const
+        {
+          return m_rectCount;
+        }
+
+        const Rect& getRect(size_t in_index) const
+        {
+          return m_rects[in_index];
+        }
+
+        bool intersects(const Rect& in_rect) const
+        {
+          for (size_t index = 0; index < m_rectCount; ++index)
+          {
+            if (m_rects[index].intersects(in_rect)) { return true; }
+          }
+
+          return false;
+        }
+
+        // true if a single rect of the region contains in_rect
+        bool contains(const Rect& in_rect) const
+        {
+          for (size_t index = 0; index < m_rectCount; ++index)
+          {
+            if (m_rects[index].contains(in_rect)) { return true; }
+          }
+
+          return false;
+        }
+
+        // Returns true if the region has grown.
+        bool add(const Rect& in_rect)
+        {
+          Rect rect = getIntersection(in_rect, getScreenRect());
+          if (rect.isEmpty() || contains(rect)) { return false; }
+
+          // Rects, which overlap so much that their union is not larger than both together, are merged.
+          for (size_t index = 0; index < m_rectCount;)
+          {
+            Rect merged = getUnion(m_rects[index], rect);
+            if (merged.getArea() <= m_rects[index].getArea() + rect.getArea())
+            {
+              rect = merged;
+              removeRect(index);
+              index = 0; // the merged rect may now overlap rects we have already checked
+              continue;
+            }
+
+            ++index;
+          }
+
+          if (m_rectCount < m_rects.size())
+          {
+            m_rects[m_rectCount] = rect;
+            ++m_rectCount;
+            return true;
+          }
+
+          // no free rect left: merge with the rect, whose area grows the least
+          size_t bestIndex = 0;
+          int32_t bestGrowth = INT32_MAX;
+          for (size_t index = 0; index < m_rectCount; ++index)
+          {
+            int32_t growth = getUnion(m_rects[index], rect).getArea() - m_rects[index].getArea();
+            if (growth < bestGrowth) { bestIndex = index; bestGrowth = growth; }
+          }
+
+          m_rects[bestIndex] = getUnion(m_rects[bestIndex], rect);
+          return true;
+        }
+    };
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace halvoeGPU
+{
+  // Lock-free single-producer/single-consumer ring.
+  // The producer fills the slot from getPushSlot() in place and publishes it with push(),
+  // the consumer reads the slot from getFront() in place and releases it with pop().
+  // Only the producer writes m_tail and only the consumer writes m_head, so no locks are needed,
+  // as long as there is exactly one producer (core, IRQ or thread) and one consumer.
+  template<typename ElementType, size_t t_capacity>
+  class SPSCQueue
+  {
+    static_assert(t_capacity >= 2 && (t_capacity & (t_capacity - 1)) == 0, "t_capacity must be a power of two");
+
+    private:
+      std::array<ElementType, t_capacity> m_elements;
+      std::atomic<size_t> m_head{ 0 };
+      std::atomic<size_t> m_tail{ 0 };
+
+    public:
+      // producer side
+
+      ElementType* getPushSlot()
+      {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= t_capacity) { return nullptr; }
+        return &m_elements[tail & (t_capacity - 1)];
+      }
+
+      void push()
+      {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+
+      // consumer side
+
+      ElementType* getFront()
+      {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) { return nullptr; }
+        return &m_elements[head & (t_capacity - 1)];
+      }
+
+      void pop()
+      {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+
+      // either side (the result may be outdated as soon as it is returned)
+
+      size_t getSize() const
+      {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+      }
+
+      bool isEmpty() const
+      {
+        return getSize() == 0;
+      }
+
+      bool isFull() const
+      {
+        return getSize() >= t_capacity;
+      }
+
+      static constexpr size_t getCapacity()
+      {
+        return t_capacity;
+      }
+  };
+}
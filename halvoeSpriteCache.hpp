@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+#ifndef HALVOE_GPU_SPRITE_ARENA_LENGTH
+  #define HALVOE_GPU_SPRITE_ARENA_LENGTH 49152
+#endif // HALVOE_GPU_SPRITE_ARENA_LENGTH
+
+namespace halvoeGPU
+{
+  namespace atGPU
+  {
+    constexpr const size_t g_maxSpriteCount = 64;
+    constexpr const size_t g_maxSpriteArenaLength = HALVOE_GPU_SPRITE_ARENA_LENGTH;
+    constexpr const size_t g_minSpriteArenaLength = 4096;
+    constexpr const uint8_t g_noSpriteEntry = 0xFF;
+
+    struct SpriteEntry
+    {
+      uint8_t id = 0;
+      uint16_t width = 0;
+      uint16_t height = 0;
+      size_t offset = 0;
+      uint32_t lastUse = 0;
+      bool isUsed = false;
+
+      size_t getLength() const
+      {
+        return static_cast<size_t>(width) * height;
+      }
+    };
+
+    struct SpriteIDList
+    {
+      std::array<uint8_t, g_maxSpriteCount> ids;
+      size_t count = 0;
+    };
+
+    // Sprites (8-bit palette indices) in one arena, which is allocated after the framebuffers from the remaining heap.
+    // If a new sprite does not fit, the least recently used sprites are evicted and the arena is compacted.
+    class SpriteCache
+    {
+      private:
+        uint8_t* m_arena = nullptr;
+        size_t m_arenaLength = 0;
+        size_t m_usedLength = 0;
+        std::array<SpriteEntry, g_maxSpriteCount> m_entries;
+        std::array<uint8_t, g_maxSpriteIDCount> m_entryIndices; // sprite id -> index into m_entries or g_noSpriteEntry
+        uint32_t m_useCounter = 0;
+        unsigned long m_evictionCount = 0;
+
+      private:
+        void removeEntry(size_t in_index)
+        {
+          SpriteEntry& entry = m_entries[in_index];
+          m_entryIndices[entry.id] = g_noSpriteEntry;
+          m_usedLength = m_usedLength - entry.getLength();
+          entry.isUsed = false;
+        }
+
+        bool evictLeastRecentlyUsed(SpriteIDList& io_evictedIDs)
+        {
+          size_t leastIndex = m_entries.size();
+          for (size_t index = 0; index < m_entries.size(); ++index)
+          {
+            if (not m_entries[index].isUsed) { continue; }
+            if (leastIndex == m_entries.size() || m_entries[index].lastUse < m_entries[leastIndex].lastUse) { leastIndex = index; }
+          }
+
+          if (leastIndex == m_entries.size()) { return false; }
+
+          if (io_evictedIDs.count < io_evictedIDs.ids.size()) { io_evictedIDs.ids[io_evictedIDs.count++] = m_entries[leastIndex].id; }
+          removeEntry(leastIndex);
+          ++m_evictionCount;
+          return true;
+        }
+
+        // the indices of the used entries, sorted by their offset in the arena
+        size_t getSortedEntryIndices(std::array<uint8_t, g_maxSpriteCount>& out_indices) const
+        {
+          size_t count = 0;
+          for (size_t index = 0; index < m_entries.size(); ++index)
+          {
+            if (not m_entries[index].isUsed) { continue; }
+
+            size_t position = count++;
+            while (position > 0 && m_entries[out_indices[position - 1]].offset > m_entries[index].offset)
+            {
+              out_indices[position] = out_indices[position - 1];
+              --position;
+            }
+
+            out_indices[position] = index;
+          }
+
+          return count;
+        }
+
+        // first fit, returns false if no gap is large enough
+        bool findGap(size_t in_length, size_t& out_offset) const
+        {
+          std::array<uint8_t, g_maxSpriteCount> sortedIndices;
+          size_t sortedCount = getSortedEntryIndices(sortedIndices);
+          size_t gapBegin = 0;
+
+          for (size_t position = 0; position < sortedCount; ++position)
+          {
+            const SpriteEntry& entry = m_entries[sortedIndices[position]];
+            if (entry.offset - gapBegin >= in_length) { out_offset = gapBegin; return true; }
+            gapBegin = entry.offset + entry.getLength();
+          }
+
+          if (m_arenaLength - gapBegin < in_length) { return false; }
+          out_offset = gapBegin;
+          return true;
+        }
+
+        // moves all sprites to the begin of the arena, so the free space is one gap at its end
+        void compact()
+        {
+          std::array<uint8_t, g_maxSpriteCount> sortedIndices;
+          size_t sortedCount = getSortedEntryIndices(sortedIndices);
+          size_t offset = 0;
+
+          for (size_t position = 0; position < sortedCount; ++position)
+          {
+            SpriteEntry& entry = m_entries[sortedIndices[position]];
+            if (entry.offset != offset) { memmove(m_arena + offset, m_arena + entry.offset, entry.getLength()); }
+            entry.offset = offset;
+            offset = offset + entry.getLength();
+          }
+        }
+
+      public:
+        ~SpriteCache()
+        {
+          free(m_arena);
+        }
+
+        // Allocates the largest arena up to in_maxLength (in steps of g_minSpriteArenaLength), that is available.
+        // Call this after the framebuffers are allocated.
+        bool begin(size_t in_maxLength = g_maxSpriteArenaLength)
+        {
+          m_entryIndices.fill(g_noSpriteEntry);
+
+          for (size_t length = in_maxLength; length >= g_minSpriteArenaLength && m_arena == nullptr; length = length - g_minSpriteArenaLength)
+          {
+            m_arena = static_cast<uint8_t*>(malloc(length));
+            if (m_arena != nullptr) { m_arenaLength = length; }
+          }
+
+          return m_arena != nullptr;
+        }
+
+        size_t getArenaLength() const
+        {
+          return m_arenaLength;
+        }
+
+        size_t getUsedLength() const
+        {
+          return m_usedLength;
+        }
+
+        unsigned long getEvictionCount() const
+        {
+          return m_evictionCount;
+        }
+
+        // Returns nullptr if the sprite is not in the cache. in_isUse marks the sprite as most recently used.
+        SpriteEntry* find(uint8_t in_id, bool in_isUse = true)
+        {
+          uint8_t index = m_entryIndices[in_id];
+          if (index == g_noSpriteEntry) { return nullptr; }
+          if (in_isUse) { m_entries[index].lastUse = ++m_useCounter; }
+          return &m_entries[index];
+        }
+
+        uint8_t* getPixels(const SpriteEntry& in_entry)
+        {
+          return m_arena + in_entry.offset;
+        }
+
+        void remove(uint8_t in_id)
+        {
+          if (m_entryIndices[in_id] != g_noSpriteEntry) { removeEntry(m_entryIndices[in_id]); }
+        }
+
+        // Replaces a sprite with the same id. Sprites, which are evicted to make room, are appended to io_evictedIDs.
+        // Returns nullptr if the sprite is larger than the arena.
+        SpriteEntry* allocate(uint8_t in_id, uint16_t in_width, uint16_t in_height, SpriteIDList& io_evictedIDs)
+        {
+          remove(in_id);
+
+          size_t length = static_cast<size_t>(in_width) * in_height;
+          if (length == 0 || length > m_arenaLength) { return nullptr; }
+
+          size_t entryIndex = m_entries.size();
+          while (entryIndex == m_entries.size())
+          {
+            for (entryIndex = 0; entryIndex < m_entries.size() && m_entries[entryIndex].isUsed; ++entryIndex) {}
+            if (entryIndex == m_entries.size() && not evictLeastRecentlyUsed(io_evictedIDs)) { return nullptr; }
+          }
+
+          while (m_arenaLength - m_usedLength < length)
+          {
+            if (not evictLeastRecentlyUsed(io_evictedIDs)) { return nullptr; }
+          }
+
+          size_t offset = 0;
+          if (not findGap(length, offset))
+          {
+            compact();
+            offset = m_usedLength;
+          }
+
+          SpriteEntry& entry = m_entries[entryIndex];
+          entry.id = in_id;
+          entry.width = in_width;
+          entry.height = in_height;
+          entry.offset = offset;
+          entry.lastUse = ++m_useCounter;
+          entry.isUsed = true;
+          m_entryIndices[in_id] = entryIndex;
+          m_usedLength = m_usedLength + length;
+          return &entry;
+        }
+
+        // Copies the sprite into io_framebuffer (g_screenWidth x g_screenHeight), clipped to the screen.
+        // If in_isTransparent, pixels with the value in_transparentColor are skipped.
+        void draw(const SpriteEntry& in_entry, uint8_t* io_framebuffer, int16_t in_x, int16_t in_y,
+                  bool in_isTransparent, uint8_t in_transparentColor)
+        {
+          int32_t left = max(static_cast<int32_t>(in_x), static_cast<int32_t>(0));
+          int32_t top = max(static_cast<int32_t>(in_y), static_cast<int32_t>(0));
+          int32_t right = min(static_cast<int32_t>(in_x) + in_entry.width, static_cast<int32_t>(g_screenWidth));
+          int32_t bottom = min(static_cast<int32_t>(in_y) + in_entry.height, static_cast<int32_t>(g_screenHeight));
+          if (io_framebuffer == nullptr || left >= right || top >= bottom) { return; }
+
+          size_t visibleWidth = right - left;
+          const uint8_t* source = getPixels(in_entry) + static_cast<size_t>(top - in_y) * in_entry.width + (left - in_x);
+          uint8_t* target = io_framebuffer + static_cast<size_t>(top) * g_screenWidth + left;
+
+          for (int32_t y = top; y < bottom; ++y)
+          {
+            if (not in_isTransparent) { memcpy(target, source, visibleWidth); }
+            else
+            {
+              for (size_t x = 0; x < visibleWidth; ++x)
+              {
+                if (source[x] != in_transparentColor) { target[x] = source[x]; }
+              }
+            }
+
+            source = source + in_entry.width;
+            target = target + g_screenWidth;
+          }
+        }
+    };
+  }
+}
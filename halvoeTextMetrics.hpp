@@ -0,0 +1,250 @@
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+#ifndef HALVOE_GPU_TEXT_METRICS_CACHE_LENGTH
+  #define HALVOE_GPU_TEXT_METRICS_CACHE_LENGTH 32
+#endif // HALVOE_GPU_TEXT_METRICS_CACHE_LENGTH
+
+namespace halvoeGPU
+{
+  namespace atCPU
+  {
+    constexpr const size_t g_textMetricsCacheLength = HALVOE_GPU_TEXT_METRICS_CACHE_LENGTH;
+    constexpr const int16_t g_defaultFontCellWidth = 6;  // the built-in font of Adafruit_GFX
+    constexpr const int16_t g_defaultFontCellHeight = 8;
+    constexpr const size_t g_maxGlyphMetricsCount = 256;
+    constexpr const size_t g_maxCachedTextLength = 64; // longer strings are measured every time
+
+    struct TextBounds
+    {
+      int16_t x = 0;
+      int16_t y = 0;
+      uint16_t width = 0;
+      uint16_t height = 0;
+    };
+
+    struct GlyphMetrics
+    {
+      int8_t left = 0; // xOffset
+      int8_t top = 0;  // yOffset
+      uint8_t width = 0;
+      uint8_t height = 0;
+      uint8_t advance = 0;
+    };
+
+    // The extent of a string without line breaks, relative to a cursor at (0, 0), as Adafruit_GFX::charBounds() accumulates it.
+    // It does not depend on the cursor, so one layout answers getTextBounds() for every cursor, at which the string does not wrap.
+    struct TextLayout
+    {
+      bool hasGlyphs = false;
+      int16_t minX = 0;
+      int16_t minY = 0;
+      int16_t maxX = 0;
+      int16_t maxY = 0;
+      int16_t wrapX = 0; // the largest x, which the wrap check of a glyph compares with the width
+
+      void addGlyph(int16_t in_x1, int16_t in_y1, int16_t in_x2, int16_t in_y2, int16_t in_wrapX)
+      {
+        if (not hasGlyphs) { minX = in_x1; minY = in_y1; maxX = in_x2; maxY = in_y2; wrapX = in_wrapX; hasGlyphs = true; return; }
+        if (in_x1 < minX) { minX = in_x1; }
+        if (in_y1 < minY) { minY = in_y1; }
+        if (in_x2 > maxX) { maxX = in_x2; }
+        if (in_y2 > maxY) { maxY = in_y2; }
+        if (in_wrapX > wrapX) { wrapX = in_wrapX; }
+      }
+
+      // like Adafruit_GFX::getTextBounds() with the cursor at (in_x, in_y), including its empty bounds
+      TextBounds getBounds(int16_t in_x, int16_t in_y) const
+      {
+        TextBounds bounds{ in_x, in_y, 0, 0 };
+        if (not hasGlyphs) { return bounds; }
+
+        int16_t boundsMinX = min(static_cast<int16_t>(in_x + minX), int16_t(0x7FFF));
+        int16_t boundsMinY = min(static_cast<int16_t>(in_y + minY), int16_t(0x7FFF));
+        int16_t boundsMaxX = max(static_cast<int16_t>(in_x + maxX), int16_t(-1));
+        int16_t boundsMaxY = max(static_cast<int16_t>(in_y + maxY), int16_t(-1));
+        if (boundsMaxX >= boundsMinX) { bounds.x = boundsMinX; bounds.width = boundsMaxX - boundsMinX + 1; }
+        if (boundsMaxY >= boundsMinY) { bounds.y = boundsMinY; bounds.height = boundsMaxY - boundsMinY + 1; }
+        return bounds;
+      }
+    };
+
+    struct TextMetricsEntry
+    {
+      uint32_t hash = 0;
+      uint16_t length = 0;
+      std::array<char, g_maxCachedTextLength> text; // a hit is only decided by the string, the hash only sorts out the others fast
+      SerialGFXFont font = SerialGFXFont::Default;
+      uint8_t size = 1;
+      TextLayout layout;
+      uint32_t lastUse = 0;
+      bool isUsed = false;
+    };
+
+    // Measures text like Adafruit_GFX::getTextBounds() (text wrap enabled, no rotation), but without walking the glyphs every time.
+    // The default font has fixed cells, its layout follows from the length of the string. The layouts of a GFX font are computed from
+    // a glyph table, which is copied from the font once, and kept in an LRU cache by the string, the font and the size.
+    // Strings with line breaks and strings, which wrap at the cursor, are not measured, getTextBounds() returns false for them.
+    class TextMetricsCache
+    {
+      private:
+        SerialGFXFont m_font = SerialGFXFont::Default;
+        const GFXfont* m_fontPointer = nullptr;
+        uint8_t m_size = 1;
+
+        const GFXfont* m_glyphFont = nullptr; // the font, from which m_glyphs is copied
+        std::array<GlyphMetrics, g_maxGlyphMetricsCount> m_glyphs;
+
+        std::array<TextMetricsEntry, g_textMetricsCacheLength> m_entries;
+        uint32_t m_useCounter = 0;
+        unsigned long m_hitCount = 0;
+        unsigned long m_missCount = 0;
+
+      private:
+        void copyGlyphs(const GFXfont* in_font)
+        {
+          m_glyphFont = in_font;
+          for (size_t character = in_font->first; character <= in_font->last && character < m_glyphs.size(); ++character)
+          {
+            const GFXglyph& glyph = in_font->glyph[character - in_font->first];
+            m_glyphs[character] = GlyphMetrics{ glyph.xOffset, glyph.yOffset, glyph.width, glyph.height, glyph.xAdvance };
+          }
+        }
+
+        // FNV-1a, returns false for a string with a line break
+        static bool hashString(const char* in_string, uint32_t& out_hash, size_t& out_length)
+        {
+          uint32_t hash = 2166136261u;
+          size_t length = 0;
+          for (; in_string[length] != '\0'; ++length)
+          {
+            if (in_string[length] == '\n') { return false; }
+            hash = (hash ^ static_cast<uint8_t>(in_string[length])) * 16777619u;
+          }
+
+          out_hash = hash;
+          out_length = length;
+          return true;
+        }
+
+        TextLayout getDefaultFontLayout(size_t in_length, const char* in_string) const
+        {
+          TextLayout layout;
+          int16_t glyphCount = 0;
+          for (size_t index = 0; index < in_length; ++index) { if (in_string[index] != '\r') { ++glyphCount; } }
+          if (glyphCount == 0) { return layout; }
+
+          int16_t width = glyphCount * g_defaultFontCellWidth * m_size;
+          layout.addGlyph(0, 0, width - 1, g_defaultFontCellHeight * m_size - 1, width);
+          return layout;
+        }
+
+        TextLayout getGlyphLayout(const char* in_string) const
+        {
+          TextLayout layout;
+          int16_t x = 0;
+          int16_t size = m_size;
+          for (; *in_string != '\0'; ++in_string)
+          {
+            uint8_t character = static_cast<uint8_t>(*in_string);
+            if (character == '\r' || character < m_fontPointer->first || character > m_fontPointer->last) { continue; }
+
+            const GlyphMetrics& glyph = m_glyphs[character];
+            int16_t x1 = x + glyph.left * size;
+            int16_t y1 = glyph.top * size;
+            layout.addGlyph(x1, y1, x1 + glyph.width * size - 1, y1 + glyph.height * size - 1, x + (glyph.left + glyph.width) * size);
+            x = x + glyph.advance * size;
+          }
+
+          return layout;
+        }
+
+        // in_length is at most g_maxCachedTextLength
+        TextMetricsEntry& getEntry(uint32_t in_hash, size_t in_length, const char* in_string)
+        {
+          size_t leastRecentIndex = 0;
+          for (size_t index = 0; index < m_entries.size(); ++index)
+          {
+            TextMetricsEntry& entry = m_entries[index];
+            if (entry.isUsed && entry.hash == in_hash && entry.length == in_length && entry.font == m_font && entry.size == m_size &&
+                memcmp(entry.text.data(), in_string, in_length) == 0)
+            {
+              ++m_hitCount;
+              entry.lastUse = ++m_useCounter;
+              return entry;
+            }
+
+            if (not entry.isUsed) { leastRecentIndex = index; }
+            else if (m_entries[leastRecentIndex].isUsed && entry.lastUse < m_entries[leastRecentIndex].lastUse) { leastRecentIndex = index; }
+          }
+
+          ++m_missCount;
+          TextMetricsEntry& entry = m_entries[leastRecentIndex];
+          entry = TextMetricsEntry{ in_hash, static_cast<uint16_t>(in_length), {}, m_font, m_size, getGlyphLayout(in_string), ++m_useCounter, true };
+          memcpy(entry.text.data(), in_string, in_length);
+          return entry;
+        }
+
+      public:
+        // returns false for a font, which is not known
+        bool setFont(SerialGFXFont in_font)
+        {
+          const GFXfont* fontPointer = nullptr;
+          if (not getFontPointer(in_font, fontPointer)) { return false; }
+          if (fontPointer != nullptr && fontPointer != m_glyphFont) { copyGlyphs(fontPointer); }
+          m_font = in_font;
+          m_fontPointer = fontPointer;
+          return true;
+        }
+
+        void setTextSize(uint8_t in_size)
+        {
+          m_size = max(in_size, uint8_t(1));
+        }
+
+        // Returns false, if in_string has a line break or wraps at in_wrapWidth, Adafruit_GFX has to measure it then.
+        bool getTextBounds(const char* in_string, int16_t in_x, int16_t in_y, int16_t in_wrapWidth, TextBounds& out_bounds)
+        {
+          uint32_t hash = 0;
+          size_t length = 0;
+          if (not hashString(in_string, hash, length) || length > UINT16_MAX) { return false; }
+
+          if (m_fontPointer == nullptr)
+          {
+            TextLayout layout = getDefaultFontLayout(length, in_string);
+            if (layout.hasGlyphs && in_x + layout.wrapX > in_wrapWidth) { return false; }
+            out_bounds = layout.getBounds(in_x, in_y);
+            return true;
+          }
+
+          if (length > g_maxCachedTextLength) { ++m_missCount; }
+          TextLayout layout = length <= g_maxCachedTextLength ? getEntry(hash, length, in_string).layout : getGlyphLayout(in_string);
+          if (layout.hasGlyphs && in_x + layout.wrapX > in_wrapWidth) { return false; }
+          out_bounds = layout.getBounds(in_x, in_y);
+          return true;
+        }
+
+        void clear()
+        {
+          m_entries.fill(TextMetricsEntry());
+        }
+
+        unsigned long getHitCount() const
+        {
+          return m_hitCount;
+        }
+
+        unsigned long getMissCount() const
+        {
+          return m_missCount;
+        }
+    };
+  }
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "halvoeRaster.hpp"
+#include "halvoeRect.hpp"
+#include "SerialGFXInterface.hpp"
+
+#ifndef HALVOE_GPU_TILE_WIDTH
+  #define HALVOE_GPU_TILE_WIDTH 32
+#endif // HALVOE_GPU_TILE_WIDTH
+
+#ifndef HALVOE_GPU_TILE_HEIGHT
+  #define HALVOE_GPU_TILE_HEIGHT 16
+#endif // HALVOE_GPU_TILE_HEIGHT
+
+#ifndef HALVOE_GPU_MAX_DEFERRED_RECT_COUNT
+  #define HALVOE_GPU_MAX_DEFERRED_RECT_COUNT 256
+#endif // HALVOE_GPU_MAX_DEFERRED_RECT_COUNT
+
+#ifndef HALVOE_GPU_MAX_TILE_BIN_ENTRY_COUNT
+  #define HALVOE_GPU_MAX_TILE_BIN_ENTRY_COUNT 2048
+#endif // HALVOE_GPU_MAX_TILE_BIN_ENTRY_COUNT
+
+namespace halvoeGPU
+{
+  namespace atGPU
+  {
+    constexpr const size_t g_tileWidth = HALVOE_GPU_TILE_WIDTH;
+    constexpr const size_t g_tileHeight = HALVOE_GPU_TILE_HEIGHT;
+    constexpr const size_t g_tileColumnCount = g_screenWidth / g_tileWidth;
+    constexpr const size_t g_tileRowCount = g_screenHeight / g_tileHeight;
+    constexpr const size_t g_tileCount = g_tileColumnCount * g_tileRowCount;
+    constexpr const size_t g_maxDeferredRectCount = HALVOE_GPU_MAX_DEFERRED_RECT_COUNT;
+    constexpr const size_t g_maxTileBinEntryCount = HALVOE_GPU_MAX_TILE_BIN_ENTRY_COUNT;
+    constexpr const uint16_t g_noTileBinEntry = UINT16_MAX;
+
+    // an opaque rect of the deferred frame, clipped to the screen
+    struct DeferredRect
+    {
+      Rect area;
+      uint8_t color = 0;
+      bool isCulled = false; // covered by a later rect
+    };
+
+    // one rect in the list of a tile, the lists keep the order of the commands
+    struct TileBinEntry
+    {
+      uint16_t rectIndex = 0;
+      uint16_t next = g_noTileBinEntry;
+    };
+
+    // Defers fillScreen, fillRect and drawRect until render(). Every rect is clipped once and added to the bins of the tiles it touches.
+    // A rect, which a later rect covers completely, is culled (a fillScreen culls everything before it). render() draws tile by tile
+    // in painter order: a tile, which one rect covers, starts at the last such rect and is composed in m_tile, then copied to the
+    // framebuffer once. The rects of the other tiles are clipped to the tile and filled in the framebuffer directly.
+    // The pixels stay the same as with the immediate fillRect() and drawRect() of halvoeRaster.hpp.
+    class TileBinner
+    {
+      static_assert(g_screenWidth % g_tileWidth == 0 && g_screenHeight % g_tileHeight == 0, "the tiles have to cover the screen exactly");
+      static_assert(g_tileWidth % g_rasterWordLength == 0, "the rows of m_tile are word aligned");
+      static_assert(g_maxDeferredRectCount < g_noTileBinEntry && g_maxTileBinEntryCount < g_noTileBinEntry, "the indices are uint16_t");
+      static_assert(g_maxTileBinEntryCount >= g_tileCount, "a fillScreen has one entry per tile");
+
+      private:
+        std::array<DeferredRect, g_maxDeferredRectCount> m_rects;
+        size_t m_rectCount = 0;
+        std::array<TileBinEntry, g_maxTileBinEntryCount> m_entries;
+        size_t m_entryCount = 0;
+        std::array<uint16_t, g_tileCount> m_binHeads;
+        std::array<uint16_t, g_tileCount> m_binTails;
+        alignas(uint32_t) std::array<uint8_t, g_tileWidth * g_tileHeight> m_tile;
+
+        uint32_t m_deferredPixelCount = 0;
+        uint32_t m_writtenPixelCount = 0;
+        uint32_t m_culledRectCount = 0;
+
+      private:
+        static Rect getTileArea(size_t in_column, size_t in_row)
+        {
+          return Rect{ static_cast<int16_t>(in_column * g_tileWidth), static_cast<int16_t>(in_row * g_tileHeight),
+                       static_cast<int16_t>(g_tileWidth), static_cast<int16_t>(g_tileHeight) };
+        }
+
+        static size_t getBinEntryCount(const Rect& in_area)
+        {
+          size_t columnCount = (in_area.getRight() - 1) / g_tileWidth - in_area.x / g_tileWidth + 1;
+          size_t rowCount = (in_area.getBottom() - 1) / g_tileHeight - in_area.y / g_tileHeight + 1;
+          return columnCount * rowCount;
+        }
+
+        void clear()
+        {
+          m_rectCount = 0;
+          m_entryCount = 0;
+          m_binHeads.fill(g_noTileBinEntry);
+          m_binTails.fill(g_noTileBinEntry);
+        }
+
+        void cullCoveredRects(const Rect& in_area)
+        {
+          for (size_t index = 0; index < m_rectCount; ++index)
+          {
+            DeferredRect& rect = m_rects[index];
+            if (not rect.isCulled && in_area.contains(rect.area)) { rect.isCulled = true; ++m_culledRectCount; }
+          }
+        }
+
+        // in_area is clipped to the screen and not empty
+        void addArea(uint8_t* io_framebuffer, const Rect& in_area, uint8_t in_color)
+        {
+          m_deferredPixelCount = m_deferredPixelCount + in_area.getArea();
+
+          if (in_area.width == g_screenWidth && in_area.height == g_screenHeight)
+          {
+            for (size_t index = 0; index < m_rectCount; ++index) { if (not m_rects[index].isCulled) { ++m_culledRectCount; } }
+            clear();
+          }
+          else
+          {
+            size_t entryCount = getBinEntryCount(in_area);
+            if (m_rectCount == m_rects.size() || m_entryCount + entryCount > m_entries.size()) { render(io_framebuffer); }
+            cullCoveredRects(in_area);
+          }
+
+          uint16_t rectIndex = static_cast<uint16_t>(m_rectCount++);
+          m_rects[rectIndex] = DeferredRect{ in_area, in_color, false };
+
+          for (size_t row = in_area.y / g_tileHeight; row <= (in_area.getBottom() - 1) / g_tileHeight; ++row)
+          {
+            for (size_t column = in_area.x / g_tileWidth; column <= (in_area.getRight() - 1) / g_tileWidth; ++column)
+            {
+              size_t tile = row * g_tileColumnCount + column;
+              uint16_t entryIndex = static_cast<uint16_t>(m_entryCount++);
+              m_entries[entryIndex] = TileBinEntry{ rectIndex, g_noTileBinEntry };
+              if (m_binTails[tile] == g_noTileBinEntry) { m_binHeads[tile] = entryIndex; }
+              else { m_entries[m_binTails[tile]].next = entryIndex; }
+              m_binTails[tile] = entryIndex;
+            }
+          }
+        }
+
+        void renderTile(uint8_t* io_framebuffer, size_t in_column, size_t in_row)
+        {
+          size_t tile = in_row * g_tileColumnCount + in_column;
+          Rect tileArea = getTileArea(in_column, in_row);
+
+          // everything in front of the last rect, which covers the whole tile, is hidden by it
+          uint16_t firstEntry = g_noTileBinEntry;
+          for (uint16_t entry = m_binHeads[tile]; entry != g_noTileBinEntry; entry = m_entries[entry].next)
+          {
+            const DeferredRect& rect = m_rects[m_entries[entry].rectIndex];
+            if (not rect.isCulled && rect.area.contains(tileArea)) { firstEntry = entry; }
+          }
+
+          if (firstEntry == g_noTileBinEntry)
+          {
+            for (uint16_t entry = m_binHeads[tile]; entry != g_noTileBinEntry; entry = m_entries[entry].next)
+            {
+              const DeferredRect& rect = m_rects[m_entries[entry].rectIndex];
+              if (rect.isCulled) { continue; }
+
+              Rect area = getIntersection(rect.area, tileArea);
+              if (area.isEmpty()) { continue; }
+              fillArea(io_framebuffer, g_screenWidth, area, rect.color);
+              m_writtenPixelCount = m_writtenPixelCount + area.getArea();
+            }
+
+            return;
+          }
+
+          memset(m_tile.data(), m_rects[m_entries[firstEntry].rectIndex].color, m_tile.size());
+          for (uint16_t entry = m_entries[firstEntry].next; entry != g_noTileBinEntry; entry = m_entries[entry].next)
+          {
+            const DeferredRect& rect = m_rects[m_entries[entry].rectIndex];
+            if (rect.isCulled) { continue; }
+
+            Rect area = getIntersection(rect.area, tileArea);
+            if (area.isEmpty()) { continue; }
+            area.x = area.x - tileArea.x;
+            area.y = area.y - tileArea.y;
+            fillArea(m_tile.data(), g_tileWidth, area, rect.color);
+          }
+
+          uint8_t* row = io_framebuffer + static_cast<size_t>(tileArea.y) * g_screenWidth + tileArea.x;
+          for (size_t tileRow = 0; tileRow < g_tileHeight; ++tileRow)
+          {
+            memcpy(row, m_tile.data() + tileRow * g_tileWidth, g_tileWidth);
+            row = row + g_screenWidth;
+          }
+
+          m_writtenPixelCount = m_writtenPixelCount + m_tile.size();
+        }
+
+      public:
+        TileBinner()
+        {
+          clear();
+        }
+
+        // like fillScreen() of halvoeRaster.hpp, the rects are rendered into io_framebuffer, when the bins are full
+        void fillScreen(uint8_t* io_framebuffer, uint8_t in_color)
+        {
+          addArea(io_framebuffer, Rect{ 0, 0, static_cast<int16_t>(g_screenWidth), static_cast<int16_t>(g_screenHeight) }, in_color);
+        }
+
+        void fillRect(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint8_t in_color)
+        {
+          Rect area;
+          if (getFillRectArea(in_x, in_y, in_width, in_height, area)) { addArea(io_framebuffer, area, in_color); }
+        }
+
+        void drawRect(uint8_t* io_framebuffer, int16_t in_x, int16_t in_y, int16_t in_width, int16_t in_height, uint8_t in_color)
+        {
+          RasterLine edges[g_rectEdgeCount];
+          getRectEdges(in_x, in_y, in_width, in_height, edges);
+
+          for (const RasterLine& edge : edges)
+          {
+            Rect area;
+            if (getLineArea(edge, area)) { addArea(io_framebuffer, area, in_color); }
+          }
+        }
+
+        // draws the deferred rects into io_framebuffer and starts over
+        void render(uint8_t* io_framebuffer)
+        {
+          if (m_rectCount == 0) { return; }
+
+          if (io_framebuffer != nullptr)
+          {
+            for (size_t row = 0; row < g_tileRowCount; ++row)
+            {
+              for (size_t column = 0; column < g_tileColumnCount; ++column)
+              {
+                if (m_binHeads[row * g_tileColumnCount + column] != g_noTileBinEntry) { renderTile(io_framebuffer, column, row); }
+              }
+            }
+          }
+
+          clear();
+        }
+
+        bool isEmpty() const
+        {
+          return m_rectCount == 0;
+        }
+
+        // pixels of the deferred commands, as many as drawing them immediately would write
+        uint32_t getDeferredPixelCount() const
+        {
+          return m_deferredPixelCount;
+        }
+
+        // pixels written into the framebuffer by render(), the difference to getDeferredPixelCount() is the overdraw, which was removed
+        uint32_t getWrittenPixelCount() const
+        {
+          return m_writtenPixelCount;
+        }
+
+        uint32_t getCulledRectCount() const
+        {
+          return m_culledRectCount;
+        }
+    };
+  }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+namespace halvoeGPU
+{
+  // A trace is the byte stream of the link from the CPU to the GPU, as written by atCPU or as received by atGPU,
+  // so host/replayTrace.cpp can run it through atGPU::SerialGFXInterface again.
+  // Header: g_traceMagic, uint8_t version, uint8_t side, uint8_t protocol, uint8_t framing (0 or 1), uint32_t baud,
+  // the state of the link, when the capture began. Then the records: uint32_t micros since then, uint32_t length, the bytes.
+  // At the CPU a record is one packet (from its sync word to its checksum), at the GPU the bytes of one receive ring update.
+  constexpr const char g_traceMagic[] = { 'H', 'G', 'T', 'R' };
+  constexpr const uint8_t g_traceVersion = 1;
+  constexpr const size_t g_traceHeaderLength = sizeof(g_traceMagic) + 4 * sizeof(uint8_t) + sizeof(uint32_t);
+  constexpr const size_t g_traceRecordHeaderLength = 2 * sizeof(uint32_t);
+
+  enum class TraceSide : uint8_t
+  {
+    cpu = 0,
+    gpu
+  };
+
+  struct TraceHeader
+  {
+    TraceSide side = TraceSide::cpu;
+    SerialGFXProtocol protocol = SerialGFXProtocol::v1;
+    bool isFramingEnabled = false;
+    uint32_t baud = 0;
+  };
+
+  struct TraceRecord
+  {
+    uint32_t micros = 0;
+    uint32_t length = 0;
+    const char* bytes = nullptr;
+  };
+
+  // Returns false, if in_trace does not begin with a header of this version.
+  bool readTraceHeader(const char* in_trace, size_t in_length, TraceHeader& out_header)
+  {
+    if (in_length < g_traceHeaderLength || memcmp(in_trace, g_traceMagic, sizeof(g_traceMagic)) != 0) { return false; }
+    const char* fields = in_trace + sizeof(g_traceMagic);
+    if (static_cast<uint8_t>(fields[0]) != g_traceVersion || static_cast<uint8_t>(fields[1]) > static_cast<uint8_t>(TraceSide::gpu)) { return false; }
+    if (not isValidSerialGFXProtocol(static_cast<uint8_t>(fields[2]))) { return false; }
+
+    out_header.side = static_cast<TraceSide>(fields[1]);
+    out_header.protocol = static_cast<SerialGFXProtocol>(fields[2]);
+    out_header.isFramingEnabled = fields[3] != 0;
+    out_header.baud = readValue<uint32_t>(fields + 4);
+    return true;
+  }
+
+  // Reads the record at io_offset and moves io_offset behind it. Returns false at the end of in_trace or at a truncated record.
+  bool readTraceRecord(const char* in_trace, size_t in_length, size_t& io_offset, TraceRecord& out_record)
+  {
+    if (in_length - io_offset < g_traceRecordHeaderLength) { return false; }
+    out_record.micros = readValue<uint32_t>(in_trace + io_offset);
+    out_record.length = readValue<uint32_t>(in_trace + io_offset + sizeof(uint32_t));
+    if (in_length - io_offset - g_traceRecordHeaderLength < out_record.length) { return false; }
+
+    out_record.bytes = in_trace + io_offset + g_traceRecordHeaderLength;
+    io_offset = io_offset + g_traceRecordHeaderLength + out_record.length;
+    return true;
+  }
+
+  // Writes a trace to a Print (a File on an SD card, a second serial, ...). The writes block as long as the Print does,
+  // bytes, which it does not take, are lost (and counted), the records behind them can not be read back then.
+  class TraceWriter
+  {
+    private:
+      Print* m_trace = nullptr;
+      unsigned long m_beginMicros = 0;
+      unsigned long m_recordCount = 0;
+      unsigned long m_lostByteCount = 0;
+
+    public:
+      void begin(Print& io_trace, TraceSide in_side, SerialGFXProtocol in_protocol, bool in_isFramingEnabled, uint32_t in_baud)
+      {
+        m_trace = &io_trace;
+        m_beginMicros = micros();
+        m_recordCount = 0;
+        m_lostByteCount = 0;
+
+        char header[g_traceHeaderLength];
+        memcpy(header, g_traceMagic, sizeof(g_traceMagic));
+        header[4] = static_cast<char>(g_traceVersion);
+        header[5] = static_cast<char>(in_side);
+        header[6] = static_cast<char>(in_protocol);
+        header[7] = in_isFramingEnabled ? 1 : 0;
+        writeValue<uint32_t>(in_baud, header + 8);
+        write(header, sizeof(header));
+      }
+
+      void end()
+      {
+        m_trace = nullptr;
+      }
+
+      bool isEnabled() const
+      {
+        return m_trace != nullptr;
+      }
+
+      // the record has to be followed by write() calls with in_length bytes in total
+      void beginRecord(size_t in_length)
+      {
+        char recordHeader[g_traceRecordHeaderLength];
+        writeValue<uint32_t>(micros() - m_beginMicros, recordHeader);
+        writeValue<uint32_t>(static_cast<uint32_t>(in_length), recordHeader + sizeof(uint32_t));
+        write(recordHeader, sizeof(recordHeader));
+        ++m_recordCount;
+      }
+
+      void write(const void* in_bytes, size_t in_length)
+      {
+        if (in_length == 0) { return; }
+        size_t writtenLength = m_trace->write(static_cast<const uint8_t*>(in_bytes), in_length);
+        if (writtenLength < in_length) { m_lostByteCount = m_lostByteCount + (in_length - writtenLength); }
+      }
+
+      unsigned long getRecordCount() const
+      {
+        return m_recordCount;
+      }
+
+      unsigned long getLostByteCount() const
+      {
+        return m_lostByteCount;
+      }
+  };
+}
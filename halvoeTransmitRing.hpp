@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SerialGFXInterface.hpp"
+
+#ifndef HALVOE_GPU_TRANSMIT_RING_LENGTH
+  #define HALVOE_GPU_TRANSMIT_RING_LENGTH 32768
+#endif // HALVOE_GPU_TRANSMIT_RING_LENGTH
+
+namespace halvoeGPU
+{
+  namespace atCPU
+  {
+    constexpr const size_t g_transmitRingLength = HALVOE_GPU_TRANSMIT_RING_LENGTH;
+    constexpr const size_t g_maxTransmitFrameCount = 16; // frames, which can be dropped; further ones are joined with their successor
+
+    // What send*() does, when a packet does not fit into the transmit ring.
+    enum class TransmitPolicy : uint8_t
+    {
+      block = 0,          // waits, until the link has taken enough bytes
+      dropOldestFrame,    // drops the oldest frame, of which nothing is on the link yet (blocks, if there is none)
+      reportBackPressure  // returns false, the packet is not sent
+    };
+
+    // Encoded packets on their way to the UART. The packets are written in one piece (see getFreeLength()) and read
+    // in contiguous chunks, as the UART takes them. The end of every frame (a swap) is marked, so a frame can be dropped completely.
+    template<size_t t_length>
+    class TransmitRing
+    {
+      static_assert(t_length >= 2 && (t_length & (t_length - 1)) == 0, "t_length must be a power of two");
+
+      private:
+        std::array<char, t_length> m_buffer;
+        uint32_t m_writtenCount = 0;
+        uint32_t m_readCount = 0;
+        std::array<uint32_t, g_maxTransmitFrameCount> m_frameEnds; // m_writtenCount at the marked frame ends, oldest first
+        size_t m_frameCount = 0;
+        uint32_t m_frameBegin = 0; // of the oldest marked frame
+
+      private:
+        void removeFrame(size_t in_index)
+        {
+          for (size_t index = in_index + 1; index < m_frameCount; ++index) { m_frameEnds[index - 1] = m_frameEnds[index]; }
+          --m_frameCount;
+        }
+
+      public:
+        size_t getLength() const
+        {
+          return m_writtenCount - m_readCount;
+        }
+
+        size_t getFreeLength() const
+        {
+          return t_length - getLength();
+        }
+
+        bool isEmpty() const
+        {
+          return m_writtenCount == m_readCount;
+        }
+
+        // in_length must not exceed getFreeLength()
+        void write(const char* in_bytes, size_t in_length)
+        {
+          size_t beginIndex = m_writtenCount & (t_length - 1);
+          size_t firstLength = min(in_length, t_length - beginIndex);
+          memcpy(m_buffer.data() + beginIndex, in_bytes, firstLength);
+          memcpy(m_buffer.data(), in_bytes + firstLength, in_length - firstLength);
+          m_writtenCount = m_writtenCount + in_length;
+        }
+
+        // the bytes from the read position up to the end of the buffer at most
+        const char* getContiguous(size_t& out_length) const
+        {
+          size_t beginIndex = m_readCount & (t_length - 1);
+          out_length = min(getLength(), t_length - beginIndex);
+          return m_buffer.data() + beginIndex;
+        }
+
+        void consume(size_t in_length)
+        {
+          m_readCount = m_readCount + min(in_length, getLength());
+          while (m_frameCount > 0 && static_cast<int32_t>(m_readCount - m_frameEnds[0]) >= 0)
+          {
+            m_frameBegin = m_frameEnds[0];
+            removeFrame(0);
+          }
+        }
+
+        void markFrameEnd()
+        {
+          if (m_frameCount == 0 && isEmpty()) { m_frameBegin = m_writtenCount; return; } // the frame is on the link already
+          if (m_frameCount == m_frameEnds.size()) { return; } // joined with the next frame
+          m_frameEnds[m_frameCount++] = m_writtenCount;
+        }
+
+        // Drops the oldest marked frame, of which no byte is read yet. Returns false, if there is none.
+        bool dropOldestFrame()
+        {
+          if (m_frameCount == 0) { return false; }
+
+          if (m_frameBegin == m_readCount)
+          {
+            m_readCount = m_frameEnds[0];
+            m_frameBegin = m_frameEnds[0];
+            removeFrame(0);
+            return true;
+          }
+
+          if (m_frameCount < 2) { return false; } // the oldest frame is partly on the link
+
+          // the bytes behind the second frame move to its begin
+          uint32_t dropBegin = m_frameEnds[0];
+          uint32_t dropEnd = m_frameEnds[1];
+          uint32_t dropLength = dropEnd - dropBegin;
+          for (uint32_t position = dropEnd; position != m_writtenCount; ++position)
+          {
+            m_buffer[(position - dropLength) & (t_length - 1)] = m_buffer[position & (t_length - 1)];
+          }
+
+          m_writtenCount = m_writtenCount - dropLength;
+          removeFrame(1);
+          for (size_t index = 1; index < m_frameCount; ++index) { m_frameEnds[index] = m_frameEnds[index] - dropLength; }
+          return true;
+        }
+
+        void clear()
+        {
+          m_readCount = m_writtenCount;
+          m_frameCount = 0;
+          m_frameBegin = m_writtenCount;
+        }
+
+        static constexpr size_t getCapacity()
+        {
+          return t_length;
+        }
+    };
+  }
+}
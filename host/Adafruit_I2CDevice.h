@@ -0,0 +1,3 @@
+#pragma once
+
+// Empty host (Linux) stand-in, Adafruit_GFX.h includes it but halvoeGPU does not use I2C.
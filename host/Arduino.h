@@ -0,0 +1,153 @@
+#pragma once
+
+// Host (Linux) stand-in for the parts of the Arduino core used by halvoeGPU.
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "WString.h"
+#include "Print.h"
+
+#ifndef PROGMEM
+  #define PROGMEM
+#endif // PROGMEM
+
+#ifndef pgm_read_byte
+  #define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+  #define pgm_read_word(address) (*reinterpret_cast<const uint16_t*>(address))
+  #define pgm_read_dword(address) (*reinterpret_cast<const uint32_t*>(address))
+  #define pgm_read_pointer(address) (*reinterpret_cast<void* const*>(address))
+#endif // pgm_read_byte
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#define LED_BUILTIN 25
+
+typedef uint8_t pin_size_t;
+
+template<class T, class L>
+auto min(const T& in_a, const L& in_b) -> decltype((in_b < in_a) ? in_b : in_a)
+{
+  return (in_b < in_a) ? in_b : in_a;
+}
+
+template<class T, class L>
+auto max(const T& in_a, const L& in_b) -> decltype((in_b < in_a) ? in_b : in_a)
+{
+  return (in_a < in_b) ? in_b : in_a;
+}
+
+namespace halvoeGPU
+{
+  namespace host
+  {
+    constexpr const size_t g_pinCount = 64;
+
+    inline std::chrono::steady_clock::time_point getStartTime()
+    {
+      static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+      return startTime;
+    }
+
+    struct PinState
+    {
+      std::array<uint8_t, g_pinCount> levels{};
+      std::array<pin_size_t, g_pinCount> connectedTo{};
+
+      PinState()
+      {
+        for (size_t pin = 0; pin < g_pinCount; ++pin) { connectedTo[pin] = static_cast<pin_size_t>(pin); }
+      }
+    };
+
+    inline PinState& getPinState()
+    {
+      static PinState pinState;
+      return pinState;
+    }
+
+    // Wires an output pin of one board to an input pin of the other board,
+    // for example atGPU::READY_PIN to atCPU::READY_PIN.
+    inline void connectPins(pin_size_t in_outputPin, pin_size_t in_inputPin)
+    {
+      getPinState().connectedTo[in_inputPin % g_pinCount] = in_outputPin % g_pinCount;
+    }
+  }
+}
+
+inline unsigned long micros()
+{
+  auto elapsed = std::chrono::steady_clock::now() - halvoeGPU::host::getStartTime();
+  return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+inline unsigned long millis()
+{
+  return micros() / 1000;
+}
+
+inline void delay(unsigned long in_millis)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(in_millis));
+}
+
+inline void delayMicroseconds(unsigned int in_micros)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(in_micros));
+}
+
+inline void yield()
+{
+  std::this_thread::yield();
+}
+
+inline void pinMode(pin_size_t in_pin, uint8_t in_mode)
+{}
+
+inline void digitalWrite(pin_size_t in_pin, uint8_t in_level)
+{
+  halvoeGPU::host::getPinState().levels[in_pin % halvoeGPU::host::g_pinCount] = in_level;
+}
+
+inline int digitalRead(pin_size_t in_pin)
+{
+  halvoeGPU::host::PinState& pinState = halvoeGPU::host::getPinState();
+  return pinState.levels[pinState.connectedTo[in_pin % halvoeGPU::host::g_pinCount]];
+}
+
+// USB serial of the boards, printed to stdout on the host
+class HostConsole : public Print
+{
+  public:
+    void begin(unsigned long in_baud)
+    {}
+
+    operator bool() const
+    {
+      return true;
+    }
+
+    size_t write(uint8_t in_byte) override
+    {
+      return std::fwrite(&in_byte, 1, 1, stdout);
+    }
+
+    size_t write(const uint8_t* in_buffer, size_t in_size) override
+    {
+      return std::fwrite(in_buffer, 1, in_size, stdout);
+    }
+
+    using Print::write;
+};
+
+inline HostConsole Serial;
@@ -0,0 +1,411 @@
+#pragma once
+
+// Host (Linux) stand-in for HALVOE_SERIAL_TYPE.
+// A HostSerialPipe carries the bytes of one direction of the UART link in process.
+// If throttling is enabled, every byte becomes readable only after its transmission time
+// at the baud rate of the sending side (10 bit per byte: start + 8 data + stop)
+// and bytes, which arrive while the receive FIFO is full, are lost (counted as overrun).
+// Bytes sent at another baud than the receiving side has begun with arrive garbled,
+// above setMaxStableBaud() every g_unstableErrorInterval-th byte has a flipped bit (both counted as corrupted).
+// With a receive ring attached (the stand-in for the DMA channel of the RP2040), the arrived bytes are written into it
+// instead of the receive FIFO, so they are never counted as overrun, but may overwrite unread bytes of the ring
+// (without throttling they only arrive, while there is room in the ring, like the receive FIFO is not limited then).
+
+#include <Arduino.h>
+#include <elapsedMillis.h>
+#include <deque>
+#include <mutex>
+
+namespace halvoeGPU
+{
+  namespace host
+  {
+    constexpr const unsigned long g_bitsPerUARTByte = 10;
+    constexpr const size_t g_defaultReceiveFIFOSize = 32;
+    constexpr const size_t g_defaultTransmitFIFOSize = 32;
+    constexpr const unsigned long g_unstableErrorInterval = 97;
+
+    class HostSerialPipe
+    {
+      private:
+        struct InFlightByte
+        {
+          uint8_t value;
+          unsigned long arrivalMicros;
+          unsigned long baud;
+        };
+
+        std::mutex m_mutex;
+        std::deque<InFlightByte> m_inFlight;
+        std::deque<uint8_t> m_receiveFIFO;
+        size_t m_receiveFIFOSize = g_defaultReceiveFIFOSize;
+        size_t m_transmitFIFOSize = g_defaultTransmitFIFOSize;
+        unsigned long m_baud = 0;
+        unsigned long m_receiveBaud = 0;
+        unsigned long m_maxStableBaud = 0; // 0: stable at every baud
+        bool m_isThrottleEnabled = false;
+        double m_nextFreeMicros = 0;
+        uint8_t* m_receiveRing = nullptr;
+        size_t m_receiveRingLength = 0; // a power of two
+        uint32_t m_receiveRingWrittenCount = 0;
+        uint32_t m_receiveRingReadCount = 0; // as of the last getReceiveRingWrittenCount()
+
+        unsigned long m_writtenCount = 0;
+        unsigned long m_readCount = 0;
+        unsigned long m_overrunCount = 0;
+        unsigned long m_arrivedCount = 0;
+        unsigned long m_corruptedCount = 0;
+
+      private:
+        // must be called with m_mutex locked
+        uint8_t getArrivedValue(const InFlightByte& in_byte)
+        {
+          ++m_arrivedCount;
+
+          if (in_byte.baud != 0 && m_receiveBaud != 0 && in_byte.baud != m_receiveBaud)
+          {
+            ++m_corruptedCount;
+            return in_byte.value ^ 0xA5;
+          }
+
+          if (m_maxStableBaud != 0 && in_byte.baud > m_maxStableBaud && m_arrivedCount % g_unstableErrorInterval == 0)
+          {
+            ++m_corruptedCount;
+            return in_byte.value ^ 0x10;
+          }
+
+          return in_byte.value;
+        }
+
+        // must be called with m_mutex locked
+        void updateArrivals()
+        {
+          unsigned long now = micros();
+
+          while (not m_inFlight.empty() && (not m_isThrottleEnabled || m_inFlight.front().arrivalMicros <= now))
+          {
+            if (m_receiveRing != nullptr && not m_isThrottleEnabled && m_receiveRingWrittenCount - m_receiveRingReadCount >= m_receiveRingLength) { break; }
+
+            if (m_receiveRing != nullptr)
+            {
+              m_receiveRing[m_receiveRingWrittenCount & (m_receiveRingLength - 1)] = getArrivedValue(m_inFlight.front());
+              ++m_receiveRingWrittenCount;
+            }
+            else if (m_isThrottleEnabled && m_receiveFIFO.size() >= m_receiveFIFOSize) { ++m_overrunCount; }
+            else { m_receiveFIFO.push_back(getArrivedValue(m_inFlight.front())); }
+            m_inFlight.pop_front();
+          }
+        }
+
+        double getByteTimeMicros() const
+        {
+          if (m_baud == 0) { return 0; }
+          return static_cast<double>(g_bitsPerUARTByte) * 1000000.0 / m_baud;
+        }
+
+      public:
+        void setBaud(unsigned long in_baud)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_baud = in_baud;
+        }
+
+        // the baud of the receiving side
+        void setReceiveBaud(unsigned long in_baud)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_receiveBaud = in_baud;
+        }
+
+        void setMaxStableBaud(unsigned long in_baud)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_maxStableBaud = in_baud;
+        }
+
+        unsigned long getBaud()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_baud;
+        }
+
+        void setThrottleEnabled(bool in_isEnabled)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_isThrottleEnabled = in_isEnabled;
+        }
+
+        void setReceiveFIFOSize(size_t in_size)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_receiveFIFOSize = in_size;
+        }
+
+        void setTransmitFIFOSize(size_t in_size)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_transmitFIFOSize = in_size;
+        }
+
+        void attachReceiveRing(uint8_t* io_ring, size_t in_length)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_receiveRing = io_ring;
+          m_receiveRingLength = in_length;
+          m_receiveRingWrittenCount = 0;
+          m_receiveRingReadCount = 0;
+        }
+
+        // like the transfer count of a DMA channel, which writes into the receive ring, in_readCount is the one of its consumer
+        uint32_t getReceiveRingWrittenCount(uint32_t in_readCount)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_receiveRingReadCount = in_readCount;
+          updateArrivals();
+          return m_receiveRingWrittenCount;
+        }
+
+        // Bytes, which are accepted but not yet on the wire, occupy the transmit FIFO.
+        size_t getAvailableForWrite()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (not m_isThrottleEnabled) { return m_transmitFIFOSize; }
+
+          double byteTimeMicros = getByteTimeMicros();
+          double queuedMicros = m_nextFreeMicros - static_cast<double>(micros());
+          if (queuedMicros <= 0 || byteTimeMicros <= 0) { return m_transmitFIFOSize; }
+
+          size_t queuedCount = static_cast<size_t>(queuedMicros / byteTimeMicros);
+          return queuedCount >= m_transmitFIFOSize ? 0 : m_transmitFIFOSize - queuedCount;
+        }
+
+        size_t write(const uint8_t* in_buffer, size_t in_size)
+        {
+          for (size_t index = 0; index < in_size; ++index)
+          {
+            while (getAvailableForWrite() == 0) { yield(); } // like a UART, writing blocks while the transmit FIFO is full
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            double now = static_cast<double>(micros());
+            m_nextFreeMicros = (m_nextFreeMicros > now ? m_nextFreeMicros : now) + getByteTimeMicros();
+            m_inFlight.push_back({ in_buffer[index], static_cast<unsigned long>(m_nextFreeMicros), m_baud });
+            ++m_writtenCount;
+          }
+
+          return in_size;
+        }
+
+        size_t getAvailable()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          updateArrivals();
+          return m_receiveFIFO.size();
+        }
+
+        int peek()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          updateArrivals();
+          if (m_receiveFIFO.empty()) { return -1; }
+          return m_receiveFIFO.front();
+        }
+
+        size_t read(uint8_t* out_buffer, size_t in_size)
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          updateArrivals();
+
+          size_t readCount = 0;
+          while (readCount < in_size && not m_receiveFIFO.empty())
+          {
+            out_buffer[readCount++] = m_receiveFIFO.front();
+            m_receiveFIFO.pop_front();
+          }
+
+          m_readCount = m_readCount + readCount;
+          return readCount;
+        }
+
+        // true if no byte is in flight or waiting in the receive FIFO
+        bool isEmpty()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_inFlight.empty() && m_receiveFIFO.empty();
+        }
+
+        unsigned long getWrittenCount()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_writtenCount;
+        }
+
+        unsigned long getReadCount()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_readCount;
+        }
+
+        unsigned long getOverrunCount()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_overrunCount;
+        }
+
+        unsigned long getCorruptedCount()
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          return m_corruptedCount;
+        }
+    };
+
+    // One side of the link: receives from io_receivePipe and transmits into io_transmitPipe.
+    class HostSerial : public Print
+    {
+      private:
+        HostSerialPipe& m_receivePipe;
+        HostSerialPipe& m_transmitPipe;
+        bool m_isBegun = false;
+        unsigned long m_timeoutMillis = 1000;
+
+      public:
+        HostSerial(HostSerialPipe& io_receivePipe, HostSerialPipe& io_transmitPipe) :
+          m_receivePipe(io_receivePipe), m_transmitPipe(io_transmitPipe)
+        {}
+
+        void begin(unsigned long in_baud)
+        {
+          m_transmitPipe.setBaud(in_baud);
+          m_receivePipe.setReceiveBaud(in_baud);
+          m_isBegun = true;
+        }
+
+        void end()
+        {
+          m_isBegun = false;
+        }
+
+        operator bool() const
+        {
+          return m_isBegun;
+        }
+
+        bool setFIFOSize(size_t in_size)
+        {
+          m_receivePipe.setReceiveFIFOSize(in_size);
+          return true;
+        }
+
+        void setTimeout(unsigned long in_timeoutMillis)
+        {
+          m_timeoutMillis = in_timeoutMillis;
+        }
+
+        // see HostSerialPipe
+        void attachReceiveRing(uint8_t* io_ring, size_t in_length)
+        {
+          m_receivePipe.attachReceiveRing(io_ring, in_length);
+        }
+
+        uint32_t getReceiveRingWrittenCount(uint32_t in_readCount)
+        {
+          return m_receivePipe.getReceiveRingWrittenCount(in_readCount);
+        }
+
+        int available()
+        {
+          return static_cast<int>(m_receivePipe.getAvailable());
+        }
+
+        int availableForWrite() override
+        {
+          return static_cast<int>(m_transmitPipe.getAvailableForWrite());
+        }
+
+        int peek()
+        {
+          return m_receivePipe.peek();
+        }
+
+        int read()
+        {
+          uint8_t value = 0;
+          if (m_receivePipe.read(&value, 1) != 1) { return -1; }
+          return value;
+        }
+
+        // like Stream::readBytes(), waits up to the timeout for the requested bytes
+        size_t readBytes(char* out_buffer, size_t in_size)
+        {
+          size_t readCount = 0;
+          elapsedMillis timeSinceBegin;
+
+          while (readCount < in_size)
+          {
+            readCount = readCount + m_receivePipe.read(reinterpret_cast<uint8_t*>(out_buffer) + readCount, in_size - readCount);
+            if (readCount < in_size)
+            {
+              if (timeSinceBegin >= m_timeoutMillis) { break; }
+              yield();
+            }
+          }
+
+          return readCount;
+        }
+
+        size_t readBytes(uint8_t* out_buffer, size_t in_size)
+        {
+          return readBytes(reinterpret_cast<char*>(out_buffer), in_size);
+        }
+
+        size_t write(uint8_t in_byte) override
+        {
+          return m_transmitPipe.write(&in_byte, 1);
+        }
+
+        size_t write(const uint8_t* in_buffer, size_t in_size) override
+        {
+          return m_transmitPipe.write(in_buffer, in_size);
+        }
+
+        using Print::write;
+
+        void flush()
+        {
+          while (m_transmitPipe.getAvailableForWrite() == 0) { yield(); }
+        }
+    };
+
+    // Both directions of a CPU <-> GPU UART link.
+    class HostSerialLink
+    {
+      private:
+        HostSerialPipe m_cpuToGPU;
+        HostSerialPipe m_gpuToCPU;
+        HostSerial m_cpuSerial;
+        HostSerial m_gpuSerial;
+
+      public:
+        HostSerialLink() :
+          m_cpuSerial(m_gpuToCPU, m_cpuToGPU), m_gpuSerial(m_cpuToGPU, m_gpuToCPU)
+        {}
+
+        HostSerial& getCPUSerial() { return m_cpuSerial; }
+        HostSerial& getGPUSerial() { return m_gpuSerial; }
+        HostSerialPipe& getCPUToGPUPipe() { return m_cpuToGPU; }
+        HostSerialPipe& getGPUToCPUPipe() { return m_gpuToCPU; }
+
+        void setThrottleEnabled(bool in_isEnabled)
+        {
+          m_cpuToGPU.setThrottleEnabled(in_isEnabled);
+          m_gpuToCPU.setThrottleEnabled(in_isEnabled);
+        }
+
+        // simulates a cable, which is not stable above in_baud
+        void setMaxStableBaud(unsigned long in_baud)
+        {
+          m_cpuToGPU.setMaxStableBaud(in_baud);
+          m_gpuToCPU.setMaxStableBaud(in_baud);
+        }
+    };
+  }
+}
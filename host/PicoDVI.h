@@ -0,0 +1,138 @@
+#pragma once
+
+// Host (Linux) stand-in for PicoDVI's DVIGFX8: a double-buffered 8-bit paletted software framebuffer.
+// Instead of a DVI output it can dump the displayed (front) buffer to a PPM image.
+
+#include <Adafruit_GFX.h>
+#include <Arduino.h>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+enum DVIresolution
+{
+  DVI_RES_320x240p60 = 0
+};
+
+struct dvi_serialiser_cfg
+{};
+
+inline constexpr dvi_serialiser_cfg adafruit_feather_dvi_cfg{};
+inline constexpr dvi_serialiser_cfg pimoroni_demo_hdmi_cfg{};
+inline constexpr dvi_serialiser_cfg pico_sock_cfg{};
+
+class DVIGFX8 : public GFXcanvas8
+{
+  private:
+    static constexpr const uint16_t m_width = 320;
+    static constexpr const uint16_t m_height = 240;
+    static constexpr const size_t m_paletteSize = 256;
+    static constexpr const unsigned long m_framePeriodMicros = 16667; // 60 Hz
+
+    bool m_isDoubleBuffered;
+    uint8_t* m_frontBuffer = nullptr;
+    std::array<uint16_t, m_paletteSize> m_palette{};
+    std::array<uint16_t, m_paletteSize> m_frontPalette{};
+    unsigned long m_swapCount = 0;
+    bool m_isVBlankWaitEnabled = false;
+
+  public:
+    DVIGFX8(DVIresolution in_resolution = DVI_RES_320x240p60, bool in_isDoubleBuffered = false,
+            const dvi_serialiser_cfg& in_config = pico_sock_cfg) :
+      GFXcanvas8(m_width, m_height), m_isDoubleBuffered(in_isDoubleBuffered)
+    {}
+
+    ~DVIGFX8()
+    {
+      std::free(m_frontBuffer);
+    }
+
+    bool begin()
+    {
+      if (getBuffer() == nullptr) { return false; }
+      if (not m_isDoubleBuffered) { m_frontBuffer = nullptr; return true; }
+      if (m_frontBuffer == nullptr) { m_frontBuffer = static_cast<uint8_t*>(std::calloc(m_width * m_height, 1)); }
+      return m_frontBuffer != nullptr;
+    }
+
+    void setColor(uint8_t in_index, uint16_t in_color)
+    {
+      m_palette[in_index] = in_color;
+    }
+
+    void setColor(uint8_t in_index, uint8_t in_red, uint8_t in_green, uint8_t in_blue)
+    {
+      m_palette[in_index] = ((in_red & 0xF8) << 8) | ((in_green & 0xFC) << 3) | (in_blue >> 3);
+    }
+
+    uint16_t getColor(uint8_t in_index) const
+    {
+      return m_palette[in_index];
+    }
+
+    uint16_t* getPalette()
+    {
+      return m_palette.data();
+    }
+
+    // PicoDVI swaps at the next vertical blank and waits for it. The host only does, if this is enabled,
+    // otherwise it swaps immediately (so tests, which do not care about the timing, run fast).
+    void setVBlankWaitEnabled(bool in_isEnabled)
+    {
+      m_isVBlankWaitEnabled = in_isEnabled;
+    }
+
+    // Like PicoDVI, the new back buffer keeps its old content, unless in_copyFramebuffer is set.
+    void swap(bool in_copyFramebuffer = false, bool in_copyPalette = false)
+    {
+      if (m_isVBlankWaitEnabled) { delayMicroseconds(m_framePeriodMicros - micros() % m_framePeriodMicros); }
+      ++m_swapCount;
+      if (not m_isDoubleBuffered) { m_frontPalette = m_palette; return; }
+
+      std::swap(buffer, m_frontBuffer);
+      std::swap(m_palette, m_frontPalette);
+      if (in_copyFramebuffer) { std::memcpy(buffer, m_frontBuffer, m_width * m_height); }
+      if (in_copyPalette) { m_palette = m_frontPalette; }
+    }
+
+    // the buffer that PicoDVI would currently scan out
+    const uint8_t* getFrontBuffer() const
+    {
+      return m_isDoubleBuffered ? m_frontBuffer : getBuffer();
+    }
+
+    const uint16_t* getFrontPalette() const
+    {
+      return m_frontPalette.data();
+    }
+
+    unsigned long getSwapCount() const
+    {
+      return m_swapCount;
+    }
+
+    bool writePPM(const char* in_path) const
+    {
+      const uint8_t* frontBuffer = getFrontBuffer();
+      if (frontBuffer == nullptr) { return false; }
+
+      std::FILE* file = std::fopen(in_path, "wb");
+      if (file == nullptr) { return false; }
+
+      std::fprintf(file, "P6\n%u %u\n255\n", m_width, m_height);
+      for (size_t index = 0; index < static_cast<size_t>(m_width) * m_height; ++index)
+      {
+        uint16_t color = m_frontPalette[frontBuffer[index]];
+        uint8_t red = (color >> 11) & 0x1F;
+        uint8_t green = (color >> 5) & 0x3F;
+        uint8_t blue = color & 0x1F;
+        uint8_t pixel[3] = { static_cast<uint8_t>((red << 3) | (red >> 2)),
+                             static_cast<uint8_t>((green << 2) | (green >> 4)),
+                             static_cast<uint8_t>((blue << 3) | (blue >> 2)) };
+        std::fwrite(pixel, 1, sizeof(pixel), file);
+      }
+
+      return std::fclose(file) == 0;
+    }
+};
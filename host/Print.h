@@ -0,0 +1,75 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino Print class (only what halvoeGPU and Adafruit_GFX use).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "WString.h"
+
+class Print
+{
+  private:
+    size_t printNumber(unsigned long in_value, bool in_isNegative)
+    {
+      char buffer[24];
+      char* digit = buffer + sizeof(buffer) - 1;
+      *digit = '\0';
+
+      do
+      {
+        *--digit = static_cast<char>('0' + in_value % 10);
+        in_value = in_value / 10;
+      }
+      while (in_value > 0);
+
+      if (in_isNegative) { *--digit = '-'; }
+      return write(digit);
+    }
+
+  public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t in_byte) = 0;
+
+    virtual size_t write(const uint8_t* in_buffer, size_t in_size)
+    {
+      size_t writtenCount = 0;
+      while (in_size-- > 0) { writtenCount = writtenCount + write(*in_buffer++); }
+      return writtenCount;
+    }
+
+    size_t write(const char* in_buffer, size_t in_size)
+    {
+      return write(reinterpret_cast<const uint8_t*>(in_buffer), in_size);
+    }
+
+    size_t write(const char* in_string)
+    {
+      if (in_string == nullptr) { return 0; }
+      return write(in_string, std::strlen(in_string));
+    }
+
+    virtual int availableForWrite()
+    {
+      return 0;
+    }
+
+    size_t print(const char* in_string) { return write(in_string); }
+    size_t print(const String& in_string) { return write(in_string.c_str()); }
+    size_t print(char in_value) { return write(static_cast<uint8_t>(in_value)); }
+    size_t print(int in_value) { return print(static_cast<long>(in_value)); }
+    size_t print(unsigned int in_value) { return print(static_cast<unsigned long>(in_value)); }
+    size_t print(long in_value) { return in_value < 0 ? printNumber(0UL - static_cast<unsigned long>(in_value), true) : printNumber(in_value, false); }
+    size_t print(unsigned long in_value) { return printNumber(in_value, false); }
+
+    size_t println() { return write("\r\n"); }
+
+    template<typename ValueType>
+    size_t println(const ValueType& in_value)
+    {
+      size_t writtenCount = print(in_value);
+      return writtenCount + println();
+    }
+};
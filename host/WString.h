@@ -0,0 +1,91 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino String class (only what halvoeGPU uses).
+
+#include <cstring>
+#include <string>
+
+class String
+{
+  private:
+    std::string m_string;
+
+  public:
+    String(const char* in_string = "") : m_string(in_string != nullptr ? in_string : "")
+    {}
+
+    String(const std::string& in_string) : m_string(in_string)
+    {}
+
+    explicit String(char in_value) : m_string(1, in_value)
+    {}
+
+    explicit String(int in_value) : m_string(std::to_string(in_value))
+    {}
+
+    explicit String(unsigned int in_value) : m_string(std::to_string(in_value))
+    {}
+
+    explicit String(long in_value) : m_string(std::to_string(in_value))
+    {}
+
+    explicit String(unsigned long in_value) : m_string(std::to_string(in_value))
+    {}
+
+    unsigned int length() const
+    {
+      return static_cast<unsigned int>(m_string.length());
+    }
+
+    const char* c_str() const
+    {
+      return m_string.c_str();
+    }
+
+    bool concat(const String& in_string)
+    {
+      m_string.append(in_string.m_string);
+      return true;
+    }
+
+    bool concat(const char* in_string)
+    {
+      if (in_string == nullptr) { return false; }
+      m_string.append(in_string);
+      return true;
+    }
+
+    void toCharArray(char* out_buffer, unsigned int in_bufferSize, unsigned int in_index = 0) const
+    {
+      if (out_buffer == nullptr || in_bufferSize == 0) { return; }
+      if (in_index >= m_string.length()) { out_buffer[0] = '\0'; return; }
+      size_t copyLength = std::min<size_t>(in_bufferSize - 1, m_string.length() - in_index);
+      std::memcpy(out_buffer, m_string.data() + in_index, copyLength);
+      out_buffer[copyLength] = '\0';
+    }
+
+    char operator[](unsigned int in_index) const
+    {
+      return in_index < m_string.length() ? m_string[in_index] : '\0';
+    }
+
+    bool operator==(const String& in_string) const
+    {
+      return m_string == in_string.m_string;
+    }
+
+    friend String operator+(const String& in_left, const String& in_right)
+    {
+      return String(in_left.m_string + in_right.m_string);
+    }
+
+    friend String operator+(const String& in_left, const char* in_right)
+    {
+      return String(in_left.m_string + in_right);
+    }
+
+    friend String operator+(const char* in_left, const String& in_right)
+    {
+      return String(in_left + in_right.m_string);
+    }
+};
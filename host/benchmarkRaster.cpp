@@ -0,0 +1,177 @@
+// Micro-benchmark of the span fill kernels (halvoeRaster.hpp) against the Adafruit_GFX versions they replace.
+// "panels" draws a frame of overlapping panels through the deferred rasterizer (halvoeTileBinner.hpp) instead.
+//
+// Both draw the same calls into their own DVIGFX8, the results are compared afterwards.
+// It reports the time per call, the fill rate and the speedup of the kernels.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/benchmarkRaster.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o benchmarkRaster
+// Usage: ./benchmarkRaster [--json] [iterations]
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../halvoeRaster.hpp"
+#include "../halvoeTileBinner.hpp"
+
+namespace
+{
+  using namespace halvoeGPU;
+
+  struct RasterBenchmark
+  {
+    std::string name;
+    size_t pixelsPerCall; // the pixels, which are (at most) changed by one call
+    std::function<void(DVIGFX8&, size_t)> drawAdafruit;
+    std::function<void(uint8_t*, size_t)> drawKernel;
+    double adafruitMicrosPerCall = 0;
+    double kernelMicrosPerCall = 0;
+    bool isIdentical = false;
+  };
+
+  double getMicrosSince(std::chrono::steady_clock::time_point in_begin)
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - in_begin).count();
+  }
+
+  // the position moves with the call, so the spans start at every alignment
+  int16_t getOffset(size_t in_call)
+  {
+    return static_cast<int16_t>(in_call % 7);
+  }
+
+  std::vector<RasterBenchmark> createBenchmarks()
+  {
+    std::vector<RasterBenchmark> benchmarks;
+
+    benchmarks.push_back({ "fillScreen", g_screenWidth * g_screenHeight,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.fillScreen(in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::fillScreen(io_framebuffer, in_call & 0xFF); } });
+    benchmarks.push_back({ "fillRectPanel300x200", 300 * 200,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.fillRect(getOffset(in_call), getOffset(in_call), 300, 200, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::fillRect(io_framebuffer, getOffset(in_call), getOffset(in_call), 300, 200, in_call & 0xFF); } });
+    benchmarks.push_back({ "fillRectPanel75x75", 75 * 75,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.fillRect(4 + getOffset(in_call), 4, 75, 75, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::fillRect(io_framebuffer, 4 + getOffset(in_call), 4, 75, 75, in_call & 0xFF); } });
+    benchmarks.push_back({ "fillRectSmall8x8", 8 * 8,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.fillRect(getOffset(in_call), 8, 8, 8, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::fillRect(io_framebuffer, getOffset(in_call), 8, 8, 8, in_call & 0xFF); } });
+    benchmarks.push_back({ "fillRectClipped", 100 * 100,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.fillRect(270 - getOffset(in_call), -50, 100, 100, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::fillRect(io_framebuffer, 270 - getOffset(in_call), -50, 100, 100, in_call & 0xFF); } });
+    benchmarks.push_back({ "drawRect75x75", 4 * 75,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.drawRect(4 + getOffset(in_call), 4, 75, 75, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::drawRect(io_framebuffer, 4 + getOffset(in_call), 4, 75, 75, in_call & 0xFF); } });
+    benchmarks.push_back({ "drawHLine200", 200,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.drawFastHLine(getOffset(in_call), in_call % g_screenHeight, 200, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::drawHLine(io_framebuffer, getOffset(in_call), in_call % g_screenHeight, 200, in_call & 0xFF); } });
+    benchmarks.push_back({ "drawVLine200", 200,
+      [](DVIGFX8& io_dviGFX, size_t in_call) { io_dviGFX.drawFastVLine(in_call % g_screenWidth, getOffset(in_call), 200, in_call & 0xFF); },
+      [](uint8_t* io_framebuffer, size_t in_call) { atGPU::drawVLine(io_framebuffer, in_call % g_screenWidth, getOffset(in_call), 200, in_call & 0xFF); } });
+
+    // a cleared screen with overlapping panels and their frames, one frame per call
+    static atGPU::TileBinner tileBinner;
+    benchmarks.push_back({ "panels", g_screenWidth * g_screenHeight,
+      [](DVIGFX8& io_dviGFX, size_t in_call)
+      {
+        io_dviGFX.fillScreen(in_call & 0xFF);
+        for (int16_t panel = 0; panel < 8; ++panel)
+        {
+          io_dviGFX.fillRect(getOffset(in_call) + panel * 24, panel * 16, 160, 100, panel);
+          io_dviGFX.drawRect(getOffset(in_call) + panel * 24, panel * 16, 160, 100, 255);
+        }
+      },
+      [](uint8_t* io_framebuffer, size_t in_call)
+      {
+        tileBinner.fillScreen(io_framebuffer, in_call & 0xFF);
+        for (int16_t panel = 0; panel < 8; ++panel)
+        {
+          tileBinner.fillRect(io_framebuffer, getOffset(in_call) + panel * 24, panel * 16, 160, 100, panel);
+          tileBinner.drawRect(io_framebuffer, getOffset(in_call) + panel * 24, panel * 16, 160, 100, 255);
+        }
+
+        tileBinner.render(io_framebuffer);
+      } });
+
+    return benchmarks;
+  }
+
+  void measure(RasterBenchmark& io_benchmark, size_t in_iterations)
+  {
+    DVIGFX8 adafruitGFX(DVI_RES_320x240p60, false, adafruit_feather_dvi_cfg);
+    DVIGFX8 kernelGFX(DVI_RES_320x240p60, false, adafruit_feather_dvi_cfg);
+    adafruitGFX.begin();
+    kernelGFX.begin();
+    uint8_t* kernelFramebuffer = kernelGFX.getBuffer();
+
+    auto adafruitBegin = std::chrono::steady_clock::now();
+    for (size_t call = 0; call < in_iterations; ++call) { io_benchmark.drawAdafruit(adafruitGFX, call); }
+    io_benchmark.adafruitMicrosPerCall = getMicrosSince(adafruitBegin) / in_iterations;
+
+    auto kernelBegin = std::chrono::steady_clock::now();
+    for (size_t call = 0; call < in_iterations; ++call) { io_benchmark.drawKernel(kernelFramebuffer, call); }
+    io_benchmark.kernelMicrosPerCall = getMicrosSince(kernelBegin) / in_iterations;
+
+    io_benchmark.isIdentical = std::memcmp(adafruitGFX.getBuffer(), kernelFramebuffer, g_screenWidth * g_screenHeight) == 0;
+  }
+
+  void printResults(const std::vector<RasterBenchmark>& in_benchmarks, bool in_isJSON)
+  {
+    if (in_isJSON) { std::printf("[\n"); }
+    else { std::printf("name,pixels_per_call,adafruit_us,kernel_us,adafruit_mpixel_per_s,kernel_mpixel_per_s,speedup,identical\n"); }
+
+    bool isFirst = true;
+    for (const RasterBenchmark& benchmark : in_benchmarks)
+    {
+      double adafruitRate = benchmark.pixelsPerCall / benchmark.adafruitMicrosPerCall;
+      double kernelRate = benchmark.pixelsPerCall / benchmark.kernelMicrosPerCall;
+      double speedup = benchmark.adafruitMicrosPerCall / benchmark.kernelMicrosPerCall;
+
+      if (in_isJSON)
+      {
+        std::printf("%s  {\"name\": \"%s\", \"pixels_per_call\": %zu, \"adafruit_us\": %.3f, \"kernel_us\": %.3f, \"adafruit_mpixel_per_s\": %.1f, "
+                    "\"kernel_mpixel_per_s\": %.1f, \"speedup\": %.2f, \"identical\": %s}",
+                    isFirst ? "" : ",\n", benchmark.name.c_str(), benchmark.pixelsPerCall, benchmark.adafruitMicrosPerCall, benchmark.kernelMicrosPerCall,
+                    adafruitRate, kernelRate, speedup, benchmark.isIdentical ? "true" : "false");
+      }
+      else
+      {
+        std::printf("%s,%zu,%.3f,%.3f,%.1f,%.1f,%.2f,%s\n", benchmark.name.c_str(), benchmark.pixelsPerCall, benchmark.adafruitMicrosPerCall,
+                    benchmark.kernelMicrosPerCall, adafruitRate, kernelRate, speedup, benchmark.isIdentical ? "yes" : "no");
+      }
+
+      isFirst = false;
+    }
+
+    if (in_isJSON) { std::printf("\n]\n"); }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bool isJSON = false;
+  size_t iterations = 2000;
+
+  for (int index = 1; index < argc; ++index)
+  {
+    if (std::strcmp(argv[index], "--json") == 0) { isJSON = true; }
+    else { iterations = max(std::strtoul(argv[index], nullptr, 10), 1ul); }
+  }
+
+  std::vector<RasterBenchmark> benchmarks = createBenchmarks();
+  bool isIdentical = true;
+  for (RasterBenchmark& benchmark : benchmarks)
+  {
+    measure(benchmark, max(iterations / 10, static_cast<size_t>(1))); // warm up
+    measure(benchmark, iterations);
+    isIdentical = isIdentical && benchmark.isIdentical;
+  }
+
+  printResults(benchmarks, isJSON);
+  return isIdentical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,425 @@
+// Protocol throughput benchmark: atCPU::SerialGFXInterface -> simulated link -> atGPU::SerialGFXInterface.
+//
+// For every SerialGFXCommandCode and for representative scenes it measures on the host (in every SerialGFXProtocol)
+// the bytes on the wire, the encode time (atCPU) and the decode+execute time (atGPU).
+// The text state and the cursor are only sent with the next text, so each of them is measured with a print,
+// of which the cost (measured alone) is subtracted.
+// For every SerialGFXBaud from Min to Max it then reports the rate the link allows,
+// the rate the GPU allows and which of both is the bottleneck.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/benchmarkThroughput.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o benchmarkThroughput
+// Usage: ./benchmarkThroughput [--json] [iterations]
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../SerialGFXInterface_atCPU.hpp"
+#include "../SerialGFXInterface_atGPU.hpp"
+
+namespace
+{
+  using namespace halvoeGPU;
+
+  constexpr const SerialGFXBaud g_benchmarkBauds[] = {
+    SerialGFXBaud::Min, SerialGFXBaud::Quarter, SerialGFXBaud::Half, SerialGFXBaud::Default,
+    SerialGFXBaud::Double, SerialGFXBaud::Quad, SerialGFXBaud::Max
+  };
+
+  struct Measurement
+  {
+    double bytesPerUnit = 0;
+    double encodeMicrosPerUnit = 0;
+    double executeMicrosPerUnit = 0;
+  };
+
+  struct Benchmark
+  {
+    SerialGFXProtocol protocol;
+    std::string kind;
+    std::string name;
+    size_t unitsPerIteration; // commands per call of send (or 1 frame for scenes)
+    std::function<void(atCPU::SerialGFXInterface&, size_t)> send;
+    Measurement measurement;
+    bool isRetained = false; // measured in the retained mode of atCPU::SerialGFXInterface
+    bool isGlyphAtlasDisabled = false; // the GPU draws text with Adafruit_GFX::drawChar() instead of its glyph atlas
+    std::function<void(atCPU::SerialGFXInterface&, size_t)> sendBaseline = nullptr; // measured alone, its cost is subtracted
+  };
+
+  double getMicrosSince(std::chrono::steady_clock::time_point in_begin)
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - in_begin).count();
+  }
+
+  class BenchmarkRig
+  {
+    private:
+      host::HostSerialLink m_link;
+      DVIGFX8 m_dviGFX;
+      atGPU::SerialGFXInterface m_gpu;
+      atCPU::SerialGFXInterface m_cpu;
+
+    public:
+      BenchmarkRig() :
+        m_dviGFX(DVI_RES_320x240p60, true, adafruit_feather_dvi_cfg),
+        m_gpu(m_link.getGPUSerial(), m_dviGFX), m_cpu(m_link.getCPUSerial())
+      {}
+
+      bool begin()
+      {
+        m_link.setThrottleEnabled(false); // the link is modelled analytically, see printResults()
+        return m_gpu.begin() && m_cpu.begin();
+      }
+
+      void drainGPU()
+      {
+        while (not m_link.getCPUToGPUPipe().isEmpty() || m_gpu.receiveCommand())
+        {
+          if (m_gpu.receiveCommand()) { m_gpu.runCommand(); }
+        }
+      }
+
+      bool setProtocol(SerialGFXProtocol in_protocol)
+      {
+        if (not m_cpu.sendSetProtocol(in_protocol)) { return false; }
+        drainGPU();
+        return true;
+      }
+
+      // without the cost of io_benchmark.sendBaseline (if any)
+      Measurement measureAgainstBaseline(Benchmark& io_benchmark, size_t in_iterations)
+      {
+        Measurement measurement = measure(io_benchmark, in_iterations);
+        if (not io_benchmark.sendBaseline) { return measurement; }
+
+        Benchmark baseline = io_benchmark;
+        baseline.send = io_benchmark.sendBaseline;
+        Measurement baselineMeasurement = measure(baseline, in_iterations);
+        measurement.bytesPerUnit = measurement.bytesPerUnit - baselineMeasurement.bytesPerUnit;
+        measurement.encodeMicrosPerUnit = max(measurement.encodeMicrosPerUnit - baselineMeasurement.encodeMicrosPerUnit, 0.0);
+        measurement.executeMicrosPerUnit = max(measurement.executeMicrosPerUnit - baselineMeasurement.executeMicrosPerUnit, 0.0);
+        return measurement;
+      }
+
+      Measurement measure(Benchmark& io_benchmark, size_t in_iterations)
+      {
+        unsigned long writtenCountBefore = m_link.getCPUToGPUPipe().getWrittenCount();
+
+        auto encodeBegin = std::chrono::steady_clock::now();
+        if (io_benchmark.isRetained) { m_cpu.enableRetainedMode(); } // the first frame is sent completely
+        for (size_t iteration = 0; iteration < in_iterations; ++iteration) { io_benchmark.send(m_cpu, iteration); }
+        if (io_benchmark.isRetained) { m_cpu.disableRetainedMode(); }
+        double encodeMicros = getMicrosSince(encodeBegin);
+
+        unsigned long writtenCount = m_link.getCPUToGPUPipe().getWrittenCount() - writtenCountBefore;
+
+        auto executeBegin = std::chrono::steady_clock::now();
+        m_gpu.setGlyphAtlasEnabled(not io_benchmark.isGlyphAtlasDisabled);
+        drainGPU();
+        m_gpu.setGlyphAtlasEnabled(true);
+        double executeMicros = getMicrosSince(executeBegin);
+
+        double unitCount = static_cast<double>(in_iterations * io_benchmark.unitsPerIteration);
+        Measurement measurement;
+        measurement.bytesPerUnit = writtenCount / unitCount;
+        measurement.encodeMicrosPerUnit = encodeMicros / unitCount;
+        measurement.executeMicrosPerUnit = executeMicros / unitCount;
+        return measurement;
+      }
+  };
+
+  const char* g_consoleLine = "The quick brown fox jumps over the lazy dog. 0123456";
+
+  void sendTextConsoleFrame(atCPU::SerialGFXInterface& io_cpu)
+  {
+    io_cpu.sendFillScreen(0);
+    io_cpu.sendSetTextColor(255);
+    for (int16_t line = 0; line < 30; ++line)
+    {
+      io_cpu.sendSetCursor(0, line * 8);
+      io_cpu.sendPrint(g_consoleLine);
+    }
+    io_cpu.sendSwap();
+  }
+
+  // only the first in_changingPanelCount gauges change their value from frame to frame
+  void sendDashboardFrame(atCPU::SerialGFXInterface& io_cpu, size_t in_frame, int16_t in_changingPanelCount = 12)
+  {
+    io_cpu.sendFillScreen(8);
+    for (int16_t panel = 0; panel < 12; ++panel)
+    {
+      int16_t x = 4 + (panel % 4) * 79;
+      int16_t y = 4 + (panel / 4) * 79;
+      size_t value = panel < in_changingPanelCount ? in_frame + panel : panel;
+      io_cpu.sendFillRect(x, y, 75, 75, 40);
+      io_cpu.sendDrawRect(x, y, 75, 75, 200);
+      io_cpu.sendFillRect(x + 4, y + 60, static_cast<int16_t>((value * 7 + panel * 5) % 67), 8, 120);
+      io_cpu.sendSetCursor(x + 4, y + 4);
+      io_cpu.sendPrint("Gauge");
+      io_cpu.sendSetCursor(x + 4, y + 20);
+      io_cpu.sendPrint(String(static_cast<unsigned long>(value)));
+    }
+    io_cpu.sendSwap();
+  }
+
+  constexpr const int16_t g_iconSize = 64;
+
+  // an icon like image: a flat background, a shaded disc and a border
+  const std::vector<uint8_t>& getIconPixels()
+  {
+    static std::vector<uint8_t> pixels;
+    if (not pixels.empty()) { return pixels; }
+
+    for (int16_t y = 0; y < g_iconSize; ++y)
+    {
+      for (int16_t x = 0; x < g_iconSize; ++x)
+      {
+        int32_t dx = x - g_iconSize / 2;
+        int32_t dy = y - g_iconSize / 2;
+        int32_t distanceSquared = dx * dx + dy * dy;
+        if (x == 0 || y == 0 || x == g_iconSize - 1 || y == g_iconSize - 1) { pixels.push_back(255); }
+        else if (distanceSquared < 26 * 26) { pixels.push_back(static_cast<uint8_t>(64 + distanceSquared / 8)); }
+        else { pixels.push_back(16); }
+      }
+    }
+
+    return pixels;
+  }
+
+  // draws the icon without blit, one fillRect per horizontal run of equal pixels
+  void sendIconAsFillRects(atCPU::SerialGFXInterface& io_cpu, int16_t in_x, int16_t in_y)
+  {
+    const std::vector<uint8_t>& pixels = getIconPixels();
+    for (int16_t y = 0; y < g_iconSize; ++y)
+    {
+      int16_t runBegin = 0;
+      for (int16_t x = 1; x <= g_iconSize; ++x)
+      {
+        if (x < g_iconSize && pixels[y * g_iconSize + x] == pixels[y * g_iconSize + runBegin]) { continue; }
+        io_cpu.sendFillRect(in_x + runBegin, in_y + y, x - runBegin, 1, pixels[y * g_iconSize + runBegin]);
+        runBegin = x;
+      }
+    }
+  }
+
+  // one line of g_consoleLine, the units of the benchmark are the glyphs
+  void sendGlyphLine(atCPU::SerialGFXInterface& io_cpu, SerialGFXFont in_font, uint8_t in_size)
+  {
+    io_cpu.sendSetFont(in_font);
+    io_cpu.sendSetTextSize(in_size);
+    io_cpu.sendSetTextColor(255);
+    io_cpu.sendSetCursor(0, 40);
+    io_cpu.sendPrint(g_consoleLine);
+  }
+
+  // the text, with which the text state and the cursor are sent
+  void sendStateText(atCPU::SerialGFXInterface& io_cpu, size_t)
+  {
+    io_cpu.sendPrint("Hello, World!");
+  }
+
+  const char* getProtocolName(SerialGFXProtocol in_protocol)
+  {
+    return in_protocol == SerialGFXProtocol::compact ? "compact" : "v1";
+  }
+
+  std::vector<Benchmark> createBenchmarks(SerialGFXProtocol in_protocol)
+  {
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back({ in_protocol, "command", "swap", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t) { io_cpu.sendSwap(); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "fillScreen", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index) { io_cpu.sendFillScreen(in_index & 0xFF); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "fillRect", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index) { io_cpu.sendFillRect(in_index % 280, in_index % 200, 40, 40, in_index & 0xFF); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "drawRect", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index) { io_cpu.sendDrawRect(in_index % 280, in_index % 200, 40, 40, in_index & 0xFF); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "setFont", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendSetFont(in_index & 1 ? SerialGFXFont::Picopixel : SerialGFXFont::Default); sendStateText(io_cpu, in_index);
+    }, {}, false, false, sendStateText });
+    benchmarks.push_back({ in_protocol, "command", "setTextSize", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendSetTextSize(1 + (in_index & 1)); sendStateText(io_cpu, in_index);
+    }, {}, false, false, sendStateText });
+    benchmarks.push_back({ in_protocol, "command", "setTextColor", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendSetTextColor(in_index & 0xFF); sendStateText(io_cpu, in_index);
+    }, {}, false, false, sendStateText });
+    benchmarks.push_back({ in_protocol, "command", "setCursor", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendSetCursor(in_index % 300, in_index % 230); sendStateText(io_cpu, in_index);
+    }, {}, false, false, sendStateText });
+    benchmarks.push_back({ in_protocol, "command", "print", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t) { io_cpu.sendSetCursor(0, 0); io_cpu.sendPrint("Hello, World!"); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "println", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t) { io_cpu.sendSetCursor(0, 0); io_cpu.sendPrintln("Hello, World!"); }, {} });
+    benchmarks.push_back({ in_protocol, "command", "batch", 64, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.beginBatch();
+      for (int16_t index = 0; index < 64; ++index) { io_cpu.sendFillRect(index * 4, index * 3, 40, 40, (in_index + index) & 0xFF); }
+      io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "command", "blitRaw", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendBlit(in_index % 256, in_index % 176, g_iconSize, g_iconSize, getIconPixels().data(), SerialGFXBlitCodec::raw);
+    }, {} });
+    benchmarks.push_back({ in_protocol, "command", "blitRLE", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendBlit(in_index % 256, in_index % 176, g_iconSize, g_iconSize, getIconPixels().data(), SerialGFXBlitCodec::rle);
+    }, {} });
+    benchmarks.push_back({ in_protocol, "command", "blitLZ", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendBlit(in_index % 256, in_index % 176, g_iconSize, g_iconSize, getIconPixels().data(), SerialGFXBlitCodec::lz);
+    }, {} });
+    benchmarks.push_back({ in_protocol, "command", "blitBestCodec", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_index)
+    {
+      io_cpu.sendBlit(in_index % 256, in_index % 176, g_iconSize, g_iconSize, getIconPixels().data());
+    }, {} });
+
+    // glyphs drawn by the glyph atlas and (for comparison) by Adafruit_GFX, the scenes after them use the default font
+    const size_t glyphCount = std::strlen(g_consoleLine);
+    for (bool isGlyphAtlasDisabled : { false, true })
+    {
+      std::string suffix = isGlyphAtlasDisabled ? "AdafruitGFX" : "";
+      benchmarks.push_back({ in_protocol, "glyphs", "picopixel" + suffix, glyphCount, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+      {
+        sendGlyphLine(io_cpu, SerialGFXFont::Picopixel, 1);
+      }, {}, false, isGlyphAtlasDisabled });
+      benchmarks.push_back({ in_protocol, "glyphs", "defaultSize2" + suffix, glyphCount, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+      {
+        sendGlyphLine(io_cpu, SerialGFXFont::Default, 2);
+      }, {}, false, isGlyphAtlasDisabled });
+      benchmarks.push_back({ in_protocol, "glyphs", "default" + suffix, glyphCount, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+      {
+        sendGlyphLine(io_cpu, SerialGFXFont::Default, 1);
+      }, {}, false, isGlyphAtlasDisabled });
+    }
+
+    benchmarks.push_back({ in_protocol, "scene", "textConsole", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t) { sendTextConsoleFrame(io_cpu); }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "textConsoleBatched", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+    {
+      io_cpu.beginBatch(); sendTextConsoleFrame(io_cpu); io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "dashboard", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame) { sendDashboardFrame(io_cpu, in_frame); }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "dashboardBatched", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame)
+    {
+      io_cpu.beginBatch(); sendDashboardFrame(io_cpu, in_frame); io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "dashboardRetained", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame)
+    {
+      sendDashboardFrame(io_cpu, in_frame);
+    }, {}, true });
+    benchmarks.push_back({ in_protocol, "scene", "dashboardOneGauge", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame)
+    {
+      sendDashboardFrame(io_cpu, in_frame, 1);
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "dashboardOneGaugeRetained", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame)
+    {
+      sendDashboardFrame(io_cpu, in_frame, 1);
+    }, {}, true });
+    benchmarks.push_back({ in_protocol, "scene", "iconsAsFillRects", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+    {
+      io_cpu.beginBatch();
+      for (int16_t icon = 0; icon < 4; ++icon) { sendIconAsFillRects(io_cpu, 8 + icon * 76, 88); }
+      io_cpu.sendSwap();
+      io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "iconsAsBlits", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+    {
+      io_cpu.beginBatch();
+      for (int16_t icon = 0; icon < 4; ++icon) { io_cpu.sendBlit(8 + icon * 76, 88, g_iconSize, g_iconSize, getIconPixels().data()); }
+      io_cpu.sendSwap();
+      io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "iconsAsSprites", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t)
+    {
+      io_cpu.beginBatch();
+      for (int16_t icon = 0; icon < 4; ++icon) { io_cpu.sendSprite(icon, 8 + icon * 76, 88, g_iconSize, g_iconSize, getIconPixels().data(), 16); }
+      io_cpu.sendSwap();
+      io_cpu.endBatch();
+    }, {} });
+    benchmarks.push_back({ in_protocol, "scene", "fillScreenSwap", 1, [](atCPU::SerialGFXInterface& io_cpu, size_t in_frame)
+    {
+      io_cpu.sendFillScreen(in_frame & 0xFF); io_cpu.sendSwap();
+    }, {} });
+
+    return benchmarks;
+  }
+
+  void printResults(const std::vector<Benchmark>& in_benchmarks, bool in_isJSON)
+  {
+    if (in_isJSON) { std::printf("[\n"); }
+    else { std::printf("protocol,kind,name,baud,bytes_per_unit,encode_us,execute_us,link_per_s,gpu_per_s,achieved_per_s,bottleneck\n"); }
+
+    bool isFirst = true;
+    for (const Benchmark& benchmark : in_benchmarks)
+    {
+      for (SerialGFXBaud baud : g_benchmarkBauds)
+      {
+        const Measurement& measurement = benchmark.measurement;
+        double bytesPerSecond = static_cast<double>(fromSerialGFXBaud(baud)) / host::g_bitsPerUARTByte;
+        double linkPerSecond = bytesPerSecond / measurement.bytesPerUnit;
+        double gpuPerSecond = measurement.executeMicrosPerUnit > 0 ? 1000000.0 / measurement.executeMicrosPerUnit : 0;
+
+        // frames are additionally limited by the minimum frame time of cmd_swap()
+        if (benchmark.kind == "scene") { gpuPerSecond = min(gpuPerSecond, static_cast<double>(g_oneSecondInMicros) / g_minFrameTimeMicros); }
+
+        double achievedPerSecond = min(linkPerSecond, gpuPerSecond);
+        const char* bottleneck = linkPerSecond < gpuPerSecond ? "link" : "gpu";
+
+        if (in_isJSON)
+        {
+          std::printf("%s  {\"protocol\": \"%s\", \"kind\": \"%s\", \"name\": \"%s\", \"baud\": %lu, \"bytes_per_unit\": %.2f, \"encode_us\": %.3f, "
+                      "\"execute_us\": %.3f, \"link_per_s\": %.1f, \"gpu_per_s\": %.1f, \"achieved_per_s\": %.1f, \"bottleneck\": \"%s\"}",
+                      isFirst ? "" : ",\n", getProtocolName(benchmark.protocol), benchmark.kind.c_str(), benchmark.name.c_str(), fromSerialGFXBaud(baud),
+                      measurement.bytesPerUnit, measurement.encodeMicrosPerUnit, measurement.executeMicrosPerUnit,
+                      linkPerSecond, gpuPerSecond, achievedPerSecond, bottleneck);
+        }
+        else
+        {
+          std::printf("%s,%s,%s,%lu,%.2f,%.3f,%.3f,%.1f,%.1f,%.1f,%s\n",
+                      getProtocolName(benchmark.protocol), benchmark.kind.c_str(), benchmark.name.c_str(), fromSerialGFXBaud(baud),
+                      measurement.bytesPerUnit, measurement.encodeMicrosPerUnit, measurement.executeMicrosPerUnit,
+                      linkPerSecond, gpuPerSecond, achievedPerSecond, bottleneck);
+        }
+
+        isFirst = false;
+      }
+    }
+
+    if (in_isJSON) { std::printf("\n]\n"); }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bool isJSON = false;
+  size_t iterations = 2000;
+
+  for (int index = 1; index < argc; ++index)
+  {
+    if (std::strcmp(argv[index], "--json") == 0) { isJSON = true; }
+    else { iterations = std::strtoul(argv[index], nullptr, 10); }
+  }
+
+  BenchmarkRig rig;
+  if (not rig.begin()) { std::fprintf(stderr, "begin() failed\n"); return EXIT_FAILURE; }
+
+  std::vector<Benchmark> benchmarks;
+  for (SerialGFXProtocol protocol : { SerialGFXProtocol::v1, SerialGFXProtocol::compact })
+  {
+    if (not rig.setProtocol(protocol)) { std::fprintf(stderr, "setProtocol() failed\n"); return EXIT_FAILURE; }
+
+    for (Benchmark& benchmark : createBenchmarks(protocol))
+    {
+      size_t benchmarkIterations = benchmark.kind == "scene" ? max(iterations / 20, static_cast<size_t>(1)) : iterations;
+      rig.measure(benchmark, max(benchmarkIterations / 10, static_cast<size_t>(1))); // warm up
+      benchmark.measurement = rig.measureAgainstBaseline(benchmark, benchmarkIterations);
+      benchmarks.push_back(benchmark);
+    }
+  }
+
+  printResults(benchmarks, isJSON);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Host (Linux) stand-in for the elapsedMillis library.
+
+#include "Arduino.h"
+
+class elapsedMillis
+{
+  private:
+    unsigned long m_begin;
+
+  public:
+    elapsedMillis() : m_begin(millis())
+    {}
+
+    operator unsigned long() const
+    {
+      return millis() - m_begin;
+    }
+
+    elapsedMillis& operator=(unsigned long in_value)
+    {
+      m_begin = millis() - in_value;
+      return *this;
+    }
+};
+
+class elapsedMicros
+{
+  private:
+    unsigned long m_begin;
+
+  public:
+    elapsedMicros() : m_begin(micros())
+    {}
+
+    operator unsigned long() const
+    {
+      return micros() - m_begin;
+    }
+
+    elapsedMicros& operator=(unsigned long in_value)
+    {
+      m_begin = micros() - in_value;
+      return *this;
+    }
+};
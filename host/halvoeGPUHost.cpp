@@ -0,0 +1,85 @@
+// Host (Linux) build of halvoeGPU: atCPU::SerialGFXInterface drives atGPU::SerialGFXInterface
+// through an in-process serial link and the displayed frame is written to a PPM image.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/halvoeGPUHost.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o halvoeGPUHost
+// Usage: ./halvoeGPUHost [output.ppm] [baud, 0 = unthrottled]
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+
+#include "../SerialGFXInterface_atCPU.hpp"
+#include "../SerialGFXInterface_atGPU.hpp"
+
+namespace
+{
+  void runGPUUntilIdle(halvoeGPU::host::HostSerialLink& io_link, halvoeGPU::atGPU::SerialGFXInterface& io_gpu)
+  {
+    // the pipe is empty, as soon as the bytes are in the receive ring of the GPU, they may still hold several commands
+    while (not io_link.getCPUToGPUPipe().isEmpty() || io_gpu.receiveCommand())
+    {
+      if (io_gpu.receiveCommand()) { io_gpu.runCommand(); }
+    }
+  }
+
+  void drawTestScene(halvoeGPU::atCPU::SerialGFXInterface& io_cpu)
+  {
+    io_cpu.beginBatch();
+    io_cpu.sendFillScreen(16);
+
+    for (int16_t index = 0; index < 8; ++index)
+    {
+      io_cpu.sendFillRect(10 + index * 38, 40, 30, 60, 32 + index * 28);
+      io_cpu.sendDrawRect(8 + index * 38, 38, 34, 64, 255);
+    }
+
+    io_cpu.sendSetTextColor(255);
+    io_cpu.sendSetTextSize(2);
+    io_cpu.sendSetCursor(10, 120);
+    io_cpu.sendPrintln("halvoeGPU host");
+    io_cpu.sendSetTextSize(1);
+    io_cpu.sendSetFont(halvoeGPU::SerialGFXFont::Picopixel);
+    io_cpu.sendSetCursor(10, 160);
+    io_cpu.sendPrint("Picopixel 0123456789");
+    io_cpu.sendSetFont(halvoeGPU::SerialGFXFont::Default);
+    io_cpu.endBatch();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* outputPath = argc > 1 ? argv[1] : "halvoeGPU.ppm";
+  unsigned long baud = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+
+  halvoeGPU::host::HostSerialLink link;
+  link.setThrottleEnabled(baud > 0);
+  halvoeGPU::host::connectPins(halvoeGPU::atGPU::READY_PIN, halvoeGPU::atCPU::READY_PIN);
+
+  DVIGFX8 dviGFX(DVI_RES_320x240p60, true, adafruit_feather_dvi_cfg);
+  halvoeGPU::atGPU::SerialGFXInterface gpu(link.getGPUSerial(), dviGFX);
+  halvoeGPU::atCPU::SerialGFXInterface cpu(link.getCPUSerial());
+
+  halvoeGPU::SerialGFXBaud linkBaud = baud > 0 ? static_cast<halvoeGPU::SerialGFXBaud>(baud) : halvoeGPU::SerialGFXBaud::Default;
+  if (not gpu.begin(linkBaud)) { std::fprintf(stderr, "gpu.begin() failed\n"); return EXIT_FAILURE; }
+  if (not cpu.begin(linkBaud)) { std::fprintf(stderr, "cpu.begin() failed\n"); return EXIT_FAILURE; }
+  gpu.writeReady(true);
+  if (not cpu.isGPUReady()) { std::fprintf(stderr, "GPU is not ready\n"); return EXIT_FAILURE; }
+
+  unsigned long beginMicros = micros();
+  drawTestScene(cpu);
+  runGPUUntilIdle(link, gpu);
+
+  delayMicroseconds(halvoeGPU::g_minFrameTimeMicros); // cmd_swap() drops swaps within the minimum frame time
+  cpu.sendSwap();
+  runGPUUntilIdle(link, gpu);
+  unsigned long frameMicros = micros() - beginMicros;
+
+  if (not dviGFX.writePPM(outputPath)) { std::fprintf(stderr, "writing %s failed\n", outputPath); return EXIT_FAILURE; }
+
+  std::printf("bytes sent: %lu\n", link.getCPUToGPUPipe().getWrittenCount());
+  std::printf("frame time: %lu us\n", frameMicros);
+  std::printf("swaps: %lu\n", dviGFX.getSwapCount());
+  std::printf("written: %s\n", outputPath);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+// Memory report: the static RAM, which atCPU::SerialGFXInterface and atGPU::SerialGFXInterface take in the compiled configuration,
+// and their largest parts. Build it once per configuration, e.g. with -DHALVOE_GPU_MAX_PARAMETER_BUFFER_LENGTH=1024
+// -DHALVOE_GPU_RECEIVE_RING_LENGTH=8192 (both sides have to use the same values) or -DHALVOE_GPU_PIPELINE=1.
+// The buffers have the same size on the host as on the MCUs, only the pointers in the classes are larger on the host.
+// What the GPU does not take is left to the heap, from which the framebuffers, the receive ring buffer and the arena of
+// SpriteCache::begin() are allocated.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/memoryReport.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o memoryReport
+// Usage: ./memoryReport [--json]
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+#include <string>
+#include <vector>
+
+#include "../SerialGFXInterface_atCPU.hpp"
+#include "../SerialGFXInterface_atGPU.hpp"
+
+namespace
+{
+  using namespace halvoeGPU;
+
+  struct MemoryPart
+  {
+    std::string side;
+    std::string name;
+    size_t length;
+  };
+
+  std::vector<MemoryPart> createReport()
+  {
+    std::vector<MemoryPart> parts;
+
+    parts.push_back({ "cpu", "SerialGFXInterface", sizeof(atCPU::SerialGFXInterface) });
+    parts.push_back({ "cpu", "parameterBuffer", g_maxParameterBufferLength });
+    parts.push_back({ "cpu", "transmitRing", sizeof(atCPU::TransmitRing<atCPU::g_transmitRingLength>) });
+    parts.push_back({ "cpu", "textMetricsCache", sizeof(atCPU::TextMetricsCache) });
+
+    parts.push_back({ "gpu", "SerialGFXInterface", sizeof(atGPU::SerialGFXInterface) });
+    parts.push_back({ "gpu", "receiveRing", sizeof(atGPU::GPUReceiveRing) });
+    parts.push_back({ "gpu", "glyphAtlas", sizeof(atGPU::GlyphAtlas) });
+    parts.push_back({ "gpu", "macroStore", sizeof(atGPU::MacroStore) });
+    parts.push_back({ "gpu", "tileBinner", sizeof(atGPU::TileBinner) });
+    #if HALVOE_GPU_PIPELINE != HALVOE_GPU_PIPELINE_NONE
+      parts.push_back({ "gpu", "commandQueue", sizeof(SPSCQueue<atGPU::QueuedCommand, atGPU::g_commandQueueCapacity>) });
+    #endif // HALVOE_GPU_PIPELINE
+    parts.push_back({ "gpu", "framebuffers", 2 * g_screenWidth * g_screenHeight }); // DVIGFX8 with double buffering, on the heap
+    parts.push_back({ "gpu", "receiveRingBuffer", atGPU::GPUReceiveRing::getBufferLength() }); // on the heap, aligned to the ring length
+    parts.push_back({ "gpu", "maxReceiveRingAlignment", atGPU::GPUReceiveRing::getMaxAlignmentLength() }); // in front of it, at most
+    parts.push_back({ "gpu", "maxSpriteArena", atGPU::g_maxSpriteArenaLength });    // on the heap, as far as it is left
+
+    return parts;
+  }
+
+  void printReport(const std::vector<MemoryPart>& in_parts, bool in_isJSON)
+  {
+    if (in_isJSON)
+    {
+      std::printf("{\"max_parameter_buffer_length\": %zu, \"receive_ring_length\": %zu, \"transmit_ring_length\": %zu, \"pipeline\": %d, \"parts\": [\n",
+                  g_maxParameterBufferLength, g_gpuReceiveRingLength, atCPU::g_transmitRingLength, HALVOE_GPU_PIPELINE);
+    }
+    else
+    {
+      std::printf("# max_parameter_buffer_length %zu, receive_ring_length %zu, transmit_ring_length %zu, pipeline %d\n",
+                  g_maxParameterBufferLength, g_gpuReceiveRingLength, atCPU::g_transmitRingLength, HALVOE_GPU_PIPELINE);
+      std::printf("side,part,bytes\n");
+    }
+
+    bool isFirst = true;
+    for (const MemoryPart& part : in_parts)
+    {
+      if (in_isJSON) { std::printf("%s  {\"side\": \"%s\", \"part\": \"%s\", \"bytes\": %zu}", isFirst ? "" : ",\n", part.side.c_str(), part.name.c_str(), part.length); }
+      else { std::printf("%s,%s,%zu\n", part.side.c_str(), part.name.c_str(), part.length); }
+      isFirst = false;
+    }
+
+    if (in_isJSON) { std::printf("\n]}\n"); }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bool isJSON = argc > 1 && std::strcmp(argv[1], "--json") == 0;
+  printReport(createReport(), isJSON);
+  return EXIT_SUCCESS;
+}
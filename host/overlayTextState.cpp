@@ -0,0 +1,137 @@
+// Host test: the text of several frames is drawn in its own color and at its own cursor, while the GPU draws its
+// frame time and FPS overlay at every swap (as halvoeGPU.ino does), in the immediate and in the retained mode of atCPU
+// and by raw packets, which set the text color only once (the GPU has to keep it across the overlay).
+// Every presented frame is compared with the same text drawn by Adafruit_GFX, outside of the overlay.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/overlayTextState.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o overlayTextState
+// Usage: ./overlayTextState
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+#include <cstdio>
+
+#include "../SerialGFXInterface_atCPU.hpp"
+#include "../SerialGFXInterface_atGPU.hpp"
+
+namespace
+{
+  using namespace halvoeGPU;
+
+  constexpr const size_t g_frameCount = 4;
+  constexpr const uint8_t g_backgroundColor = 3;
+  constexpr const uint16_t g_textColor = 100;
+  constexpr const int16_t g_overlayLeft = 200; // the overlay is right-aligned in the top rows
+  constexpr const int16_t g_overlayBottom = 30;
+
+  bool isOverlayPixel(size_t in_x, size_t in_y)
+  {
+    return in_x >= g_overlayLeft && in_y < g_overlayBottom;
+  }
+
+  void runGPUUntilIdle(host::HostSerialLink& io_link, atGPU::SerialGFXInterface& io_gpu)
+  {
+    while (not io_link.getCPUToGPUPipe().isEmpty() || io_gpu.receiveCommand())
+    {
+      if (io_gpu.receiveCommand()) { io_gpu.runCommand(); }
+    }
+  }
+
+  enum class TextSender : uint8_t
+  {
+    immediate = 0,
+    retained,
+    rawPackets
+  };
+
+  void writeRawPacket(host::HostSerial& io_serial, SerialGFXCommandCode in_commandCode, const char* in_parameters, size_t in_parameterLength)
+  {
+    char header[g_maxCommandHeaderLength];
+    size_t headerLength = getCommandHeaderLength(SerialGFXProtocol::v1, in_parameterLength);
+    writeCommandHeader(SerialGFXProtocol::v1, header, headerLength, in_commandCode, in_parameterLength);
+    io_serial.write(header, headerLength);
+    io_serial.write(in_parameters, in_parameterLength);
+  }
+
+  template<typename t_Schema, typename... t_ValueTypes>
+  void writeRawCommand(host::HostSerial& io_serial, t_ValueTypes... in_values)
+  {
+    char parameters[t_Schema::getMaxLength(SerialGFXProtocol::v1)];
+    writeRawPacket(io_serial, t_Schema::s_commandCode, parameters, t_Schema::encode(parameters, SerialGFXProtocol::v1, in_values...));
+  }
+
+  // Returns the pixels of the presented frames, which differ from the expected text.
+  size_t runFrames(TextSender in_sender)
+  {
+    host::HostSerialLink link;
+    DVIGFX8 dviGFX(DVI_RES_320x240p60, true, adafruit_feather_dvi_cfg);
+    DVIGFX8 expectedGFX(DVI_RES_320x240p60, false, adafruit_feather_dvi_cfg);
+    atGPU::SerialGFXInterface gpu(link.getGPUSerial(), dviGFX);
+    atCPU::SerialGFXInterface cpu(link.getCPUSerial());
+    if (not gpu.begin() || not cpu.begin() || not expectedGFX.begin()) { return SIZE_MAX; }
+
+    gpu.setMinFrameTimeEnabled(false);
+    gpu.enablePrintFrameTime();
+    gpu.enablePrintFPS();
+    if (in_sender == TextSender::retained) { cpu.enableRetainedMode(); }
+    if (in_sender == TextSender::rawPackets) { writeRawCommand<SetTextColorSchema>(link.getCPUSerial(), g_textColor); }
+    expectedGFX.cp437(true);
+
+    size_t differentPixelCount = 0;
+    for (size_t frame = 0; frame < g_frameCount; ++frame)
+    {
+      char label[16];
+      std::snprintf(label, sizeof(label), "Hello %zu", frame);
+      int16_t x = 10 + frame * 4;
+
+      if (in_sender == TextSender::rawPackets)
+      {
+        host::HostSerial& serial = link.getCPUSerial();
+        writeRawCommand<FillScreenSchema>(serial, g_backgroundColor);
+        writeRawCommand<SetCursorSchema>(serial, x, static_cast<int16_t>(40));
+        writeRawPacket(serial, SerialGFXCommandCode::print, label, std::strlen(label) + g_zeroTerminatorLength);
+        writeRawPacket(serial, SerialGFXCommandCode::swap, nullptr, 0);
+      }
+      else
+      {
+        cpu.sendFillScreen(g_backgroundColor);
+        cpu.sendSetTextColor(g_textColor);
+        cpu.sendSetCursor(x, 40);
+        cpu.sendPrint(label);
+        cpu.sendSwap();
+      }
+
+      runGPUUntilIdle(link, gpu);
+
+      expectedGFX.fillScreen(g_backgroundColor);
+      expectedGFX.setTextColor(g_textColor);
+      expectedGFX.setCursor(x, 40);
+      expectedGFX.print(label);
+
+      const uint8_t* presented = dviGFX.getFrontBuffer();
+      const uint8_t* expected = expectedGFX.getBuffer();
+      for (size_t y = 0; y < g_screenHeight; ++y)
+      {
+        for (size_t x = 0; x < g_screenWidth; ++x)
+        {
+          size_t index = y * g_screenWidth + x;
+          if (not isOverlayPixel(x, y) && presented[index] != expected[index]) { ++differentPixelCount; }
+        }
+      }
+    }
+
+    return differentPixelCount;
+  }
+}
+
+int main()
+{
+  size_t immediateErrorCount = runFrames(TextSender::immediate);
+  size_t retainedErrorCount = runFrames(TextSender::retained);
+  size_t rawPacketErrorCount = runFrames(TextSender::rawPackets);
+  std::printf("immediate: %zu different pixels\n", immediateErrorCount);
+  std::printf("retained: %zu different pixels\n", retainedErrorCount);
+  std::printf("raw packets: %zu different pixels\n", rawPacketErrorCount);
+  return immediateErrorCount == 0 && retainedErrorCount == 0 && rawPacketErrorCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,218 @@
+// Trace replay: runs a trace (see halvoeTrace.hpp), as captured by beginCapture() of atCPU::SerialGFXInterface
+// or atGPU::SerialGFXInterface, through atGPU::SerialGFXInterface again.
+//
+// The link starts in the protocol and framing of the header. By default the records are fed as fast as the GPU takes them,
+// no swap is dropped (see setMinFrameTimeEnabled()), so every run presents the same frames. With --realtime every record
+// is fed at its timestamp and the swaps wait for the vertical blank (in the execute time), like on the device.
+// --deferred enables the deferred rasterizer.
+// For every presented frame it reports the commands, the execute time (receiveCommand() and runCommand() on the host)
+// and the FNV-1a hash of the presented framebuffer and palette, so two builds can be compared frame by frame.
+//
+// Build (Adafruit-GFX-Library is the directory of the Adafruit GFX Library sources):
+//   g++ -std=gnu++17 -O2 -DARDUINO=10819 -DHALVOE_GPU_HOST -Ihost -IAdafruit-GFX-Library
+//       host/replayTrace.cpp Adafruit-GFX-Library/Adafruit_GFX.cpp -o replayTrace
+// Usage: ./replayTrace [--json] [--realtime] [--deferred] trace
+
+#include <Arduino.h>
+#include <PicoDVI.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "../SerialGFXInterface_atCPU.hpp"
+#include "../SerialGFXInterface_atGPU.hpp"
+
+namespace
+{
+  using namespace halvoeGPU;
+
+  constexpr const uint32_t g_fnvOffsetBasis = 2166136261u;
+  constexpr const uint32_t g_fnvPrime = 16777619u;
+
+  struct ReplayFrame
+  {
+    unsigned long commandCount = 0;
+    double executeMicros = 0;
+    uint32_t hash = 0;
+  };
+
+  double getMicrosSince(std::chrono::steady_clock::time_point in_begin)
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - in_begin).count();
+  }
+
+  uint32_t updateFNV1a(uint32_t in_hash, const uint8_t* in_bytes, size_t in_length)
+  {
+    for (size_t index = 0; index < in_length; ++index) { in_hash = (in_hash ^ in_bytes[index]) * g_fnvPrime; }
+    return in_hash;
+  }
+
+  bool readFile(const char* in_path, std::vector<char>& out_bytes)
+  {
+    std::FILE* file = std::fopen(in_path, "rb");
+    if (file == nullptr) { return false; }
+
+    char chunk[4096];
+    size_t readLength = 0;
+    while ((readLength = std::fread(chunk, 1, sizeof(chunk), file)) > 0) { out_bytes.insert(out_bytes.end(), chunk, chunk + readLength); }
+
+    bool isRead = std::ferror(file) == 0;
+    std::fclose(file);
+    return isRead;
+  }
+
+  class TraceReplay
+  {
+    private:
+      host::HostSerialLink m_link;
+      DVIGFX8 m_dviGFX;
+      atGPU::SerialGFXInterface m_gpu;
+      atCPU::SerialGFXInterface m_cpu; // only switches the link to the state, in which the trace begins
+      std::vector<ReplayFrame> m_frames;
+      ReplayFrame m_frame; // until the next swap
+      unsigned long m_swapCount = 0;
+      unsigned long m_recordCount = 0;
+      size_t m_byteCount = 0;
+
+    private:
+      void onSwap()
+      {
+        m_frame.hash = updateFNV1a(g_fnvOffsetBasis, m_dviGFX.getFrontBuffer(), g_screenWidth * g_screenHeight);
+        m_frame.hash = updateFNV1a(m_frame.hash, reinterpret_cast<const uint8_t*>(m_dviGFX.getFrontPalette()), g_colorCount * sizeof(uint16_t));
+        m_frames.push_back(m_frame);
+        m_frame = ReplayFrame();
+        m_swapCount = m_dviGFX.getSwapCount();
+      }
+
+      // executes everything, which is fed until now; the responses of the GPU are not needed
+      void runGPU()
+      {
+        if (m_link.getCPUToGPUPipe().isEmpty() && not m_gpu.receiveCommand()) { return; } // while --realtime waits for the next record
+
+        auto segmentBegin = std::chrono::steady_clock::now();
+        while (not m_link.getCPUToGPUPipe().isEmpty() || m_gpu.receiveCommand())
+        {
+          if (not m_gpu.receiveCommand()) { continue; }
+          m_gpu.runCommand();
+          ++m_frame.commandCount;
+
+          if (m_dviGFX.getSwapCount() != m_swapCount)
+          {
+            m_frame.executeMicros = m_frame.executeMicros + getMicrosSince(segmentBegin);
+            onSwap();
+            segmentBegin = std::chrono::steady_clock::now();
+          }
+        }
+
+        m_frame.executeMicros = m_frame.executeMicros + getMicrosSince(segmentBegin);
+        while (m_link.getCPUSerial().read() >= 0) {}
+      }
+
+    public:
+      TraceReplay() :
+        m_dviGFX(DVI_RES_320x240p60, true, adafruit_feather_dvi_cfg),
+        m_gpu(m_link.getGPUSerial(), m_dviGFX), m_cpu(m_link.getCPUSerial())
+      {}
+
+      // The replaying side is not begun, its bytes arrive at any baud the GPU switches to.
+      bool begin(const TraceHeader& in_header, bool in_isRealtime, bool in_isDeferredRasterEnabled)
+      {
+        m_link.setThrottleEnabled(false);
+        if (not m_gpu.begin()) { return false; }
+        m_gpu.setMinFrameTimeEnabled(in_isRealtime);
+        m_gpu.setDeferredRasterEnabled(in_isDeferredRasterEnabled);
+        m_dviGFX.setVBlankWaitEnabled(in_isRealtime);
+
+        if (in_header.protocol != SerialGFXProtocol::v1 && not m_cpu.sendSetProtocol(in_header.protocol)) { return false; }
+        if (in_header.isFramingEnabled && not m_cpu.sendSetFraming(true)) { return false; }
+        runGPU();
+
+        m_frame = ReplayFrame();
+        m_swapCount = m_dviGFX.getSwapCount();
+        return true;
+      }
+
+      void replay(const std::vector<char>& in_trace, bool in_isRealtime)
+      {
+        size_t offset = g_traceHeaderLength;
+        TraceRecord record;
+        unsigned long beginMicros = micros();
+
+        while (readTraceRecord(in_trace.data(), in_trace.size(), offset, record))
+        {
+          while (in_isRealtime && micros() - beginMicros < record.micros) { runGPU(); }
+          m_link.getCPUToGPUPipe().write(reinterpret_cast<const uint8_t*>(record.bytes), record.length);
+          runGPU();
+          ++m_recordCount;
+          m_byteCount = m_byteCount + record.length;
+        }
+      }
+
+      void printResults(const TraceHeader& in_header, size_t in_traceLength, bool in_isJSON)
+      {
+        double executeMicros = 0;
+        for (const ReplayFrame& frame : m_frames) { executeMicros = executeMicros + frame.executeMicros; }
+        const GPUStats& stats = m_gpu.getStats();
+        const char* side = in_header.side == TraceSide::cpu ? "cpu" : "gpu";
+        size_t truncatedLength = in_traceLength - g_traceHeaderLength - m_recordCount * g_traceRecordHeaderLength - m_byteCount;
+
+        if (in_isJSON)
+        {
+          std::printf("{\"side\": \"%s\", \"records\": %lu, \"bytes\": %zu, \"truncated_bytes\": %zu, \"frames\": %zu, \"execute_us\": %.1f, "
+                      "\"parse_errors\": %lu, \"corrupted_frames\": %lu, \"dropped_swaps\": %lu, \"per_frame\": [\n",
+                      side, m_recordCount, m_byteCount, truncatedLength, m_frames.size(), executeMicros,
+                      m_gpu.getParseErrorCount(), m_gpu.getCorruptedFrameCount(), static_cast<unsigned long>(stats.totals.droppedSwapCount));
+        }
+        else
+        {
+          std::printf("# side %s, records %lu, bytes %zu, truncated bytes %zu, frames %zu, execute %.1f us, parse errors %lu, corrupted frames %lu, dropped swaps %lu\n",
+                      side, m_recordCount, m_byteCount, truncatedLength, m_frames.size(), executeMicros,
+                      m_gpu.getParseErrorCount(), m_gpu.getCorruptedFrameCount(), static_cast<unsigned long>(stats.totals.droppedSwapCount));
+          std::printf("frame,commands,execute_us,hash\n");
+        }
+
+        for (size_t index = 0; index < m_frames.size(); ++index)
+        {
+          const ReplayFrame& frame = m_frames[index];
+          if (in_isJSON)
+          {
+            std::printf("%s  {\"frame\": %zu, \"commands\": %lu, \"execute_us\": %.1f, \"hash\": \"%08x\"}",
+                        index == 0 ? "" : ",\n", index, frame.commandCount, frame.executeMicros, frame.hash);
+          }
+          else { std::printf("%zu,%lu,%.1f,%08x\n", index, frame.commandCount, frame.executeMicros, frame.hash); }
+        }
+
+        if (in_isJSON) { std::printf("\n]}\n"); }
+      }
+  };
+}
+
+int main(int argc, char** argv)
+{
+  bool isJSON = false;
+  bool isRealtime = false;
+  bool isDeferredRasterEnabled = false;
+  const char* tracePath = nullptr;
+
+  for (int index = 1; index < argc; ++index)
+  {
+    if (std::strcmp(argv[index], "--json") == 0) { isJSON = true; }
+    else if (std::strcmp(argv[index], "--realtime") == 0) { isRealtime = true; }
+    else if (std::strcmp(argv[index], "--deferred") == 0) { isDeferredRasterEnabled = true; }
+    else { tracePath = argv[index]; }
+  }
+
+  if (tracePath == nullptr) { std::fprintf(stderr, "usage: %s [--json] [--realtime] [--deferred] trace\n", argv[0]); return EXIT_FAILURE; }
+
+  std::vector<char> trace;
+  if (not readFile(tracePath, trace)) { std::fprintf(stderr, "reading %s failed\n", tracePath); return EXIT_FAILURE; }
+
+  TraceHeader header;
+  if (not readTraceHeader(trace.data(), trace.size(), header)) { std::fprintf(stderr, "%s is no trace of version %u\n", tracePath, g_traceVersion); return EXIT_FAILURE; }
+
+  TraceReplay replay;
+  if (not replay.begin(header, isRealtime, isDeferredRasterEnabled)) { std::fprintf(stderr, "gpu.begin() failed\n"); return EXIT_FAILURE; }
+  replay.replay(trace, isRealtime);
+  replay.printResults(header, trace.size(), isJSON);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+// Host stress test for halvoeGPU::SPSCQueue (producer and consumer on two threads).
+// Build: g++ -std=c++17 -O2 -pthread host/spscQueueStress.cpp -o spscQueueStress
+// Usage: ./spscQueueStress [element count]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../halvoeSPSCQueue.hpp"
+
+namespace
+{
+  constexpr const size_t g_payloadLength = 256; // same slot size as atGPU::QueuedCommand
+  constexpr const size_t g_queueCapacity = 16;
+
+  struct StressElement
+  {
+    uint32_t sequenceNumber = 0;
+    uint16_t payloadLength = 0;
+    std::array<uint8_t, g_payloadLength> payload;
+  };
+
+  uint8_t getPayloadByte(uint32_t in_sequenceNumber, size_t in_index)
+  {
+    return static_cast<uint8_t>(in_sequenceNumber * 31 + in_index * 7);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const uint32_t elementCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 10000000;
+  static halvoeGPU::SPSCQueue<StressElement, g_queueCapacity> queue;
+  uint64_t producerStalls = 0;
+  uint64_t consumerStalls = 0;
+  uint64_t errorCount = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  std::thread producer([&]()
+  {
+    for (uint32_t sequenceNumber = 0; sequenceNumber < elementCount; ++sequenceNumber)
+    {
+      StressElement* element = nullptr;
+      while ((element = queue.getPushSlot()) == nullptr) { ++producerStalls; std::this_thread::yield(); }
+
+      element->sequenceNumber = sequenceNumber;
+      element->payloadLength = sequenceNumber % g_payloadLength + 1;
+      for (size_t index = 0; index < element->payloadLength; ++index)
+      {
+        element->payload[index] = getPayloadByte(sequenceNumber, index);
+      }
+
+      queue.push();
+    }
+  });
+
+  std::thread consumer([&]()
+  {
+    for (uint32_t expectedSequenceNumber = 0; expectedSequenceNumber < elementCount; ++expectedSequenceNumber)
+    {
+      StressElement* element = nullptr;
+      while ((element = queue.getFront()) == nullptr) { ++consumerStalls; std::this_thread::yield(); }
+
+      if (element->sequenceNumber != expectedSequenceNumber) { ++errorCount; }
+      if (element->payloadLength != expectedSequenceNumber % g_payloadLength + 1) { ++errorCount; }
+      for (size_t index = 0; index < element->payloadLength; ++index)
+      {
+        if (element->payload[index] != getPayloadByte(expectedSequenceNumber, index)) { ++errorCount; break; }
+      }
+
+      queue.pop();
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  std::printf("elements: %u\n", elementCount);
+  std::printf("seconds: %.3f\n", seconds);
+  std::printf("elements/s: %.0f\n", elementCount / seconds);
+  std::printf("producer stalls: %llu\n", static_cast<unsigned long long>(producerStalls));
+  std::printf("consumer stalls: %llu\n", static_cast<unsigned long long>(consumerStalls));
+  std::printf("errors: %llu\n", static_cast<unsigned long long>(errorCount));
+  return errorCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}